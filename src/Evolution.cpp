@@ -4,6 +4,7 @@
 #include "Fragmentation.h"
 #include "Phys_consts.h"
 
+using Fragmentation::KkpTable;
 using Fragmentation::kkp;
 using PhysConst::hbarc;
 using PhysConst::m_kaon;
@@ -369,12 +370,72 @@ void Evolution::checkGaussLaw(Lattice *lat, Parameters *param) {
   cout << "Gauss violation=" << largest << endl;
 }
 
+void Evolution::computeGfactor(Lattice *lat, Parameters *param) {
+  const int N = param->getSize();
+  const double a = param->getL() / N; // lattice spacing in fm
+  const double g = param->getg();
+  const double c = param->getc();
+  const double muZero = param->getMuZero();
+  const int runWithQs = param->getRunWithQs();
+  // (Qs/g2mu)^2 in GeV^2
+  const double QsSqFactor = param->getQsmuRatio() * param->getQsmuRatio() /
+                            a / a * hbarc * hbarc * g * g;
+
+  gfactorLocal_.assign(N * N, 1.);
+  gfactor_.assign(N * N, 1.);
+  if (!param->getRunningCoupling())
+    return;
+
+  // 3 flavors
+  auto gfactorAt = [&](double Qs) {
+    double alphas =
+        4. * M_PI /
+        (9. * log(pow(pow(muZero / 0.2, 2. / c) +
+                          pow(param->getRunWithThisFactorTimesQs() * Qs / 0.2,
+                              2. / c),
+                      c)));
+    return g * g / (4. * M_PI * alphas);
+  };
+
+#pragma omp parallel for
+  for (int pos = 0; pos < N * N; pos++) {
+    double g2mu2A = 0., g2mu2B = 0.;
+    if (pos > 0 && pos < (N - 1) * N + N - 1) {
+      g2mu2A = lat->cells[pos]->getg2mu2A();
+      g2mu2B = lat->cells[pos]->getg2mu2B();
+    }
+
+    double Qs = 0.;
+    if (runWithQs == 2)
+      Qs = sqrt(max(g2mu2A, g2mu2B) * QsSqFactor);
+    else if (runWithQs == 0)
+      Qs = sqrt(min(g2mu2A, g2mu2B) * QsSqFactor);
+    else if (runWithQs == 1)
+      Qs = sqrt((g2mu2A + g2mu2B) / 2. * QsSqFactor);
+
+    // run with the local (in transverse plane) coupling
+    gfactorLocal_[pos] = gfactorAt(Qs);
+  }
+
+  if (param->getRunWithLocalQs() == 1) {
+    gfactor_ = gfactorLocal_;
+  } else {
+    double QsAverage = 0.;
+    if (runWithQs == 0)
+      QsAverage = param->getAverageQsmin();
+    else if (runWithQs == 1)
+      QsAverage = param->getAverageQsAvg();
+    else if (runWithQs == 2)
+      QsAverage = param->getAverageQs();
+    gfactor_.assign(N * N, gfactorAt(QsAverage));
+  }
+}
+
 void Evolution::run(Lattice *lat, BufferLattice *bufferlat, Group *group,
                     Parameters *param) {
   int Nc = param->getNc();
   int pos;
   int N = param->getSize();
-  double g = param->getg();
   double L = param->getL();
   double a = L / N; // lattice spacing in fm
   double x, y;
@@ -407,11 +468,7 @@ void Evolution::run(Lattice *lat, BufferLattice *bufferlat, Group *group,
   Matrix phiY(int(Nc), 0.);
   Matrix pi(Nc);
 
-  double alphas = 0.;
   double gfactor;
-  double Qs = 0., g2mu2A, g2mu2B;
-  double muZero = param->getMuZero();
-  double c = param->getc();
   Matrix phiTildeX(Nc);
   Matrix phiTildeY(Nc);
 
@@ -427,6 +484,8 @@ void Evolution::run(Lattice *lat, BufferLattice *bufferlat, Group *group,
     maxtime = param->getMaxtime(); // maxtime is in fm
   }
 
+  computeGfactor(lat, param);
+
   // E and Pi at tau=dtau/2 are equal to the initial ones (at tau=0)
   // now evolve phi and U to time tau=dtau.
   evolvePhi(lat, bufferlat, param, dtau, 0.);
@@ -441,6 +500,13 @@ void Evolution::run(Lattice *lat, BufferLattice *bufferlat, Group *group,
   cout << "Starting evolution" << endl;
   cout << "itmax=" << itmax << endl;
 
+  // with measurements on a snapshot the evolution keeps the other threads
+#ifdef _OPENMP
+  const int allThreads = omp_get_max_threads();
+  if (param->getMeasureThreads() > 0)
+    omp_set_num_threads(max(1, allThreads - param->getMeasureThreads()));
+#endif
+
   // do evolution
   for (int it = 1; it <= itmax; it++) {
     if (it == 1 || it == it0 || it == it1 || it == it2
@@ -463,6 +529,13 @@ void Evolution::run(Lattice *lat, BufferLattice *bufferlat, Group *group,
       // evolve from time tau to tau+dtau
       evolvePhi(lat, bufferlat, param, dtau, (it)*dtau);
       evolveU(lat, bufferlat, param, dtau, (it)*dtau);
+
+      // keep the lattice near Coulomb gauge between the measurements (only
+      // if the measurements gauge fix the live lattice)
+      if (param->getGaugeFixWarmStart() > 0 &&
+          param->getMeasureThreads() == 0 &&
+          it % param->getGaugeFixWarmStart() == 0)
+        gaugefix.relax(fft, lat, group, param);
     } else if (it == itmax) {
       evolvePi(lat, bufferlat, param, dtau / 2.,
                (it)*dtau); // the last argument is the current time tau.
@@ -483,53 +556,7 @@ void Evolution::run(Lattice *lat, BufferLattice *bufferlat, Group *group,
           x = -L / 2. + a * ix;
           y = -L / 2. + a * iy;
 
-          if (param->getRunningCoupling()) {
-            if (pos > 0 && pos < (N - 1) * N + N - 1) {
-              g2mu2A = lat->cells[pos]->getg2mu2A();
-            } else
-              g2mu2A = 0;
-
-            if (pos > 0 && pos < (N - 1) * N + N - 1) {
-              g2mu2B = lat->cells[pos]->getg2mu2B();
-            } else
-              g2mu2B = 0;
-
-            if (param->getRunWithQs() == 2) {
-              if (g2mu2A > g2mu2B)
-                Qs = sqrt(g2mu2A * param->getQsmuRatio() *
-                          param->getQsmuRatio() / a / a * hbarc * hbarc *
-                          param->getg() * param->getg());
-              else
-                Qs = sqrt(g2mu2B * param->getQsmuRatio() *
-                          param->getQsmuRatio() / a / a * hbarc * hbarc *
-                          param->getg() * param->getg());
-            } else if (param->getRunWithQs() == 0) {
-              if (g2mu2A < g2mu2B)
-                Qs = sqrt(g2mu2A * param->getQsmuRatio() *
-                          param->getQsmuRatio() / a / a * hbarc * hbarc *
-                          param->getg() * param->getg());
-              else
-                Qs = sqrt(g2mu2B * param->getQsmuRatio() *
-                          param->getQsmuRatio() / a / a * hbarc * hbarc *
-                          param->getg() * param->getg());
-            } else if (param->getRunWithQs() == 1) {
-              Qs = sqrt((g2mu2A + g2mu2B) / 2. * param->getQsmuRatio() *
-                        param->getQsmuRatio() / a / a * hbarc * hbarc *
-                        param->getg() * param->getg());
-            }
-
-            // 3 flavors
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          Qs / 0.2,
-                                      2. / c),
-                              c)));
-            gfactor = g * g / (4. * M_PI * alphas);
-            // run with the local (in transverse plane) coupling
-          } else
-            gfactor = 1.;
+          gfactor = gfactorLocal_[pos];
 
           foutEps << x << " " << y << " "
                   << hbarc * gfactor * abs(lat->cells[pos]->getEpsilon())
@@ -556,82 +583,7 @@ void Evolution::run(Lattice *lat, BufferLattice *bufferlat, Group *group,
           x = -L / 2. + a * ix;
           y = -L / 2. + a * iy;
 
-          if (param->getRunningCoupling()) {
-            if (pos > 0 && pos < (N - 1) * N + N - 1) {
-              g2mu2A = lat->cells[pos]->getg2mu2A();
-            } else
-              g2mu2A = 0;
-
-            if (pos > 0 && pos < (N - 1) * N + N - 1) {
-              g2mu2B = lat->cells[pos]->getg2mu2B();
-            } else
-              g2mu2B = 0;
-
-            if (param->getRunWithQs() == 2) {
-              if (g2mu2A > g2mu2B)
-                Qs = sqrt(g2mu2A * param->getQsmuRatio() *
-                          param->getQsmuRatio() / a / a * hbarc * hbarc *
-                          param->getg() * param->getg());
-              else
-                Qs = sqrt(g2mu2B * param->getQsmuRatio() *
-                          param->getQsmuRatio() / a / a * hbarc * hbarc *
-                          param->getg() * param->getg());
-            } else if (param->getRunWithQs() == 0) {
-              if (g2mu2A < g2mu2B)
-                Qs = sqrt(g2mu2A * param->getQsmuRatio() *
-                          param->getQsmuRatio() / a / a * hbarc * hbarc *
-                          param->getg() * param->getg());
-              else
-                Qs = sqrt(g2mu2B * param->getQsmuRatio() *
-                          param->getQsmuRatio() / a / a * hbarc * hbarc *
-                          param->getg() * param->getg());
-            } else if (param->getRunWithQs() == 1) {
-              Qs = sqrt((g2mu2A + g2mu2B) / 2. * param->getQsmuRatio() *
-                        param->getQsmuRatio() / a / a * hbarc * hbarc *
-                        param->getg() * param->getg());
-            }
-
-            if (param->getRunWithLocalQs() == 1) {
-              // 3 flavors
-              alphas =
-                  4. * M_PI /
-                  (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                    pow(param->getRunWithThisFactorTimesQs() *
-                                            Qs / 0.2,
-                                        2. / c),
-                                c)));
-              gfactor = g * g / (4. * M_PI * alphas);
-              // run with the local (in transverse plane) coupling
-            } else {
-              if (param->getRunWithQs() == 0)
-                alphas =
-                    4. * M_PI /
-                    (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                      pow(param->getRunWithThisFactorTimesQs() *
-                                              param->getAverageQsmin() / 0.2,
-                                          2. / c),
-                                  c)));
-              else if (param->getRunWithQs() == 1)
-                alphas =
-                    4. * M_PI /
-                    (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                      pow(param->getRunWithThisFactorTimesQs() *
-                                              param->getAverageQsAvg() / 0.2,
-                                          2. / c),
-                                  c)));
-              else if (param->getRunWithQs() == 2)
-                alphas =
-                    4. * M_PI /
-                    (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                      pow(param->getRunWithThisFactorTimesQs() *
-                                              param->getAverageQs() / 0.2,
-                                          2. / c),
-                                  c)));
-
-              gfactor = g * g / (4. * M_PI * alphas);
-            }
-          } else
-            gfactor = 1.;
+          gfactor = gfactor_[pos];
 
           foutEps2 << x << " " << y << " "
                    << hbarc * gfactor * abs(lat->cells[pos]->getEpsilon())
@@ -650,17 +602,186 @@ void Evolution::run(Lattice *lat, BufferLattice *bufferlat, Group *group,
     int success = 1;
     if (it == 1 || it == it0 || it == it1 || it == it2
         || it == it3 || it == itmax) {
-      eccentricity(lat, param, it, 0.0, 0);
-      //eccentricity(lat, param, it, 0.1, 0);
-      //eccentricity(lat, param, it, 1., 0);
-      //eccentricity(lat, param, it, 10., 0);
-
-      success = multiplicity(lat, group, param, it);
+      // all energy density cutoffs are done in one pass over the lattice,
+      // e.g. {0., 0.1, 1., 10.}
+      eccentricity(lat, param, it, {0.}, 0);
+
+      if (param->getMeasureThreads() > 0) {
+        // the previous measurement has to be done before the snapshot is
+        // overwritten; the evolution goes on while this one runs
+        success = finishMeasurement();
+        if (success != 0) {
+          takeSnapshot(lat, param);
+          startMeasurement(group, param, it);
+        }
+      } else {
+        success = multiplicity(lat, group, param, it);
+      }
     }
 
     if (success == 0)
       break;
   }
+
+  finishMeasurement();
+#ifdef _OPENMP
+  omp_set_num_threads(allThreads);
+#endif
+}
+
+void Evolution::takeSnapshot(Lattice *lat, Parameters *param) {
+  const int N = param->getSize();
+  if (snapshot_ == NULL)
+    snapshot_ = new Lattice(param, param->getNc(), N);
+
+#pragma omp parallel for
+  for (int pos = 0; pos < N * N; pos++) {
+    Cell *cell = lat->cells[pos];
+    Cell *copy = snapshot_->cells[pos];
+    copy->setUx(cell->getUx());
+    copy->setUy(cell->getUy());
+    copy->setE1(cell->getE1());
+    copy->setE2(cell->getE2());
+    copy->setphi(cell->getphi());
+    copy->setpi(cell->getpi());
+  }
+}
+
+void Evolution::startMeasurement(Group *group, Parameters *param, int it) {
+  measurement_ = std::thread([this, group, param, it]() {
+#ifdef _OPENMP
+    omp_set_num_threads(param->getMeasureThreads());
+#endif
+    measurementSuccess_ = multiplicity(snapshot_, group, param, it);
+  });
+}
+
+int Evolution::finishMeasurement() {
+  if (measurement_.joinable())
+    measurement_.join();
+  return measurementSuccess_;
+}
+
+void Evolution::binSpectrum(const KtSpectrum &spectrum, Matrix **F,
+                            double prefactor, Parameters *param, double *n,
+                            double *E, double *n2, double &dNdeta,
+                            double &dEdeta, double *Nkxky) {
+  const int N = param->getSize();
+  const int Nc = param->getNc();
+  const double a = param->getL() / N; // lattice spacing in fm
+  const double g = param->getg();
+  const double c = param->getc();
+  const double muZero = param->getMuZero();
+  const int bins = spectrum.getBins();
+  const double dkt = spectrum.getDkt();
+
+  auto nkt = [&](int pos) {
+    const double omega = spectrum.omega(pos);
+    if (omega == 0.)
+      return 0.;
+    const int npos = (N - pos / N) * N + (N - pos % N);
+    // Re tr(F(k) F(-k))
+    double trace = 0.;
+    for (int i = 0; i < Nc; i++)
+      for (int k = 0; k < Nc; k++)
+        trace += ((*F[pos])(i, k) * (*F[npos])(k, i)).real();
+    double result = 2. / omega / static_cast<double>(N * N) *
+                    (prefactor * trace);
+    if (param->getRunWithkt() == 1) {
+      result *= g * g /
+                (4. * M_PI * 4. * M_PI /
+                 (9. * log(pow(pow(muZero / 0.2, 2. / c) +
+                                   pow(param->getRunWithThisFactorTimesQs() *
+                                           omega * hbarc / a / 0.2,
+                                       2. / c),
+                               c))));
+    }
+    if (Nkxky != NULL)
+      Nkxky[pos] += result * N * N / M_PI / M_PI / 2. / 2.;
+    return result;
+  };
+
+  std::vector<double> sum, sumOmega, sumOverOmega;
+  double total, totalOmega;
+  spectrum.accumulate(nkt, sum, sumOmega, sumOverOmega, total, totalOmega);
+
+  dNdeta += total;
+  dEdeta += totalOmega * hbarc / a;
+  for (int ik = 0; ik < bins; ik++) {
+    // dividing by bin size; bin is dkt times Jacobian k(=ik*dkt) times
+    // 2Pi in phi times the correct number of counts for an infinite
+    // lattice: area in bin divided by total area
+    n[ik] += sum[ik] * N * N / M_PI / M_PI / 2. / 2.;
+    E[ik] += sumOmega[ik] * hbarc / a * N * N / M_PI / M_PI / 2. / 2.;
+    n2[ik] += sumOverOmega[ik] / dkt / 2 / M_PI;
+  }
+}
+
+void Evolution::hadronize(const double *n, int bins, double dkt,
+                          Parameters *param, int hbins, double *Nh) {
+  const double a = param->getL() / param->getSize(); // lattice spacing in fm
+  const double ktUnit = dkt / a * hbarc; // bin size in GeV
+  const int zSteps = KkpTable::zSteps;
+  const bool pseudoRapidity = param->getUsePseudoRapidity() != 0;
+  const double coshY = cosh(param->getRapidity());
+
+  // charged hadrons, or pions, kaons and protons with their Jacobians
+  const KkpTable *charged = pseudoRapidity ? NULL : &KkpTable::get(7, 1);
+  const KkpTable *pions = pseudoRapidity ? &KkpTable::get(1, 1) : NULL;
+  const KkpTable *kaons = pseudoRapidity ? &KkpTable::get(2, 1) : NULL;
+  const KkpTable *protons = pseudoRapidity ? &KkpTable::get(4, 1) : NULL;
+
+  // everything that depends on z only
+  std::vector<double> invZ(zSteps + 1), logZ(zSteps + 1), weight(zSteps + 1);
+  for (int iz = 0; iz <= zSteps; iz++) {
+    double z = KkpTable::z(iz);
+    invZ[iz] = 1. / z;
+    logZ[iz] = log(z);
+    // trapezoidal rule
+    weight[iz] = (iz == 0 || iz == zSteps ? 0.5 : 1.) * KkpTable::dz / (z * z);
+  }
+
+  // dN/d^2p_T(p_T) = int dz/z^2 dN/d^2k_T(p_T/z) D(z, p_T/z)
+#pragma omp parallel for
+  for (int ih = 0; ih <= hbins; ih++) {
+    const double mypt = ih * (20. / static_cast<double>(hbins));
+    Nh[ih] = 0.;
+    if (mypt == 0.)
+      continue;
+    const double logPt = log(mypt);
+
+    // Jacobians dy/deta of the species at this p_T
+    double jPion = 0., jKaon = 0., jProton = 0.;
+    if (pseudoRapidity) {
+      jPion = 2. * coshY / sqrt(coshY * coshY + m_pion * m_pion / (mypt * mypt));
+      jKaon = 2. * coshY / sqrt(coshY * coshY + m_kaon * m_kaon / (mypt * mypt));
+      jProton = 2. * coshY /
+                sqrt(coshY * coshY + m_proton * m_proton / (mypt * mypt));
+    }
+
+    double sum = 0.;
+    for (int iz = 0; iz <= zSteps; iz++) {
+      const double kt = mypt * invZ[iz];
+      // gluon dN/d^2k_T, linear in k_T between the bin centers
+      const int ik =
+          static_cast<int>(floor(kt / ktUnit - 0.5 + 0.00000001));
+      if (ik + 1 >= bins || ik < 0)
+        continue;
+      const double frac = kt / ktUnit - 0.5 - ik;
+      const double Ng = ((1. - frac) * n[ik] + frac * n[ik + 1]) * a / hbarc *
+                        a / hbarc; // to make dN/d^2k_T fo k_T in GeV
+
+      const double logQ = logPt - logZ[iz];
+      double D;
+      if (!pseudoRapidity)
+        D = (*charged)(iz, logQ);
+      else
+        D = jPion * (*pions)(iz, logQ) + jKaon * (*kaons)(iz, logQ) +
+            jProton * (*protons)(iz, logQ);
+      sum += weight[iz] * Ng * D;
+    }
+    Nh[ih] = sum;
+  }
 }
 
 void Evolution::Tmunu(Lattice *lat, Parameters *param, int it) {
@@ -1308,471 +1429,184 @@ void Evolution::anisotropy(Lattice *lat, Parameters *param, int it) {
 }
 
 void Evolution::eccentricity(Lattice *lat, Parameters *param, int it,
-                             double cutoff, int doAniso) {
+                             const std::vector<double> &cutoffs, int doAniso,
+                             int nMax) {
   stringstream strecc_name;
   strecc_name << "eccentricities" << param->getEventId() << ".dat";
   string ecc_name;
   ecc_name = strecc_name.str();
 
   // cutoff on energy density is 'cutoff' times Lambda_QCD^4
-  int N = param->getSize();
-  int pos;
-  double rA, phiA, x, y;
-  double L = param->getL();
-  double a = L / N; // lattice spacing in fm
-  double eccentricity1, eccentricity2, eccentricity3, eccentricity4,
-      eccentricity5, eccentricity6;
-  double avcos, avsin, avcos1, avsin1, avcos3, avsin3, avrSq, avxSq, avySq,
-      avr1, avr3, avcos4, avsin4, avr4, avcos5, avsin5, avr5, avcos6, avsin6,
-      avr6;
-  double Rbar;
-  double Psi1, Psi2, Psi3, Psi4, Psi5, Psi6;
-  double maxEps = 0;
-  double g = param->getg();
-
-  double g2mu2A, g2mu2B, gfactor, alphas = 0., Qs = 0.;
-  double c = param->getc();
-  double muZero = param->getMuZero();
-
-  double weight;
-
-  double area = 0.;
-  double avgeden = 0.;
-  int sum = 0;
-
-  avrSq = 0.;
-  avr3 = 0.;
-
-  double avx = 0.;
-  double avy = 0.;
-  double toteps = 0.;
-  int xshift;
-  int yshift;
-  double maxX = 0.;
-  double maxY = 0.;
-
-  double smallestX = 0.;
-  double smallestY = 0.;
-  double avgQs2AQs2B = 0.;
-
-  for (int ix = 0; ix < N; ix++) {
-    for (int iy = 0; iy < N; iy++) {
-      pos = ix * N + iy;
-      maxEps = max(lat->cells[pos]->getEpsilon(), maxEps);
-    }
-  }
-
-  // first shift to the center
-  for (int ix = 0; ix < N; ix++) {
-    x = -L / 2. + a * ix;
-    for (int iy = 0; iy < N; iy++) {
-      y = -L / 2. + a * iy;
-      pos = ix * N + iy;
-
-      if (param->getRunningCoupling()) {
-        if (pos > 0 && pos < (N - 1) * N + N - 1) {
-          g2mu2A = lat->cells[pos]->getg2mu2A();
-        } else
-          g2mu2A = 0;
+  const int N = param->getSize();
+  const double L = param->getL();
+  const double a = L / N; // lattice spacing in fm
+  const int nCut = cutoffs.size();
+  nMax = max(nMax, 2); // Psi2 is always needed
 
-        if (pos > 0 && pos < (N - 1) * N + N - 1) {
-          g2mu2B = lat->cells[pos]->getg2mu2B();
-        } else
-          g2mu2B = 0;
-
-        if (param->getRunWithQs() == 2) {
-          if (g2mu2A > g2mu2B)
-            Qs = sqrt(g2mu2A * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-          else
-            Qs = sqrt(g2mu2B * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-        } else if (param->getRunWithQs() == 0) {
-          if (g2mu2A < g2mu2B)
-            Qs = sqrt(g2mu2A * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-          else
-            Qs = sqrt(g2mu2B * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-        } else if (param->getRunWithQs() == 1) {
-          Qs = sqrt((g2mu2A + g2mu2B) / 2. * param->getQsmuRatio() *
-                    param->getQsmuRatio() / a / a * hbarc * hbarc *
-                    param->getg() * param->getg());
-        }
+  // energy density (to compare with the cutoffs) and weight of every site
+  std::vector<double> eden(N * N), siteWeight(N * N);
 
-        if (param->getRunWithLocalQs() == 1) {
-          // 3 flavors
-          alphas =
-              4. * M_PI /
-              (9. *
-               log(pow(pow(muZero / 0.2, 2. / c) +
-                           pow(param->getRunWithThisFactorTimesQs() * Qs / 0.2,
-                               2. / c),
-                       c)));
-          gfactor = g * g / (4. * M_PI * alphas);
-          // run with the local (in transverse plane) coupling
-        } else {
-          if (param->getRunWithQs() == 0)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQsmin() / 0.2,
-                                      2. / c),
-                              c)));
-          else if (param->getRunWithQs() == 1)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQsAvg() / 0.2,
-                                      2. / c),
-                              c)));
-          else if (param->getRunWithQs() == 2)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQs() / 0.2,
-                                      2. / c),
-                              c)));
-
-          gfactor = g * g / (4. * M_PI * alphas);
-        }
-      } else
-        gfactor = 1.;
+  // first pass: center, area, average energy density and Qs^2 product for
+  // every cutoff
+  // per cutoff: number of sites, eden, Qs2A Qs2B, x weight, y weight, weight
+  const int nFirst = 6;
+  std::vector<double> first(nFirst * nCut, 0.);
 
-      if (lat->cells[pos]->getEpsilon() * gfactor <
-          cutoff) // this is 1/fm^4, so Lambda_QCD^{-4} (because \Lambda_QCD is
-                  // roughly 1/fm)
-      {
-        weight = 0.;
-      } else {
-        //weight = lat->cells[pos]->getEpsilon() * gfactor;
-        weight = (lat->cells[pos]->getEpsilon()*lat->cells[pos]->getutau()
-                  *gfactor);
-        area += a * a;
-        sum += 1;
-        avgeden += lat->cells[pos]->getEpsilon() * hbarc * gfactor; // GeV/fm^3
-        g2mu2A = lat->cells[pos]->getg2mu2A();
-        g2mu2B = lat->cells[pos]->getg2mu2B();
-        avgQs2AQs2B += g2mu2A * param->getQsmuRatio() * param->getQsmuRatio() *
-                       g2mu2B * param->getQsmuRatioB() *
-                       param->getQsmuRatioB() / a / a / a / a;
+#pragma omp parallel
+  {
+    std::vector<double> local(nFirst * nCut, 0.);
+#pragma omp for
+    for (int pos = 0; pos < N * N; pos++) {
+      const double x = -L / 2. + a * (pos / N);
+      const double y = -L / 2. + a * (pos % N);
+      const double gfactor = gfactor_[pos];
+      eden[pos] = lat->cells[pos]->getEpsilon() * gfactor;
+      siteWeight[pos] = lat->cells[pos]->getEpsilon() *
+                        lat->cells[pos]->getutau() * gfactor;
+      const double Qs2AQs2B =
+          lat->cells[pos]->getg2mu2A() * param->getQsmuRatio() *
+          param->getQsmuRatio() * lat->cells[pos]->getg2mu2B() *
+          param->getQsmuRatioB() * param->getQsmuRatioB() / a / a / a / a;
+
+      for (int ic = 0; ic < nCut; ic++) {
+        // this is 1/fm^4, so Lambda_QCD^{-4} (because \Lambda_QCD is
+        // roughly 1/fm)
+        if (eden[pos] < cutoffs[ic])
+          continue;
+        double *s = &local[nFirst * ic];
+        s[0] += 1.;
+        s[1] += eden[pos] * hbarc; // GeV/fm^3
+        s[2] += Qs2AQs2B;
+        s[3] += x * siteWeight[pos];
+        s[4] += y * siteWeight[pos];
+        s[5] += siteWeight[pos];
       }
-      avx += x * weight;
-      avy += y * weight;
-      toteps += weight;
     }
-  }
-
-  avx /= toteps;
-  avy /= toteps;
-  avgeden /= double(sum);
-  avgQs2AQs2B /= double(sum);
-  param->setArea(area);
-
-  xshift = static_cast<int>(floor(avx / a + 0.00000000001));
-  yshift = static_cast<int>(floor(avy / a + 0.00000000001));
-
-  avcos1 = 0.;
-  avsin1 = 0.;
-  avcos = 0.;
-  avsin = 0.;
-  avcos3 = 0.;
-  avsin3 = 0.;
-  avcos4 = 0.;
-  avsin4 = 0.;
-  avcos5 = 0.;
-  avsin5 = 0.;
-  avcos6 = 0.;
-  avsin6 = 0.;
-  avr1 = 0.;
-  avrSq = 0.;
-  avxSq = 0.;
-  avySq = 0.;
-  avr3 = 0.;
-  avr4 = 0.;
-  avr5 = 0.;
-  avr6 = 0.;
-
-  for (int ix = 2; ix < N - 2; ix++) {
-    x = -L / 2. + a * ix - avx;
-    for (int iy = 2; iy < N - 2; iy++) {
-      pos = ix * N + iy;
-      y = -L / 2. + a * iy - avy;
-      if (x >= 0) {
-        phiA = atan(y / x);
-        if (x == 0) {
-          if (y >= 0)
-            phiA = M_PI / 2.;
-          else if (y < 0)
-            phiA = 3. * M_PI / 2.;
-        }
-      } else {
-        phiA = atan(y / x) + M_PI;
-      }
-
-      if (param->getRunningCoupling()) {
-        if (pos > 0 && pos < (N - 1) * N + N - 1) {
-          g2mu2A = lat->cells[pos]->getg2mu2A();
-        } else
-          g2mu2A = 0;
-
-        if (pos > 0 && pos < (N - 1) * N + N - 1) {
-          g2mu2B = lat->cells[pos]->getg2mu2B();
-        } else
-          g2mu2B = 0;
-
-        if (param->getRunWithQs() == 2) {
-          if (g2mu2A > g2mu2B)
-            Qs = sqrt(g2mu2A * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-          else
-            Qs = sqrt(g2mu2B * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-        } else if (param->getRunWithQs() == 0) {
-          if (g2mu2A < g2mu2B)
-            Qs = sqrt(g2mu2A * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-          else
-            Qs = sqrt(g2mu2B * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-        } else if (param->getRunWithQs() == 1) {
-          Qs = sqrt((g2mu2A + g2mu2B) / 2. * param->getQsmuRatio() *
-                    param->getQsmuRatio() / a / a * hbarc * hbarc *
-                    param->getg() * param->getg());
-        }
-
-        if (param->getRunWithLocalQs() == 1) {
-          // 3 flavors
-          alphas =
-              4. * M_PI /
-              (9. *
-               log(pow(pow(muZero / 0.2, 2. / c) +
-                           pow(param->getRunWithThisFactorTimesQs() * Qs / 0.2,
-                               2. / c),
-                       c)));
-          gfactor = g * g / (4. * M_PI * alphas);
-          // run with the local (in transverse plane) coupling
-        } else {
-          if (param->getRunWithQs() == 0)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQsmin() / 0.2,
-                                      2. / c),
-                              c)));
-          else if (param->getRunWithQs() == 1)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQsAvg() / 0.2,
-                                      2. / c),
-                              c)));
-          else if (param->getRunWithQs() == 2)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQs() / 0.2,
-                                      2. / c),
-                              c)));
-
-          gfactor = g * g / (4. * M_PI * alphas);
-        }
-      } else
-        gfactor = 1.;
-
-      if (lat->cells[pos]->getEpsilon() * gfactor <
-          cutoff) // this is 1/fm^4, so Lambda_QCD^{-4}
-      {
-        weight = 0.;
-      } else {
-        //weight = lat->cells[pos]->getEpsilon() * gfactor;
-        weight = (lat->cells[pos]->getEpsilon()*lat->cells[pos]->getutau()
-                  *gfactor);
-      }
-
-      rA = sqrt(x * x + y * y);
-      avr1 += rA * rA * rA * (weight);
-      avrSq += rA * rA * (weight); // compute average r^2
-      avr3 += rA * rA * rA * (weight);
-      avr4 += rA * rA * rA * rA * (weight);
-      avr5 += rA * rA * rA * rA * rA * (weight);
-      avr6 += rA * rA * rA * rA * rA * rA * (weight);
-
-      avcos1 += rA * rA * rA * cos(phiA) * (weight);
-      avsin1 += rA * rA * rA * sin(phiA) * (weight);
-      avcos += rA * rA * cos(2. * phiA) * (weight);
-      avsin += rA * rA * sin(2. * phiA) * (weight);
-      avcos3 += rA * rA * rA * cos(3. * phiA) * (weight);
-      avsin3 += rA * rA * rA * sin(3. * phiA) * (weight);
-      avcos4 += rA * rA * rA * rA * cos(4. * phiA) * (weight);
-      avsin4 += rA * rA * rA * rA * sin(4. * phiA) * (weight);
-      avcos5 += rA * rA * rA * rA * rA * cos(5. * phiA) * (weight);
-      avsin5 += rA * rA * rA * rA * rA * sin(5. * phiA) * (weight);
-      avcos6 += rA * rA * rA * rA * rA * rA * cos(6. * phiA) * (weight);
-      avsin6 += rA * rA * rA * rA * rA * rA * sin(6. * phiA) * (weight);
-
-      if (weight > cutoff && iy == N / 2 + yshift) {
-        maxX = x;
-      }
-      if (weight > cutoff && ix == N / 2 + xshift) {
-        maxY = y;
-      }
-
-      if (weight < cutoff && iy == N / 2 + yshift && ix > N / 2 + xshift &&
-          smallestX == 0) {
-        smallestX = x;
-      }
-      if (weight < cutoff && ix == N / 2 + xshift && iy > N / 2 + yshift &&
-          smallestY == 0) {
-        smallestY = y;
-      }
+#pragma omp critical
+    {
+      for (int k = 0; k < nFirst * nCut; k++)
+        first[k] += local[k];
     }
   }
 
-  // compute and print eccentricity and angles:
-  Psi1 = (atan(avsin1 / avcos1) + M_PI) / 1.;
-  Psi2 = (atan(avsin / avcos) + M_PI) / 2.;
-  Psi3 = (atan(avsin3 / avcos3) + M_PI) / 3.;
-  Psi4 = (atan(avsin4 / avcos4) + M_PI) / 4.;
-  Psi5 = (atan(avsin5 / avcos5) + M_PI) / 5.;
-  Psi6 = (atan(avsin6 / avcos6) + M_PI) / 6.;
-  eccentricity1 = sqrt(avcos1 * avcos1 + avsin1 * avsin1) / avr1;
-  eccentricity2 = sqrt(avcos * avcos + avsin * avsin) / avrSq;
-  eccentricity3 = sqrt(avcos3 * avcos3 + avsin3 * avsin3) / avr3;
-  eccentricity4 = sqrt(avcos4 * avcos4 + avsin4 * avsin4) / avr4;
-  eccentricity5 = sqrt(avcos5 * avcos5 + avsin5 * avsin5) / avr5;
-  eccentricity6 = sqrt(avcos6 * avcos6 + avsin6 * avsin6) / avr6;
-
-  double avx2 = avx;
-  double avy2 = avy;
-  avx = 0.;
-  avy = 0.;
-  toteps = 0.;
-
-  for (int ix = 0; ix < N; ix++) {
-    x = -L / 2. + a * ix - avx2;
-    for (int iy = 0; iy < N; iy++) {
-      pos = ix * N + iy;
+  std::vector<double> avx(nCut), avy(nCut);
+  for (int ic = 0; ic < nCut; ic++) {
+    avx[ic] = first[nFirst * ic + 3] / first[nFirst * ic + 5];
+    avy[ic] = first[nFirst * ic + 4] / first[nFirst * ic + 5];
+  }
 
-      if (param->getRunningCoupling()) {
-        if (pos > 0 && pos < (N - 1) * N + N - 1) {
-          g2mu2A = lat->cells[pos]->getg2mu2A();
-        } else
-          g2mu2A = 0;
+  // second pass: moments around the center. With z = x + i y,
+  // z^n = r^n e^{i n phi} gives r^n cos(n phi) and r^n sin(n phi) without
+  // any trig calls. Per cutoff: x, y, x^2, y^2 and the total weight (all
+  // sites), then the weights r^n of the harmonics n = 1..nMax (sites away
+  // from the boundary)
+  const int nSecond = 5 + nMax;
+  std::vector<double> second(nSecond * nCut, 0.);
+  std::vector<complex<double>> harmonics(nMax * nCut, 0.);
 
-        if (pos > 0 && pos < (N - 1) * N + N - 1) {
-          g2mu2B = lat->cells[pos]->getg2mu2B();
-        } else
-          g2mu2B = 0;
-
-        if (param->getRunWithQs() == 2) {
-          if (g2mu2A > g2mu2B)
-            Qs = sqrt(g2mu2A * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-          else
-            Qs = sqrt(g2mu2B * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-        } else if (param->getRunWithQs() == 0) {
-          if (g2mu2A < g2mu2B)
-            Qs = sqrt(g2mu2A * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-          else
-            Qs = sqrt(g2mu2B * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-        } else if (param->getRunWithQs() == 1) {
-          Qs = sqrt((g2mu2A + g2mu2B) / 2. * param->getQsmuRatio() *
-                    param->getQsmuRatio() / a / a * hbarc * hbarc *
-                    param->getg() * param->getg());
-        }
-
-        if (param->getRunWithLocalQs() == 1) {
-          // 3 flavors
-          alphas =
-              4. * M_PI /
-              (9. *
-               log(pow(pow(muZero / 0.2, 2. / c) +
-                           pow(param->getRunWithThisFactorTimesQs() * Qs / 0.2,
-                               2. / c),
-                       c)));
-          gfactor = g * g / (4. * M_PI * alphas);
-          // run with the local (in transverse plane) coupling
-        } else {
-          if (param->getRunWithQs() == 0)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQsmin() / 0.2,
-                                      2. / c),
-                              c)));
-          else if (param->getRunWithQs() == 1)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQsAvg() / 0.2,
-                                      2. / c),
-                              c)));
-          else if (param->getRunWithQs() == 2)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQs() / 0.2,
-                                      2. / c),
-                              c)));
-
-          gfactor = g * g / (4. * M_PI * alphas);
+#pragma omp parallel
+  {
+    std::vector<double> local(nSecond * nCut, 0.);
+    std::vector<complex<double>> localHarmonics(nMax * nCut, 0.);
+#pragma omp for
+    for (int pos = 0; pos < N * N; pos++) {
+      const int ix = pos / N;
+      const int iy = pos % N;
+      const bool inner = ix >= 2 && ix < N - 2 && iy >= 2 && iy < N - 2;
+      for (int ic = 0; ic < nCut; ic++) {
+        if (eden[pos] < cutoffs[ic])
+          continue;
+        const double weight = siteWeight[pos];
+        const double x = -L / 2. + a * ix - avx[ic];
+        const double y = -L / 2. + a * iy - avy[ic];
+        double *s = &local[nSecond * ic];
+        s[0] += x * weight;
+        s[1] += y * weight;
+        s[2] += x * x * weight;
+        s[3] += y * y * weight;
+        s[4] += weight;
+
+        if (!inner)
+          continue;
+        const double rA = sqrt(x * x + y * y);
+        const complex<double> zA(x, y);
+        complex<double> *h = &localHarmonics[nMax * ic];
+        double rn = weight;
+        complex<double> zn = weight;
+        for (int n = 1; n <= nMax; n++) {
+          rn *= rA;
+          zn *= zA;
+          // the first harmonic is weighted with r^3
+          const double extra = n == 1 ? rA * rA : 1.;
+          s[4 + n] += extra * rn;
+          h[n - 1] += extra * zn;
         }
-      } else
-        gfactor = 1.;
-
-      if (lat->cells[pos]->getEpsilon() * gfactor <
-          cutoff) // this is 1/fm^4, so Lambda_QCD^{-4}
-      {
-        weight = 0.;
-      } else {
-        //weight = lat->cells[pos]->getEpsilon() * gfactor;
-        weight = (lat->cells[pos]->getEpsilon()*lat->cells[pos]->getutau()
-                  *gfactor);
       }
-
-      y = -L / 2. + a * iy - avy2;
-      avx += x * weight;
-      avy += y * weight;
-      avxSq += x * x * weight;
-      avySq += y * y * weight;
-      toteps += weight;
     }
-  }
-  avx /= toteps;
-  avy /= toteps;
-  avxSq /= toteps;
-  avySq /= toteps;
-  avrSq /= toteps;
-  Rbar = 1. / sqrt(1. / avxSq + 1. / avySq);
-  param->setEccentricity2(eccentricity2);
-  if (it == 1)
-    param->setPsi(Psi2);
-
-  if (doAniso == 0) {
-    ofstream foutEcc(ecc_name.c_str(), ios::app);
-    foutEcc << it * a * param->getdtau() << " " << eccentricity1 << " " << Psi1
-            << " " << eccentricity2 << " " << Psi2 << " " << eccentricity3
-            << " " << Psi3 << " " << eccentricity4 << " " << Psi4 << " "
-            << eccentricity5 << " " << Psi5 << " " << eccentricity6 << " "
-            << Psi6 << " " << cutoff << " " << sqrt(avrSq) << " " << maxX << " "
-            << maxY << " " << param->getb() << " " << param->getTpp() << " "
-            << param->getArea() << " " << Rbar << " " << avgeden << " "
-            << avgQs2AQs2B * hbarc << endl;
-    foutEcc.close();
-  }
+#pragma omp critical
+    {
+      for (int k = 0; k < nSecond * nCut; k++)
+        second[k] += local[k];
+      for (int k = 0; k < nMax * nCut; k++)
+        harmonics[k] += localHarmonics[k];
+    }
+  }
+
+  std::vector<double> eccentricities(nMax + 1), planeAngles(nMax + 1);
+  for (int ic = 0; ic < nCut; ic++) {
+    const double cutoff = cutoffs[ic];
+    const double *s1 = &first[nFirst * ic];
+    const double *s2 = &second[nSecond * ic];
+    const double area = s1[0] * a * a;
+    const double avgeden = s1[1] / s1[0];
+    const double avgQs2AQs2B = s1[2] / s1[0];
+    param->setArea(area);
+
+    // compute eccentricity and angles:
+    for (int n = 1; n <= nMax; n++) {
+      const complex<double> h = harmonics[nMax * ic + n - 1];
+      planeAngles[n] = (atan(h.imag() / h.real()) + M_PI) / n;
+      eccentricities[n] = abs(h) / s2[4 + n];
+    }
+
+    // x and y extent of the region above the cutoff through the center
+    const int xshift = static_cast<int>(floor(avx[ic] / a + 0.00000000001));
+    const int yshift = static_cast<int>(floor(avy[ic] / a + 0.00000000001));
+    double maxX = 0.;
+    double maxY = 0.;
+    for (int i = 2; i < N - 2; i++) {
+      int pos = i * N + N / 2 + yshift;
+      if (N / 2 + yshift >= 2 && N / 2 + yshift < N - 2 &&
+          eden[pos] >= cutoff && siteWeight[pos] > cutoff)
+        maxX = -L / 2. + a * i - avx[ic];
+      pos = (N / 2 + xshift) * N + i;
+      if (N / 2 + xshift >= 2 && N / 2 + xshift < N - 2 &&
+          eden[pos] >= cutoff && siteWeight[pos] > cutoff)
+        maxY = -L / 2. + a * i - avy[ic];
+    }
+
+    const double avxSq = s2[2] / s2[4];
+    const double avySq = s2[3] / s2[4];
+    const double avrSq = s2[4 + 2] / s2[4];
+    const double Rbar = 1. / sqrt(1. / avxSq + 1. / avySq);
+    param->setEccentricity2(eccentricities[2]);
+    if (it == 1)
+      param->setPsi(planeAngles[2]);
+
+    if (doAniso == 0) {
+      ofstream foutEcc(ecc_name.c_str(), ios::app);
+      foutEcc << it * a * param->getdtau();
+      for (int n = 1; n <= nMax; n++)
+        foutEcc << " " << eccentricities[n] << " " << planeAngles[n];
+      foutEcc << " " << cutoff << " " << sqrt(avrSq) << " " << maxX << " "
+              << maxY << " " << param->getb() << " " << param->getTpp() << " "
+              << param->getArea() << " " << Rbar << " " << avgeden << " "
+              << avgQs2AQs2B * hbarc << endl;
+      foutEcc.close();
+    }
+  }
+  const double Psi2 = planeAngles[2];
+  int pos;
 
   if (doAniso == 1) {
     stringstream straniso_name;
@@ -2211,16 +2045,14 @@ int Evolution::multiplicity(Lattice *lat, Group *group, Parameters *param,
                             int it) {
   int N = param->getSize();
   int Nc = param->getNc();
-  int npos, pos;
+  int pos;
   double L = param->getL();
   double a = L / N; // lattice spacing in fm
-  double kx, ky, kt2, omega2;
   double g = param->getg();
   int nn[2];
   nn[0] = N;
   nn[1] = N;
   double dtau = param->getdtau();
-  double nkt;
   const int bins = 100;
   double n[bins];  // k_T array
   double E[bins];  // k_T array
@@ -2243,8 +2075,8 @@ int Evolution::multiplicity(Lattice *lat, Group *group, Parameters *param,
   NpartdNdy_name = strNpartdNdy_name.str();
   cout << "Measuring multiplicity ... " << endl;
 
-  // fix transverse Coulomb gauge
-  GaugeFix gaugefix;
+  // fix transverse Coulomb gauge (starting from the gauge of the previous
+  // measurement, which the live lattice still carries)
 
   double maxtime;
   if (param->getInverseQsForMaxTime() == 1) {
@@ -2256,7 +2088,7 @@ int Evolution::multiplicity(Lattice *lat, Group *group, Parameters *param,
 
   int itmax = static_cast<int>(floor(maxtime / (a * dtau) + 1e-10));
 
-  gaugefix.FFTChi(fft, lat, group, param, 4000);
+  gaugefix.fixCoulombGauge(fft, lat, group, param, 4000);
   // gauge is fixed
 
   Matrix **E1;
@@ -2266,7 +2098,7 @@ int Evolution::multiplicity(Lattice *lat, Group *group, Parameters *param,
     E1[i] = new Matrix(Nc, 0.);
   }
 
-  double g2mu2A, g2mu2B, gfactor, alphas = 0., Qs = 0.;
+  double gfactor;
   double c = param->getc();
   double muZero = param->getMuZero();
 
@@ -2274,79 +2106,7 @@ int Evolution::multiplicity(Lattice *lat, Group *group, Parameters *param,
     for (int j = 0; j < N; j++) {
       pos = i * N + j;
 
-      if (param->getRunningCoupling()) {
-
-        if (pos > 0 && pos < (N - 1) * N + N - 1) {
-          g2mu2A = lat->cells[pos]->getg2mu2A();
-        } else
-          g2mu2A = 0;
-
-        if (pos > 0 && pos < (N - 1) * N + N - 1) {
-          g2mu2B = lat->cells[pos]->getg2mu2B();
-        } else
-          g2mu2B = 0;
-
-        if (param->getRunWithQs() == 2) {
-          if (g2mu2A > g2mu2B)
-            Qs = sqrt(g2mu2A * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-          else
-            Qs = sqrt(g2mu2B * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-        } else if (param->getRunWithQs() == 0) {
-          if (g2mu2A < g2mu2B)
-            Qs = sqrt(g2mu2A * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-          else
-            Qs = sqrt(g2mu2B * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-        } else if (param->getRunWithQs() == 1) {
-          Qs = sqrt((g2mu2A + g2mu2B) / 2. * param->getQsmuRatio() *
-                    param->getQsmuRatio() / a / a * hbarc * hbarc *
-                    param->getg() * param->getg());
-        }
-
-        if (param->getRunWithLocalQs() == 1) {
-          // 3 flavors
-          alphas =
-              4. * M_PI /
-              (9. *
-               log(pow(pow(muZero / 0.2, 2. / c) +
-                           pow(param->getRunWithThisFactorTimesQs() * Qs / 0.2,
-                               2. / c),
-                       c)));
-          gfactor = g * g / (4. * M_PI * alphas);
-          // run with the local (in transverse plane) coupling
-        } else {
-          if (param->getRunWithQs() == 0)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQsmin() / 0.2,
-                                      2. / c),
-                              c)));
-          else if (param->getRunWithQs() == 1)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQsAvg() / 0.2,
-                                      2. / c),
-                              c)));
-          else if (param->getRunWithQs() == 2)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQs() / 0.2,
-                                      2. / c),
-                              c)));
-
-          gfactor = g * g / (4. * M_PI * alphas);
-        }
-      } else
-        gfactor = 1.;
+      gfactor = gfactor_[pos];
 
       if (param->getRunWithkt() == 0) {
         *E1[pos] = lat->cells[pos]->getE1() *
@@ -2368,11 +2128,13 @@ int Evolution::multiplicity(Lattice *lat, Group *group, Parameters *param,
     counter[ik] = 0;
   }
 
+  // k_T and bin of every mode
+  const KtSpectrum spectrum(N, bins, dkt);
+
   const int hbins = 2000;
   // double Nh[hbins+1], Eh[hbins+1], Ehgsl[hbins+1], NhL[hbins+1],
   // NhLgsl[hbins+1], NhH[hbins+1], NhHgsl[hbins+1];
   double Nhgsl[hbins + 1];
-  double Ng;
   // for (int ih=0; ih<=hbins; ih++)
   //   {
   //     Nh[ih]=0.;
@@ -2381,57 +2143,10 @@ int Evolution::multiplicity(Lattice *lat, Group *group, Parameters *param,
   //     NhH[ih]=0.;
   //   }
 
-  for (int i = 0; i < N; i++) {
-    for (int j = 0; j < N; j++) {
-      nkt = 0.;
-      pos = i * N + j;
-      npos = (N - i) * N + (N - j);
-
-      kx = 2. * M_PI * (-0.5 + static_cast<double>(i) / static_cast<double>(N));
-      ky = 2. * M_PI * (-0.5 + static_cast<double>(j) / static_cast<double>(N));
-      kt2 = 4. * (sin(kx / 2.) * sin(kx / 2.) + sin(ky / 2.) * sin(ky / 2.)); //
-      omega2 =
-          4. *
-          (sin(kx / 2.) * sin(kx / 2.) +
-           sin(ky / 2.) *
-               sin(ky /
-                   2.)); // lattice dispersion relation (this is omega squared)
-      if (i != 0 && j != 0) {
-        if (omega2 != 0) {
-          nkt = 2. / sqrt(omega2) / static_cast<double>(N * N) *
-                (g * g / ((it - 0.5) * dtau) *
-                 ((((*E1[pos]) * (*E1[npos])).trace()).real()));
-          if (param->getRunWithkt() == 1) {
-            nkt *= g * g /
-                   (4. * M_PI * 4. * M_PI /
-                    (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                      pow(param->getRunWithThisFactorTimesQs() *
-                                              sqrt(kt2) * hbarc / a / 0.2,
-                                          2. / c),
-                                  c))));
-          }
-        }
-
-        dNdeta += nkt;
-        dEdeta += nkt * sqrt(omega2) * hbarc / a;
-
-        for (int ik = 0; ik < bins; ik++) {
-          if (abs(sqrt(kt2)) > ik * dkt && abs(sqrt(kt2)) <= (ik + 1) * dkt) {
-            n[ik] += nkt / dkt / 2 / M_PI / sqrt(kt2) * 2 * M_PI * sqrt(kt2) *
-                     dkt * N * N / M_PI / M_PI / 2. / 2.;
-            E[ik] += sqrt(omega2) * hbarc / a * nkt / dkt / 2 / M_PI /
-                     sqrt(kt2) * 2 * M_PI * sqrt(kt2) * dkt * N * N / M_PI /
-                     M_PI / 2. / 2.;
-            n2[ik] += nkt / dkt / 2 / M_PI / sqrt(kt2);
-            // dividing by bin size; bin is dkt times Jacobian k(=ik*dkt) times
-            // 2Pi in phi times the correct number of counts for an infinite
-            // lattice: area in bin divided by total area
-            counter[ik] += 1; // number of entries in n[ik]
-          }
-        }
-      }
-    }
-  }
+  binSpectrum(spectrum, E1, g * g / ((it - 0.5) * dtau), param, n, E, n2,
+              dNdeta, dEdeta);
+  for (int ik = 0; ik < bins; ik++)
+    counter[ik] = spectrum.count(ik); // number of entries in n[ik]
 
   /// -------- 2 ---------
 
@@ -2439,79 +2154,7 @@ int Evolution::multiplicity(Lattice *lat, Group *group, Parameters *param,
     for (int j = 0; j < N; j++) {
       pos = i * N + j;
 
-      if (param->getRunningCoupling()) {
-
-        if (pos > 0 && pos < (N - 1) * N + N - 1) {
-          g2mu2A = lat->cells[pos]->getg2mu2A();
-        } else
-          g2mu2A = 0;
-
-        if (pos > 0 && pos < (N - 1) * N + N - 1) {
-          g2mu2B = lat->cells[pos]->getg2mu2B();
-        } else
-          g2mu2B = 0;
-
-        if (param->getRunWithQs() == 2) {
-          if (g2mu2A > g2mu2B)
-            Qs = sqrt(g2mu2A * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-          else
-            Qs = sqrt(g2mu2B * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-        } else if (param->getRunWithQs() == 0) {
-          if (g2mu2A < g2mu2B)
-            Qs = sqrt(g2mu2A * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-          else
-            Qs = sqrt(g2mu2B * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-        } else if (param->getRunWithQs() == 1) {
-          Qs = sqrt((g2mu2A + g2mu2B) / 2. * param->getQsmuRatio() *
-                    param->getQsmuRatio() / a / a * hbarc * hbarc *
-                    param->getg() * param->getg());
-        }
-
-        if (param->getRunWithLocalQs() == 1) {
-          // 3 flavors
-          alphas =
-              4. * M_PI /
-              (9. *
-               log(pow(pow(muZero / 0.2, 2. / c) +
-                           pow(param->getRunWithThisFactorTimesQs() * Qs / 0.2,
-                               2. / c),
-                       c)));
-          gfactor = g * g / (4. * M_PI * alphas);
-          // run with the local (in transverse plane) coupling
-        } else {
-          if (param->getRunWithQs() == 0)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQsmin() / 0.2,
-                                      2. / c),
-                              c)));
-          else if (param->getRunWithQs() == 1)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQsAvg() / 0.2,
-                                      2. / c),
-                              c)));
-          else if (param->getRunWithQs() == 2)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQs() / 0.2,
-                                      2. / c),
-                              c)));
-
-          gfactor = g * g / (4. * M_PI * alphas);
-        }
-      } else
-        gfactor = 1.;
+      gfactor = gfactor_[pos];
 
       if (param->getRunWithkt() == 0) {
         *E1[pos] = lat->cells[pos]->getE2() * sqrt(gfactor); // "
@@ -2523,59 +2166,8 @@ int Evolution::multiplicity(Lattice *lat, Group *group, Parameters *param,
 
   fft->fftn(E1, E1, nn, 1);
 
-  for (int i = 0; i < N; i++) {
-    for (int j = 0; j < N; j++) {
-      nkt = 0.;
-      pos = i * N + j;
-      npos = (N - i) * N + (N - j);
-
-      kx = 2. * M_PI * (-0.5 + static_cast<double>(i) / static_cast<double>(N));
-      ky = 2. * M_PI * (-0.5 + static_cast<double>(j) / static_cast<double>(N));
-      kt2 = 4. * (sin(kx / 2.) * sin(kx / 2.) + sin(ky / 2.) * sin(ky / 2.)); //
-      omega2 =
-          4. *
-          (sin(kx / 2.) * sin(kx / 2.) +
-           sin(ky / 2.) *
-               sin(ky /
-                   2.)); // lattice dispersion relation (this is omega squared)
-
-      // i=0 or j=0 have no negative k_T value available
-
-      if (i != 0 && j != 0) {
-        if (omega2 != 0) {
-          nkt = 2. / sqrt(omega2) / static_cast<double>(N * N) *
-                (g * g / ((it - 0.5) * dtau) *
-                 (((((*E1[pos]) * (*E1[npos])).trace()).real())));
-          if (param->getRunWithkt() == 1) {
-            nkt *= g * g /
-                   (4. * M_PI * 4. * M_PI /
-                    (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                      pow(param->getRunWithThisFactorTimesQs() *
-                                              sqrt(kt2) * hbarc / a / 0.2,
-                                          2. / c),
-                                  c))));
-          }
-        }
-
-        dNdeta += nkt;
-        dEdeta += nkt * sqrt(omega2) * hbarc / a;
-
-        for (int ik = 0; ik < bins; ik++) {
-          if (abs(sqrt(kt2)) > ik * dkt && abs(sqrt(kt2)) <= (ik + 1) * dkt) {
-            n[ik] += nkt / dkt / 2 / M_PI / sqrt(kt2) * 2 * M_PI * sqrt(kt2) *
-                     dkt * N * N / M_PI / M_PI / 2. / 2.;
-            E[ik] += sqrt(omega2) * hbarc / a * nkt / dkt / 2 / M_PI /
-                     sqrt(kt2) * 2 * M_PI * sqrt(kt2) * dkt * N * N / M_PI /
-                     M_PI / 2. / 2.;
-            n2[ik] += nkt / dkt / 2 / M_PI / sqrt(kt2);
-            // dividing by bin size; bin is dkt times Jacobian k(=ik*dkt) times
-            // 2Pi in phi times the correct number of counts for an infinite
-            // lattice: area in bin divided by total area
-          }
-        }
-      }
-    }
-  }
+  binSpectrum(spectrum, E1, g * g / ((it - 0.5) * dtau), param, n, E, n2,
+              dNdeta, dEdeta);
 
   /// ------3 --------
 
@@ -2583,79 +2175,7 @@ int Evolution::multiplicity(Lattice *lat, Group *group, Parameters *param,
     for (int j = 0; j < N; j++) {
       pos = i * N + j;
 
-      if (param->getRunningCoupling()) {
-
-        if (pos > 0 && pos < (N - 1) * N + N - 1) {
-          g2mu2A = lat->cells[pos]->getg2mu2A();
-        } else
-          g2mu2A = 0;
-
-        if (pos > 0 && pos < (N - 1) * N + N - 1) {
-          g2mu2B = lat->cells[pos]->getg2mu2B();
-        } else
-          g2mu2B = 0;
-
-        if (param->getRunWithQs() == 2) {
-          if (g2mu2A > g2mu2B)
-            Qs = sqrt(g2mu2A * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-          else
-            Qs = sqrt(g2mu2B * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-        } else if (param->getRunWithQs() == 0) {
-          if (g2mu2A < g2mu2B)
-            Qs = sqrt(g2mu2A * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-          else
-            Qs = sqrt(g2mu2B * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-        } else if (param->getRunWithQs() == 1) {
-          Qs = sqrt((g2mu2A + g2mu2B) / 2. * param->getQsmuRatio() *
-                    param->getQsmuRatio() / a / a * hbarc * hbarc *
-                    param->getg() * param->getg());
-        }
-
-        if (param->getRunWithLocalQs() == 1) {
-          // 3 flavors
-          alphas =
-              4. * M_PI /
-              (9. *
-               log(pow(pow(muZero / 0.2, 2. / c) +
-                           pow(param->getRunWithThisFactorTimesQs() * Qs / 0.2,
-                               2. / c),
-                       c)));
-          gfactor = g * g / (4. * M_PI * alphas);
-          // run with the local (in transverse plane) coupling
-        } else {
-          if (param->getRunWithQs() == 0)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQsmin() / 0.2,
-                                      2. / c),
-                              c)));
-          else if (param->getRunWithQs() == 1)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQsAvg() / 0.2,
-                                      2. / c),
-                              c)));
-          else if (param->getRunWithQs() == 2)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQs() / 0.2,
-                                      2. / c),
-                              c)));
-
-          gfactor = g * g / (4. * M_PI * alphas);
-        }
-      } else
-        gfactor = 1.;
+      gfactor = gfactor_[pos];
 
       if (param->getRunWithkt() == 0) {
         *E1[pos] =
@@ -2671,59 +2191,8 @@ int Evolution::multiplicity(Lattice *lat, Group *group, Parameters *param,
   // do Fourier transforms
   fft->fftn(E1, E1, nn, 1);
 
-  for (int i = 0; i < N; i++) {
-    for (int j = 0; j < N; j++) {
-      nkt = 0.;
-      pos = i * N + j;
-      npos = (N - i) * N + (N - j);
-
-      kx = 2. * M_PI * (-0.5 + static_cast<double>(i) / static_cast<double>(N));
-      ky = 2. * M_PI * (-0.5 + static_cast<double>(j) / static_cast<double>(N));
-      kt2 = 4. * (sin(kx / 2.) * sin(kx / 2.) + sin(ky / 2.) * sin(ky / 2.)); //
-      omega2 =
-          4. *
-          (sin(kx / 2.) * sin(kx / 2.) +
-           sin(ky / 2.) *
-               sin(ky /
-                   2.)); // lattice dispersion relation (this is omega squared)
-
-      // i=0 or j=0 have no negative k_T value available
-
-      if (i != 0 && j != 0) {
-        if (omega2 != 0) {
-          nkt = 2. / sqrt(omega2) / static_cast<double>(N * N) *
-                (((it - 0.5) * dtau) *
-                 ((((*E1[pos]) * (*E1[npos])).trace()).real()));
-          if (param->getRunWithkt() == 1) {
-            nkt *= g * g /
-                   (4. * M_PI * 4. * M_PI /
-                    (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                      pow(param->getRunWithThisFactorTimesQs() *
-                                              sqrt(kt2) * hbarc / a / 0.2,
-                                          2. / c),
-                                  c))));
-          }
-        }
-
-        dNdeta += nkt;
-        dEdeta += nkt * sqrt(omega2) * hbarc / a;
-
-        for (int ik = 0; ik < bins; ik++) {
-          if (abs(sqrt(kt2)) > ik * dkt && abs(sqrt(kt2)) <= (ik + 1) * dkt) {
-            n[ik] += nkt / dkt / 2 / M_PI / sqrt(kt2) * 2 * M_PI * sqrt(kt2) *
-                     dkt * N * N / M_PI / M_PI / 2. / 2.;
-            E[ik] += sqrt(omega2) * hbarc / a * nkt / dkt / 2 / M_PI /
-                     sqrt(kt2) * 2 * M_PI * sqrt(kt2) * dkt * N * N / M_PI /
-                     M_PI / 2. / 2.;
-            n2[ik] += nkt / dkt / 2 / M_PI / sqrt(kt2);
-            // dividing by bin size; bin is dkt times Jacobian k(=ik*dkt) times
-            // 2Pi in phi times the correct number of counts for an infinite
-            // lattice: area in bin divided by total area
-          }
-        }
-      }
-    }
-  }
+  binSpectrum(spectrum, E1, (it - 0.5) * dtau, param, n, E, n2, dNdeta,
+              dEdeta);
 
   double m, P;
   m = param->getJacobianm();                               // in GeV
@@ -2804,90 +2273,7 @@ int Evolution::multiplicity(Lattice *lat, Group *group, Parameters *param,
   // compute hadrons using fragmentation function
   if (it == itmax && param->getWriteOutputs() == 3) {
     cout << " Hadronizing ... " << endl;
-    double z, frac;
-    double mypt, kt;
-    int ik;
-    const int steps = 6000;
-    double dz = 0.95 / static_cast<double>(steps);
-    double zValues[steps + 1];
-    double zintegrand[steps + 1];
-    // double Ezintegrand[steps+1];
-    // double Lzintegrand[steps+1];
-    // double Hzintegrand[steps+1];
-    gsl_interp_accel *zacc = gsl_interp_accel_alloc();
-    gsl_spline *zspline = gsl_spline_alloc(gsl_interp_cspline, steps + 1);
-
-    for (int ih = 0; ih <= hbins; ih++) {
-
-      mypt = ih * (20. / static_cast<double>(hbins));
-
-      for (int iz = 0; iz <= steps; iz++) {
-        z = 0.05 + iz * dz;
-        zValues[iz] = z;
-
-        kt = mypt / z;
-
-        ik = static_cast<int>(floor(kt * a / hbarc / dkt - 0.5 + 0.00000001));
-
-        frac = (kt - (ik + 0.5) * dkt / a * hbarc) / (dkt / a * hbarc);
-
-        if (ik + 1 < bins && ik >= 0)
-          Ng = ((1. - frac) * n[ik] + frac * n[ik + 1]) * a / hbarc * a /
-               hbarc; // to make dN/d^2k_T fo k_T in GeV
-        else
-          Ng = 0.;
-
-        if (param->getUsePseudoRapidity() == 0) {
-          zintegrand[iz] = 1. / (z * z) * Ng * kkp(7, 1, z, kt);
-          // Ezintegrand[iz] = mypt * 1./(z*z) * Ng * kkp(7,1,z,kt);
-          // Lzintegrand[iz] = 1./(z*z) * Ng * kkp(7,1,z,kt/2.);
-          // Hzintegrand[iz] = 1./(z*z) * Ng * kkp(7,1,z,kt*2.);
-        } else {
-          zintegrand[iz] = 1. / (z * z) * Ng * 2. *
-                           (kkp(1, 1, z, kt) * cosh(param->getRapidity()) /
-                                (sqrt(pow(cosh(param->getRapidity()), 2.) +
-                                      m_pion * m_pion / (mypt * mypt))) +
-                            kkp(2, 1, z, kt) * cosh(param->getRapidity()) /
-                                (sqrt(pow(cosh(param->getRapidity()), 2.) +
-                                      m_kaon * m_kaon / (mypt * mypt))) +
-                            kkp(4, 1, z, kt) * cosh(param->getRapidity()) /
-                                (sqrt(pow(cosh(param->getRapidity()), 2.) +
-                                      m_proton * m_proton / (mypt * mypt))));
-
-          // Ezintegrand[iz] =  mypt * 1./(z*z) * Ng *
-          // 	2. *
-          // (kkp(1,1,z,kt)*cosh(param->getRapidity())/(sqrt(pow(cosh(param->getRapidity()),2.)+m_pion*m_pion/(mypt*mypt)))
-          // 	      +kkp(2,1,z,kt)*cosh(param->getRapidity())/(sqrt(pow(cosh(param->getRapidity()),2.)+m_kaon*m_kaon/(mypt*mypt)))
-          // 	      +kkp(4,1,z,kt)*cosh(param->getRapidity())/(sqrt(pow(cosh(param->getRapidity()),2.)+m_proton*m_proton/(mypt*mypt))));
-
-          // Lzintegrand[iz] =  1./(z*z) * Ng *
-          // 	2. *
-          // (kkp(1,1,z,kt/2.)*cosh(param->getRapidity())/(sqrt(pow(cosh(param->getRapidity()),2.)+m_pion*m_pion/(mypt*mypt)))
-          // 	      +kkp(2,1,z,kt/2.)*cosh(param->getRapidity())/(sqrt(pow(cosh(param->getRapidity()),2.)+m_kaon*m_kaon/(mypt*mypt)))
-          // 	      +kkp(4,1,z,kt/2.)*cosh(param->getRapidity())/(sqrt(pow(cosh(param->getRapidity()),2.)+m_proton*m_proton/(mypt*mypt))));
-
-          // Hzintegrand[iz] =  1./(z*z) * Ng *
-          // 	2. *
-          // (kkp(1,1,z,kt*2.)*cosh(param->getRapidity())/(sqrt(pow(cosh(param->getRapidity()),2.)+m_pion*m_pion/(mypt*mypt)))
-          // 	      +kkp(2,1,z,kt*2.)*cosh(param->getRapidity())/(sqrt(pow(cosh(param->getRapidity()),2.)+m_kaon*m_kaon/(mypt*mypt)))
-          // 	      +kkp(4,1,z,kt*2.)*cosh(param->getRapidity())/(sqrt(pow(cosh(param->getRapidity()),2.)+m_proton*m_proton/(mypt*mypt))));
-        }
-      }
-
-      zValues[steps] = 1.; // set exactly 1
-
-      gsl_spline_init(zspline, zValues, zintegrand, steps + 1);
-      Nhgsl[ih] = gsl_spline_eval_integ(zspline, 0.05, 1., zacc);
-
-      //	  gsl_spline_init (zspline, zValues, Lzintegrand, steps+1);
-      // NhLgsl[ih] = gsl_spline_eval_integ(zspline, 0.05, 1., zacc);
-
-      // gsl_spline_init (zspline, zValues, Hzintegrand, steps+1);
-      // NhHgsl[ih] = gsl_spline_eval_integ(zspline, 0.05, 1., zacc);
-    }
-
-    gsl_spline_free(zspline);
-    gsl_interp_accel_free(zacc);
+    hadronize(n, bins, dkt, param, hbins, Nhgsl);
 
     stringstream strmultHad_name;
     strmultHad_name << "multiplicityHadrons" << param->getEventId() << ".dat";
@@ -3005,16 +2391,15 @@ int Evolution::multiplicitynkxky(Lattice *lat, Group *group, Parameters *param,
                                  int it) {
   const int N = param->getSize();
   const int Nc = param->getNc();
-  int npos, pos;
+  int pos;
   double L = param->getL();
   double a = L / N; // lattice spacing in fm
-  double kx, ky, kt2, omega2;
+  double kx, ky;
   double g = param->getg();
   int nn[2];
   nn[0] = N;
   nn[1] = N;
   double dtau = param->getdtau();
-  double nkt;
   const int bins = 100;
   double n[bins];  // k_T array
   double E[bins];  // k_T array
@@ -3063,8 +2448,8 @@ int Evolution::multiplicitynkxky(Lattice *lat, Group *group, Parameters *param,
 
   cout << "Measuring multiplicity ... " << endl;
 
-  // fix transverse Coulomb gauge
-  GaugeFix gaugefix;
+  // fix transverse Coulomb gauge (starting from the gauge of the previous
+  // measurement, which the live lattice still carries)
 
   double maxtime;
   if (param->getInverseQsForMaxTime() == 1) {
@@ -3076,7 +2461,7 @@ int Evolution::multiplicitynkxky(Lattice *lat, Group *group, Parameters *param,
 
   int itmax = static_cast<int>(floor(maxtime / (a * dtau) + 1e-10));
 
-  gaugefix.FFTChi(fft, lat, group, param, 4000);
+  gaugefix.fixCoulombGauge(fft, lat, group, param, 4000);
   // gauge is fixed
 
   Matrix **E1;
@@ -3086,7 +2471,7 @@ int Evolution::multiplicitynkxky(Lattice *lat, Group *group, Parameters *param,
     E1[i] = new Matrix(Nc, 0.);
   }
 
-  double g2mu2A, g2mu2B, gfactor, alphas = 0., Qs = 0.;
+  double gfactor;
   double c = param->getc();
   double muZero = param->getMuZero();
 
@@ -3094,79 +2479,7 @@ int Evolution::multiplicitynkxky(Lattice *lat, Group *group, Parameters *param,
     for (int j = 0; j < N; j++) {
       pos = i * N + j;
 
-      if (param->getRunningCoupling()) {
-
-        if (pos > 0 && pos < (N - 1) * N + N - 1) {
-          g2mu2A = lat->cells[pos]->getg2mu2A();
-        } else
-          g2mu2A = 0;
-
-        if (pos > 0 && pos < (N - 1) * N + N - 1) {
-          g2mu2B = lat->cells[pos]->getg2mu2B();
-        } else
-          g2mu2B = 0;
-
-        if (param->getRunWithQs() == 2) {
-          if (g2mu2A > g2mu2B)
-            Qs = sqrt(g2mu2A * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-          else
-            Qs = sqrt(g2mu2B * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-        } else if (param->getRunWithQs() == 0) {
-          if (g2mu2A < g2mu2B)
-            Qs = sqrt(g2mu2A * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-          else
-            Qs = sqrt(g2mu2B * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-        } else if (param->getRunWithQs() == 1) {
-          Qs = sqrt((g2mu2A + g2mu2B) / 2. * param->getQsmuRatio() *
-                    param->getQsmuRatio() / a / a * hbarc * hbarc *
-                    param->getg() * param->getg());
-        }
-
-        if (param->getRunWithLocalQs() == 1) {
-          // 3 flavors
-          alphas =
-              4. * M_PI /
-              (9. *
-               log(pow(pow(muZero / 0.2, 2. / c) +
-                           pow(param->getRunWithThisFactorTimesQs() * Qs / 0.2,
-                               2. / c),
-                       c)));
-          gfactor = g * g / (4. * M_PI * alphas);
-          // run with the local (in transverse plane) coupling
-        } else {
-          if (param->getRunWithQs() == 0)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQsmin() / 0.2,
-                                      2. / c),
-                              c)));
-          else if (param->getRunWithQs() == 1)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQsAvg() / 0.2,
-                                      2. / c),
-                              c)));
-          else if (param->getRunWithQs() == 2)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQs() / 0.2,
-                                      2. / c),
-                              c)));
-
-          gfactor = g * g / (4. * M_PI * alphas);
-        }
-      } else
-        gfactor = 1.;
+      gfactor = gfactor_[pos];
 
       if (param->getRunWithkt() == 0) {
         *E1[pos] = lat->cells[pos]->getE1() *
@@ -3188,11 +2501,14 @@ int Evolution::multiplicitynkxky(Lattice *lat, Group *group, Parameters *param,
     counter[ik] = 0;
   }
 
+  // k_T and bin of every mode
+  const KtSpectrum spectrum(N, bins, dkt);
+
   const int hbins = 2000;
 
   //  double Nh[hbins+1], Eh[hbins+1], Ehgsl[hbins+1], NhL[hbins+1],
   //  NhLgsl[hbins+1], NhH[hbins+1], NhHgsl[hbins+1];
-  double Nhgsl[hbins + 1], Ng;
+  double Nhgsl[hbins + 1];
   // for (int ih=0; ih<=hbins; ih++)
   //   {
   //     Nh[ih]=0.;
@@ -3210,63 +2526,10 @@ int Evolution::multiplicitynkxky(Lattice *lat, Group *group, Parameters *param,
     }
   }
 
-  for (int i = 0; i < N; i++) {
-    for (int j = 0; j < N; j++) {
-      nkt = 0.;
-      pos = i * N + j;
-      npos = (N - i) * N + (N - j);
-
-      kx = 2. * M_PI * (-0.5 + static_cast<double>(i) / static_cast<double>(N));
-      ky = 2. * M_PI * (-0.5 + static_cast<double>(j) / static_cast<double>(N));
-      kt2 = 4. * (sin(kx / 2.) * sin(kx / 2.) + sin(ky / 2.) * sin(ky / 2.)); //
-      omega2 =
-          4. *
-          (sin(kx / 2.) * sin(kx / 2.) +
-           sin(ky / 2.) *
-               sin(ky /
-                   2.)); // lattice dispersion relation (this is omega squared)
-
-      // i=0 or j=0 have no negative k_T value available
-
-      if (i != 0 && j != 0) {
-        if (omega2 != 0) {
-          nkt = 2. / sqrt(omega2) / static_cast<double>(N * N) *
-                (g * g / ((it - 0.5) * dtau) *
-                 ((((*E1[pos]) * (*E1[npos])).trace()).real()));
-          if (param->getRunWithkt() == 1) {
-            nkt *= g * g /
-                   (4. * M_PI * 4. * M_PI /
-                    (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                      pow(param->getRunWithThisFactorTimesQs() *
-                                              sqrt(kt2) * hbarc / a / 0.2,
-                                          2. / c),
-                                  c))));
-          }
-        }
-
-        dNdeta += nkt;
-        dEdeta += nkt * sqrt(omega2) * hbarc / a;
-
-        for (int ik = 0; ik < bins; ik++) {
-          if (abs(sqrt(kt2)) > ik * dkt && abs(sqrt(kt2)) <= (ik + 1) * dkt) {
-            n[ik] += nkt / dkt / 2 / M_PI / sqrt(kt2) * 2 * M_PI * sqrt(kt2) *
-                     dkt * N * N / M_PI / M_PI / 2. / 2.;
-            E[ik] += sqrt(omega2) * hbarc / a * nkt / dkt / 2 / M_PI /
-                     sqrt(kt2) * 2 * M_PI * sqrt(kt2) * dkt * N * N / M_PI /
-                     M_PI / 2. / 2.;
-            n2[ik] += nkt / dkt / 2 / M_PI / sqrt(kt2);
-            // dividing by bin size; bin is dkt times Jacobian k(=ik*dkt) times
-            // 2Pi in phi times the correct number of counts for an infinite
-            // lattice: area in bin divided by total area
-            counter[ik] += 1; // number of entries in n[ik]
-          }
-        }
-      }
-      if (i != 0 && j != 0) {
-        Nkxky[pos] = nkt * N * N / M_PI / M_PI / 2. / 2.;
-      }
-    }
-  }
+  binSpectrum(spectrum, E1, g * g / ((it - 0.5) * dtau), param, n, E, n2,
+              dNdeta, dEdeta, &Nkxky[0]);
+  for (int ik = 0; ik < bins; ik++)
+    counter[ik] = spectrum.count(ik); // number of entries in n[ik]
 
   /// -------- 2 ---------
 
@@ -3274,79 +2537,7 @@ int Evolution::multiplicitynkxky(Lattice *lat, Group *group, Parameters *param,
     for (int j = 0; j < N; j++) {
       pos = i * N + j;
 
-      if (param->getRunningCoupling()) {
-
-        if (pos > 0 && pos < (N - 1) * N + N - 1) {
-          g2mu2A = lat->cells[pos]->getg2mu2A();
-        } else
-          g2mu2A = 0;
-
-        if (pos > 0 && pos < (N - 1) * N + N - 1) {
-          g2mu2B = lat->cells[pos]->getg2mu2B();
-        } else
-          g2mu2B = 0;
-
-        if (param->getRunWithQs() == 2) {
-          if (g2mu2A > g2mu2B)
-            Qs = sqrt(g2mu2A * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-          else
-            Qs = sqrt(g2mu2B * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-        } else if (param->getRunWithQs() == 0) {
-          if (g2mu2A < g2mu2B)
-            Qs = sqrt(g2mu2A * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-          else
-            Qs = sqrt(g2mu2B * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-        } else if (param->getRunWithQs() == 1) {
-          Qs = sqrt((g2mu2A + g2mu2B) / 2. * param->getQsmuRatio() *
-                    param->getQsmuRatio() / a / a * hbarc * hbarc *
-                    param->getg() * param->getg());
-        }
-
-        if (param->getRunWithLocalQs() == 1) {
-          // 3 flavors
-          alphas =
-              4. * M_PI /
-              (9. *
-               log(pow(pow(muZero / 0.2, 2. / c) +
-                           pow(param->getRunWithThisFactorTimesQs() * Qs / 0.2,
-                               2. / c),
-                       c)));
-          gfactor = g * g / (4. * M_PI * alphas);
-          // run with the local (in transverse plane) coupling
-        } else {
-          if (param->getRunWithQs() == 0)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQsmin() / 0.2,
-                                      2. / c),
-                              c)));
-          else if (param->getRunWithQs() == 1)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQsAvg() / 0.2,
-                                      2. / c),
-                              c)));
-          else if (param->getRunWithQs() == 2)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQs() / 0.2,
-                                      2. / c),
-                              c)));
-
-          gfactor = g * g / (4. * M_PI * alphas);
-        }
-      } else
-        gfactor = 1.;
+      gfactor = gfactor_[pos];
 
       if (param->getRunWithkt() == 0) {
         *E1[pos] = lat->cells[pos]->getE2() * sqrt(gfactor); // "
@@ -3358,62 +2549,8 @@ int Evolution::multiplicitynkxky(Lattice *lat, Group *group, Parameters *param,
 
   fft->fftn(E1, E1, nn, 1);
 
-  for (int i = 0; i < N; i++) {
-    for (int j = 0; j < N; j++) {
-      nkt = 0.;
-      pos = i * N + j;
-      npos = (N - i) * N + (N - j);
-
-      kx = 2. * M_PI * (-0.5 + static_cast<double>(i) / static_cast<double>(N));
-      ky = 2. * M_PI * (-0.5 + static_cast<double>(j) / static_cast<double>(N));
-      kt2 = 4. * (sin(kx / 2.) * sin(kx / 2.) + sin(ky / 2.) * sin(ky / 2.)); //
-      omega2 =
-          4. *
-          (sin(kx / 2.) * sin(kx / 2.) +
-           sin(ky / 2.) *
-               sin(ky /
-                   2.)); // lattice dispersion relation (this is omega squared)
-
-      // i=0 or j=0 have no negative k_T value available
-
-      if (i != 0 && j != 0) {
-        if (omega2 != 0) {
-          nkt = 2. / sqrt(omega2) / static_cast<double>(N * N) *
-                (g * g / ((it - 0.5) * dtau) *
-                 (((((*E1[pos]) * (*E1[npos])).trace()).real())));
-          if (param->getRunWithkt() == 1) {
-            nkt *= g * g /
-                   (4. * M_PI * 4. * M_PI /
-                    (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                      pow(param->getRunWithThisFactorTimesQs() *
-                                              sqrt(kt2) * hbarc / a / 0.2,
-                                          2. / c),
-                                  c))));
-          }
-        }
-
-        dNdeta += nkt;
-        dEdeta += nkt * sqrt(omega2) * hbarc / a;
-
-        for (int ik = 0; ik < bins; ik++) {
-          if (abs(sqrt(kt2)) > ik * dkt && abs(sqrt(kt2)) <= (ik + 1) * dkt) {
-            n[ik] += nkt / dkt / 2 / M_PI / sqrt(kt2) * 2 * M_PI * sqrt(kt2) *
-                     dkt * N * N / M_PI / M_PI / 2. / 2.;
-            E[ik] += sqrt(omega2) * hbarc / a * nkt / dkt / 2 / M_PI /
-                     sqrt(kt2) * 2 * M_PI * sqrt(kt2) * dkt * N * N / M_PI /
-                     M_PI / 2. / 2.;
-            n2[ik] += nkt / dkt / 2 / M_PI / sqrt(kt2);
-            // dividing by bin size; bin is dkt times Jacobian k(=ik*dkt) times
-            // 2Pi in phi times the correct number of counts for an infinite
-            // lattice: area in bin divided by total area
-          }
-        }
-      }
-      if (i != 0 && j != 0) {
-        Nkxky[pos] += nkt * N * N / M_PI / M_PI / 2. / 2.;
-      }
-    }
-  }
+  binSpectrum(spectrum, E1, g * g / ((it - 0.5) * dtau), param, n, E, n2,
+              dNdeta, dEdeta, &Nkxky[0]);
 
   /// ------3 --------
 
@@ -3421,79 +2558,7 @@ int Evolution::multiplicitynkxky(Lattice *lat, Group *group, Parameters *param,
     for (int j = 0; j < N; j++) {
       pos = i * N + j;
 
-      if (param->getRunningCoupling()) {
-
-        if (pos > 0 && pos < (N - 1) * N + N - 1) {
-          g2mu2A = lat->cells[pos]->getg2mu2A();
-        } else
-          g2mu2A = 0;
-
-        if (pos > 0 && pos < (N - 1) * N + N - 1) {
-          g2mu2B = lat->cells[pos]->getg2mu2B();
-        } else
-          g2mu2B = 0;
-
-        if (param->getRunWithQs() == 2) {
-          if (g2mu2A > g2mu2B)
-            Qs = sqrt(g2mu2A * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-          else
-            Qs = sqrt(g2mu2B * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-        } else if (param->getRunWithQs() == 0) {
-          if (g2mu2A < g2mu2B)
-            Qs = sqrt(g2mu2A * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-          else
-            Qs = sqrt(g2mu2B * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-        } else if (param->getRunWithQs() == 1) {
-          Qs = sqrt((g2mu2A + g2mu2B) / 2. * param->getQsmuRatio() *
-                    param->getQsmuRatio() / a / a * hbarc * hbarc *
-                    param->getg() * param->getg());
-        }
-
-        if (param->getRunWithLocalQs() == 1) {
-          // 3 flavors
-          alphas =
-              4. * M_PI /
-              (9. *
-               log(pow(pow(muZero / 0.2, 2. / c) +
-                           pow(param->getRunWithThisFactorTimesQs() * Qs / 0.2,
-                               2. / c),
-                       c)));
-          gfactor = g * g / (4. * M_PI * alphas);
-          // run with the local (in transverse plane) coupling
-        } else {
-          if (param->getRunWithQs() == 0)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQsmin() / 0.2,
-                                      2. / c),
-                              c)));
-          else if (param->getRunWithQs() == 1)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQsAvg() / 0.2,
-                                      2. / c),
-                              c)));
-          else if (param->getRunWithQs() == 2)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQs() / 0.2,
-                                      2. / c),
-                              c)));
-
-          gfactor = g * g / (4. * M_PI * alphas);
-        }
-      } else
-        gfactor = 1.;
+      gfactor = gfactor_[pos];
 
       if (param->getRunWithkt() == 0) {
         *E1[pos] =
@@ -3509,67 +2574,20 @@ int Evolution::multiplicitynkxky(Lattice *lat, Group *group, Parameters *param,
   // do Fourier transforms
   fft->fftn(E1, E1, nn, 1);
 
-  for (int i = 0; i < N; i++) {
-    for (int j = 0; j < N; j++) {
-      nkt = 0.;
-      pos = i * N + j;
-      npos = (N - i) * N + (N - j);
+  binSpectrum(spectrum, E1, (it - 0.5) * dtau, param, n, E, n2, dNdeta,
+              dEdeta, &Nkxky[0]);
 
+  if (param->getWriteOutputs() == 2) {
+    for (int i = 0; i < N; i++) {
       kx = 2. * M_PI * (-0.5 + static_cast<double>(i) / static_cast<double>(N));
-      ky = 2. * M_PI * (-0.5 + static_cast<double>(j) / static_cast<double>(N));
-      kt2 = 4. * (sin(kx / 2.) * sin(kx / 2.) + sin(ky / 2.) * sin(ky / 2.)); //
-      omega2 =
-          4. *
-          (sin(kx / 2.) * sin(kx / 2.) +
-           sin(ky / 2.) *
-               sin(ky /
-                   2.)); // lattice dispersion relation (this is omega squared)
-
-      // i=0 or j=0 have no negative k_T value available
-
-      if (i != 0 && j != 0) {
-        if (omega2 != 0) {
-          nkt = 2. / sqrt(omega2) / static_cast<double>(N * N) *
-                (((it - 0.5) * dtau) *
-                 ((((*E1[pos]) * (*E1[npos])).trace()).real()));
-          if (param->getRunWithkt() == 1) {
-            nkt *= g * g /
-                   (4. * M_PI * 4. * M_PI /
-                    (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                      pow(param->getRunWithThisFactorTimesQs() *
-                                              sqrt(kt2) * hbarc / a / 0.2,
-                                          2. / c),
-                                  c))));
-          }
-        }
-
-        dNdeta += nkt;
-        dEdeta += nkt * sqrt(omega2) * hbarc / a;
-
-        for (int ik = 0; ik < bins; ik++) {
-          if (abs(sqrt(kt2)) > ik * dkt && abs(sqrt(kt2)) <= (ik + 1) * dkt) {
-            n[ik] += nkt / dkt / 2 / M_PI / sqrt(kt2) * 2 * M_PI * sqrt(kt2) *
-                     dkt * N * N / M_PI / M_PI / 2. / 2.;
-            E[ik] += sqrt(omega2) * hbarc / a * nkt / dkt / 2 / M_PI /
-                     sqrt(kt2) * 2 * M_PI * sqrt(kt2) * dkt * N * N / M_PI /
-                     M_PI / 2. / 2.;
-            n2[ik] += nkt / dkt / 2 / M_PI / sqrt(kt2);
-            // dividing by bin size; bin is dkt times Jacobian k(=ik*dkt) times
-            // 2Pi in phi times the correct number of counts for an infinite
-            // lattice: area in bin divided by total area
-          }
-        }
-      }
-      if (i != 0 && j != 0) {
-        Nkxky[pos] += nkt * N * N / M_PI / M_PI / 2. / 2.;
-      }
-      if (param->getWriteOutputs() == 2)
+      for (int j = 0; j < N; j++) {
+        ky = 2. * M_PI * (-0.5 + static_cast<double>(j) / static_cast<double>(N));
         foutNkxky << 2. * sin(kx / 2.) / a * hbarc << " "
                   << 2. * sin(ky / 2.) / a * hbarc << " "
-                  << Nkxky[pos] * a / hbarc * a / hbarc << "\n";
-    }
-    if (param->getWriteOutputs() == 2)
+                  << Nkxky[i * N + j] * a / hbarc * a / hbarc << "\n";
+      }
       foutNkxky << endl;
+    }
   }
   foutNkxky.close();
 
@@ -3669,90 +2687,7 @@ int Evolution::multiplicitynkxky(Lattice *lat, Group *group, Parameters *param,
   // compute hadrons using fragmentation function
   if (it == itmax && param->getWriteOutputs() == 3) {
     cout << " Hadronizing ... " << endl;
-    double z, frac;
-    double mypt, kt;
-    int ik;
-    const int steps = 6000;
-    double dz = 0.95 / static_cast<double>(steps);
-    double zValues[steps + 1];
-    double zintegrand[steps + 1];
-    // double Ezintegrand[steps+1];
-    // double Lzintegrand[steps+1];
-    // double Hzintegrand[steps+1];
-    gsl_interp_accel *zacc = gsl_interp_accel_alloc();
-    gsl_spline *zspline = gsl_spline_alloc(gsl_interp_cspline, steps + 1);
-
-    for (int ih = 0; ih <= hbins; ih++) {
-
-      mypt = ih * (20. / static_cast<double>(hbins));
-
-      for (int iz = 0; iz <= steps; iz++) {
-        z = 0.05 + iz * dz;
-        zValues[iz] = z;
-
-        kt = mypt / z;
-
-        ik = static_cast<int>(floor(kt * a / hbarc / dkt - 0.5 + 0.00000001));
-
-        frac = (kt - (ik + 0.5) * dkt / a * hbarc) / (dkt / a * hbarc);
-
-        if (ik + 1 < bins && ik >= 0)
-          Ng = ((1. - frac) * n[ik] + frac * n[ik + 1]) * a / hbarc * a /
-               hbarc; // to make dN/d^2k_T fo k_T in GeV
-        else
-          Ng = 0.;
-
-        if (param->getUsePseudoRapidity() == 0) {
-          zintegrand[iz] = 1. / (z * z) * Ng * kkp(7, 1, z, kt);
-          // Ezintegrand[iz] = mypt * 1./(z*z) * Ng * kkp(7,1,z,kt);
-          // Lzintegrand[iz] = 1./(z*z) * Ng * kkp(7,1,z,kt/2.);
-          // Hzintegrand[iz] = 1./(z*z) * Ng * kkp(7,1,z,kt*2.);
-        } else {
-          zintegrand[iz] = 1. / (z * z) * Ng * 2. *
-                           (kkp(1, 1, z, kt) * cosh(param->getRapidity()) /
-                                (sqrt(pow(cosh(param->getRapidity()), 2.) +
-                                      m_pion * m_pion / (mypt * mypt))) +
-                            kkp(2, 1, z, kt) * cosh(param->getRapidity()) /
-                                (sqrt(pow(cosh(param->getRapidity()), 2.) +
-                                      m_kaon * m_kaon / (mypt * mypt))) +
-                            kkp(4, 1, z, kt) * cosh(param->getRapidity()) /
-                                (sqrt(pow(cosh(param->getRapidity()), 2.) +
-                                      m_proton * m_proton / (mypt * mypt))));
-
-          // Ezintegrand[iz] =  mypt * 1./(z*z) * Ng *
-          // 	2. *
-          // (kkp(1,1,z,kt)*cosh(param->getRapidity())/(sqrt(pow(cosh(param->getRapidity()),2.)+m_pion*m_pion/(mypt*mypt)))
-          // 	      +kkp(2,1,z,kt)*cosh(param->getRapidity())/(sqrt(pow(cosh(param->getRapidity()),2.)+m_kaon*m_kaon/(mypt*mypt)))
-          // 	      +kkp(4,1,z,kt)*cosh(param->getRapidity())/(sqrt(pow(cosh(param->getRapidity()),2.)+m_proton*m_proton/(mypt*mypt))));
-
-          // Lzintegrand[iz] =  1./(z*z) * Ng *
-          // 	2. *
-          // (kkp(1,1,z,kt/2.)*cosh(param->getRapidity())/(sqrt(pow(cosh(param->getRapidity()),2.)+m_pion*m_pion/(mypt*mypt)))
-          // 	      +kkp(2,1,z,kt/2.)*cosh(param->getRapidity())/(sqrt(pow(cosh(param->getRapidity()),2.)+m_kaon*m_kaon/(mypt*mypt)))
-          // 	      +kkp(4,1,z,kt/2.)*cosh(param->getRapidity())/(sqrt(pow(cosh(param->getRapidity()),2.)+m_proton*m_proton/(mypt*mypt))));
-
-          // Hzintegrand[iz] =  1./(z*z) * Ng *
-          // 	2. *
-          // (kkp(1,1,z,kt*2.)*cosh(param->getRapidity())/(sqrt(pow(cosh(param->getRapidity()),2.)+m_pion*m_pion/(mypt*mypt)))
-          // 	      +kkp(2,1,z,kt*2.)*cosh(param->getRapidity())/(sqrt(pow(cosh(param->getRapidity()),2.)+m_kaon*m_kaon/(mypt*mypt)))
-          // 	      +kkp(4,1,z,kt*2.)*cosh(param->getRapidity())/(sqrt(pow(cosh(param->getRapidity()),2.)+m_proton*m_proton/(mypt*mypt))));
-        }
-      }
-
-      zValues[steps] = 1.; // set exactly 1
-
-      gsl_spline_init(zspline, zValues, zintegrand, steps + 1);
-      Nhgsl[ih] = gsl_spline_eval_integ(zspline, 0.05, 1., zacc);
-
-      //	  gsl_spline_init (zspline, zValues, Lzintegrand, steps+1);
-      // NhLgsl[ih] = gsl_spline_eval_integ(zspline, 0.05, 1., zacc);
-
-      // gsl_spline_init (zspline, zValues, Hzintegrand, steps+1);
-      // NhHgsl[ih] = gsl_spline_eval_integ(zspline, 0.05, 1., zacc);
-    }
-
-    gsl_spline_free(zspline);
-    gsl_interp_accel_free(zacc);
+    hadronize(n, bins, dkt, param, hbins, Nhgsl);
 
     stringstream strmultHad_name;
     strmultHad_name << "multiplicityHadrons" << param->getEventId() << ".dat";
@@ -3908,16 +2843,15 @@ int Evolution::correlations(Lattice *lat, Group *group, Parameters *param,
                             int it) {
   const int N = param->getSize();
   const int Nc = param->getNc();
-  int npos, pos;
+  int pos;
   double L = param->getL();
   double a = L / N; // lattice spacing in fm
-  double kx, ky, kt2, omega2;
+  double kx, ky;
   double g = param->getg();
   int nn[2];
   nn[0] = N;
   nn[1] = N;
   double dtau = param->getdtau();
-  double nkt, nkt1, nkt2, nkt3, nkt4, nkt5, nkt6;
   const int bins = 40;
   const int phiBins = 16;
   double n[bins][phiBins]; // |k_T|, phi array
@@ -3958,8 +2892,8 @@ int Evolution::correlations(Lattice *lat, Group *group, Parameters *param,
 
   cout << "Measuring multiplicity version 2... " << endl;
 
-  // fix transverse Coulomb gauge
-  GaugeFix gaugefix;
+  // fix transverse Coulomb gauge (starting from the gauge of the previous
+  // measurement, which the live lattice still carries)
 
   double maxtime;
   if (param->getInverseQsForMaxTime() == 1) {
@@ -3970,7 +2904,7 @@ int Evolution::correlations(Lattice *lat, Group *group, Parameters *param,
   }
 
   //  int itmax = static_cast<int>(floor(maxtime/(a*dtau)+1e-10));
-  gaugefix.FFTChi(fft, lat, group, param, 4000);
+  gaugefix.fixCoulombGauge(fft, lat, group, param, 4000);
   // gauge is fixed
 
   Matrix U1(Nc, 1.);
@@ -4016,7 +2950,7 @@ int Evolution::correlations(Lattice *lat, Group *group, Parameters *param,
     }
   }
 
-  double g2mu2A, g2mu2B, gfactor, alphas = 0., Qs = 0.;
+  double gfactor;
   double c = param->getc();
   double muZero = param->getMuZero();
 
@@ -4024,79 +2958,7 @@ int Evolution::correlations(Lattice *lat, Group *group, Parameters *param,
     for (int j = 0; j < N; j++) {
       pos = i * N + j;
 
-      if (param->getRunningCoupling()) {
-
-        if (pos > 0 && pos < (N - 1) * N + N - 1) {
-          g2mu2A = lat->cells[pos]->getg2mu2A();
-        } else
-          g2mu2A = 0;
-
-        if (pos > 0 && pos < (N - 1) * N + N - 1) {
-          g2mu2B = lat->cells[pos]->getg2mu2B();
-        } else
-          g2mu2B = 0;
-
-        if (param->getRunWithQs() == 2) {
-          if (g2mu2A > g2mu2B)
-            Qs = sqrt(g2mu2A * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-          else
-            Qs = sqrt(g2mu2B * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-        } else if (param->getRunWithQs() == 0) {
-          if (g2mu2A < g2mu2B)
-            Qs = sqrt(g2mu2A * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-          else
-            Qs = sqrt(g2mu2B * param->getQsmuRatio() * param->getQsmuRatio() /
-                      a / a * hbarc * hbarc * param->getg() * param->getg());
-        } else if (param->getRunWithQs() == 1) {
-          Qs = sqrt((g2mu2A + g2mu2B) / 2. * param->getQsmuRatio() *
-                    param->getQsmuRatio() / a / a * hbarc * hbarc *
-                    param->getg() * param->getg());
-        }
-
-        if (param->getRunWithLocalQs() == 1) {
-          // 3 flavors
-          alphas =
-              4. * M_PI /
-              (9. *
-               log(pow(pow(muZero / 0.2, 2. / c) +
-                           pow(param->getRunWithThisFactorTimesQs() * Qs / 0.2,
-                               2. / c),
-                       c)));
-          gfactor = g * g / (4. * M_PI * alphas);
-          // run with the local (in transverse plane) coupling
-        } else {
-          if (param->getRunWithQs() == 0)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQsmin() / 0.2,
-                                      2. / c),
-                              c)));
-          else if (param->getRunWithQs() == 1)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQsAvg() / 0.2,
-                                      2. / c),
-                              c)));
-          else if (param->getRunWithQs() == 2)
-            alphas =
-                4. * M_PI /
-                (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                  pow(param->getRunWithThisFactorTimesQs() *
-                                          param->getAverageQs() / 0.2,
-                                      2. / c),
-                              c)));
-
-          gfactor = g * g / (4. * M_PI * alphas);
-        }
-      } else
-        gfactor = 1.;
+      gfactor = gfactor_[pos];
 
       if (param->getRunWithkt() == 0) {
         *E1[pos] = lat->cells[pos]->getE1() *
@@ -4144,131 +3006,93 @@ int Evolution::correlations(Lattice *lat, Group *group, Parameters *param,
     }
   }
 
-  // leave out the first cell to make it symmetric
-  for (int i = 0; i < N; i++) {
-    for (int j = 0; j < N; j++) {
-      pos = i * N + j;
-      npos = (N - i) * N + (N - j);
+  // k_T and bin of every mode
+  const KtSpectrum spectrum(N, bins, dkt);
+  // the six contributions of every mode, summed up after the parallel loop
+  std::vector<double> nktTerms(6 * N * N, 0.);
+  double *nkxkyFlat = &nkxky[0][0];
 
-      kx = 2. * M_PI * (-0.5 + static_cast<double>(i) / static_cast<double>(N));
-      ky = 2. * M_PI * (-0.5 + static_cast<double>(j) / static_cast<double>(N));
-      kt2 = 4. * (sin(kx / 2.) * sin(kx / 2.) + sin(ky / 2.) * sin(ky / 2.)); //
-      omega2 =
-          4. *
-          (sin(kx / 2.) * sin(kx / 2.) +
-           sin(ky / 2.) *
-               sin(ky /
-                   2.)); // lattice dispersion relation (this is omega squared)
-
-      // i=0 or j=0 have no negative k_T value available
-
-      if (i != 0 && j != 0) {
-        if (omega2 != 0) {
-          nkt1 = 1. / sqrt(omega2) / static_cast<double>(N * N) *
-                 (1. / ((it - 0.5) * dtau) *
-                  ((((*E1[pos]) * (*E1[npos])).trace()).real() +
-                   (((*E2[pos]) * (*E2[npos])).trace()).real()));
-
-          nkt2 = 1. / sqrt(omega2) / static_cast<double>(N * N) *
-                 (((it - 0.5) * dtau) *
-                  ((((*pi[pos]) * (*pi[npos])).trace()).real()));
-
-          nkt3 = sqrt(omega2) / static_cast<double>(N * N) *
-                 ((it)*dtau * ((((*A1[pos]) * (*A1[npos])).trace()).real() +
-                               (((*A2[pos]) * (*A2[npos])).trace()).real()));
-
-          nkt4 = sqrt(omega2) / static_cast<double>(N * N) *
-                 (1. / ((it)*dtau) *
-                  ((((*phi[pos]) * (*phi[npos])).trace()).real()));
-
-          nkt5 = 1. / static_cast<double>(N * N) *
-                 (complex<double>(0., 1.) *
-                  ((*E1[pos]) * (*A1[npos]) - (*A1[pos]) * (*E1[npos]) +
-                   (*E2[pos]) * (*A2[npos]) - (*A2[pos]) * (*E2[npos]))
-                      .trace())
-                     .real();
-
-          nkt6 =
-              1. / static_cast<double>(N * N) *
-              (complex<double>(0., 1.) *
-               ((*pi[pos]) * (*phi[npos]) - (*phi[pos]) * (*pi[npos])).trace())
-                  .real();
+  // i=0 or j=0 have no negative k_T value available and are left out
+  auto modeMultiplicity = [&](int mode) {
+    const double omega = spectrum.omega(mode);
+    if (omega == 0.) {
+      nkxkyFlat[mode] = 0.;
+      return 0.;
+    }
+    const int npos = (N - mode / N) * N + (N - mode % N);
+    double *term = &nktTerms[6 * mode];
 
-          if (param->getRunWithkt() == 1) {
-            nkt1 *=
-                g * g /
-                (4. * M_PI * 4. * M_PI /
-                 (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                   pow(param->getRunWithThisFactorTimesQs() *
-                                           sqrt(kt2) * hbarc / a / 0.2,
-                                       2. / c),
-                               c))));
-            nkt2 *=
-                g * g /
-                (4. * M_PI * 4. * M_PI /
-                 (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                   pow(param->getRunWithThisFactorTimesQs() *
-                                           sqrt(kt2) * hbarc / a / 0.2,
-                                       2. / c),
-                               c))));
-            nkt3 *=
-                g * g /
-                (4. * M_PI * 4. * M_PI /
-                 (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                   pow(param->getRunWithThisFactorTimesQs() *
-                                           sqrt(kt2) * hbarc / a / 0.2,
-                                       2. / c),
-                               c))));
-            nkt4 *=
-                g * g /
-                (4. * M_PI * 4. * M_PI /
-                 (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                   pow(param->getRunWithThisFactorTimesQs() *
-                                           sqrt(kt2) * hbarc / a / 0.2,
-                                       2. / c),
-                               c))));
-            nkt5 *=
-                g * g /
-                (4. * M_PI * 4. * M_PI /
-                 (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                   pow(param->getRunWithThisFactorTimesQs() *
-                                           sqrt(kt2) * hbarc / a / 0.2,
-                                       2. / c),
-                               c))));
-            nkt6 *=
-                g * g /
-                (4. * M_PI * 4. * M_PI /
-                 (9. * log(pow(pow(muZero / 0.2, 2. / c) +
-                                   pow(param->getRunWithThisFactorTimesQs() *
-                                           sqrt(kt2) * hbarc / a / 0.2,
-                                       2. / c),
-                               c))));
-          }
-        } else {
-          nkt1 = 0.;
-          nkt2 = 0.;
-          nkt3 = 0.;
-          nkt4 = 0.;
-          nkt5 = 0.;
-          nkt6 = 0.;
-        }
+    term[0] = 1. / omega / static_cast<double>(N * N) *
+              (1. / ((it - 0.5) * dtau) *
+               ((((*E1[mode]) * (*E1[npos])).trace()).real() +
+                (((*E2[mode]) * (*E2[npos])).trace()).real()));
 
-        dNdeta1 += nkt1;
-        dNdeta2 += nkt2;
-        dNdeta3 += nkt3;
-        dNdeta4 += nkt4;
-        dNdeta5 += nkt5;
-        dNdeta6 += nkt6;
+    term[1] = 1. / omega / static_cast<double>(N * N) *
+              (((it - 0.5) * dtau) *
+               ((((*pi[mode]) * (*pi[npos])).trace()).real()));
 
-        nkt = nkt1 + nkt2 + nkt3 + nkt4 + nkt5 + nkt6;
+    term[2] = omega / static_cast<double>(N * N) *
+              ((it)*dtau * ((((*A1[mode]) * (*A1[npos])).trace()).real() +
+                            (((*A2[mode]) * (*A2[npos])).trace()).real()));
 
-        dNdeta += nkt; // total multiplicity
+    term[3] = omega / static_cast<double>(N * N) *
+              (1. / ((it)*dtau) *
+               ((((*phi[mode]) * (*phi[npos])).trace()).real()));
 
-        nkxky[i][j] = nkt;
-      }
+    term[4] = 1. / static_cast<double>(N * N) *
+              (complex<double>(0., 1.) *
+               ((*E1[mode]) * (*A1[npos]) - (*A1[mode]) * (*E1[npos]) +
+                (*E2[mode]) * (*A2[npos]) - (*A2[mode]) * (*E2[npos]))
+                   .trace())
+                  .real();
+
+    term[5] =
+        1. / static_cast<double>(N * N) *
+        (complex<double>(0., 1.) *
+         ((*pi[mode]) * (*phi[npos]) - (*phi[mode]) * (*pi[npos])).trace())
+            .real();
+
+    if (param->getRunWithkt() == 1) {
+      const double running =
+          g * g /
+          (4. * M_PI * 4. * M_PI /
+           (9. * log(pow(pow(muZero / 0.2, 2. / c) +
+                             pow(param->getRunWithThisFactorTimesQs() * omega *
+                                     hbarc / a / 0.2,
+                                 2. / c),
+                         c))));
+      for (int t = 0; t < 6; t++)
+        term[t] *= running;
+    }
+
+    const double result =
+        term[0] + term[1] + term[2] + term[3] + term[4] + term[5];
+    nkxkyFlat[mode] = result;
+    return result;
+  };
+
+  std::vector<double> sum, sumOmega, sumOverOmega;
+  double totalOmega;
+  spectrum.accumulate(modeMultiplicity, sum, sumOmega, sumOverOmega, dNdeta,
+                      totalOmega);
+
+  for (int i = 1; i < N; i++) {
+    for (int j = 1; j < N; j++) {
+      const double *term = &nktTerms[6 * (i * N + j)];
+      dNdeta1 += term[0];
+      dNdeta2 += term[1];
+      dNdeta3 += term[2];
+      dNdeta4 += term[3];
+      dNdeta5 += term[4];
+      dNdeta6 += term[5];
     }
   }
 
+  for (int ik = 0; ik < bins; ik++) {
+    nk[ik] = sum[ik] * N * N / M_PI / M_PI / 2. / 2.;
+    counterk[ik] = spectrum.count(ik);
+  }
+
   double latkx, latky;
   double fracX, fracY;
   for (int ik = 0; ik < bins; ik++) {
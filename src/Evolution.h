@@ -15,12 +15,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <thread>
 #include <unistd.h>
 
 #include "FFT.h"
 #include "GaugeFix.h"
 #include "Glauber.h"
 #include "Group.h"
+#include "KtSpectrum.h"
 #include "Lattice.h"
 #include "Matrix.h"
 #include "MyEigen.h"
@@ -35,11 +37,34 @@ private:
   FFT *fft;
   double nIn[100]; // k_T array
 
+  // Coulomb gauge fixing, kept for the whole event so that its state carries
+  // over from one measurement time to the next
+  GaugeFix gaugefix;
+
+  // measurement on a copy of the lattice while the evolution continues
+  // (measureThreads > 0)
+  Lattice *snapshot_;
+  std::thread measurement_;
+  int measurementSuccess_; // return value of the last snapshot measurement
+
+  // running coupling factor g^2/(4 pi alpha_s(Qs)) of every site, with the
+  // local Qs (gfactorLocal_) and as selected by runWithQs and runWithLocalQs
+  // (gfactor_); all 1 without running coupling. Filled at the start of run.
+  std::vector<double> gfactorLocal_;
+  std::vector<double> gfactor_;
+
 public:
   // Constructor
-  Evolution(const int nn[]) { fft = new FFT(nn); }
+  Evolution(const int nn[], Parameters *param)
+      : gaugefix(param), snapshot_(NULL), measurementSuccess_(1) {
+    fft = new FFT(nn);
+  }
 
-  ~Evolution() { delete fft; }
+  ~Evolution() {
+    finishMeasurement();
+    delete snapshot_;
+    delete fft;
+  }
 
   void run(Lattice *lat, BufferLattice *bufferlat, Group *group,
            Parameters *param);
@@ -54,8 +79,14 @@ public:
   void evolveE(Lattice *lat, BufferLattice *bufferlat, Parameters *param,
                double dtau, double tau);
   void checkGaussLaw(Lattice *lat, Parameters *param);
-  void eccentricity(Lattice *lat, Parameters *param, int it, double cutoff,
-                    int doAniso);
+  // computes gfactorLocal_ and gfactor_ from the initial g^2 mu^2 of both
+  // nuclei
+  void computeGfactor(Lattice *lat, Parameters *param);
+  // eccentricities and participant plane angles of the harmonics 1..nMax
+  // for every energy density cutoff (one output line each)
+  void eccentricity(Lattice *lat, Parameters *param, int it,
+                    const std::vector<double> &cutoffs, int doAniso,
+                    int nMax = 6);
   void Tmunu(Lattice *lat, Parameters *param, int it);
   void u(Lattice *lat, Parameters *param, int it);
   int multiplicity(Lattice *lat, Group *group, Parameters *param, int it);
@@ -63,6 +94,24 @@ public:
   int correlations(Lattice *lat, Group *group, Parameters *param, int it);
   void anisotropy(Lattice *lat, Parameters *param, int it);
   void readNkt(Parameters *param);
+  // copies the fields used by the measurements into the snapshot lattice
+  void takeSnapshot(Lattice *lat, Parameters *param);
+  // runs multiplicity on the snapshot in its own thread with measureThreads
+  // OpenMP threads
+  void startMeasurement(Group *group, Parameters *param, int it);
+  // waits for the running snapshot measurement and returns its result
+  int finishMeasurement();
+  // adds the gluon spectrum prefactor * 2/omega/N^2 Re tr(F(k) F(-k)) of the
+  // Fourier transformed field F to the k_T histograms n, E, n2 and to
+  // dN/deta, dE/deta (and, if given, to the spectrum Nkxky of every mode)
+  void binSpectrum(const KtSpectrum &spectrum, Matrix **F, double prefactor,
+                   Parameters *param, double *n, double *E, double *n2,
+                   double &dNdeta, double &dEdeta, double *Nkxky = NULL);
+  // convolutes the binned gluon spectrum n with the tabulated KKP
+  // fragmentation functions to give the hadron spectrum Nh at
+  // p_T = ih * 20 GeV/hbins, ih = 0..hbins
+  void hadronize(const double *n, int bins, double dkt, Parameters *param,
+                 int hbins, double *Nh);
 };
 
 #endif // Evolution_H
@@ -354,59 +354,28 @@ void FFT::fftn(T **data, T **outdata, const int nn[], const int isign) {
 
 template <class T>
 void FFT::fftnMany(T **data, T **outdata, const int nn[], const int isign) {
-  unsigned ntot = nn[0] * nn[1];
-  int mDim, pos, newpos; // matrix dimension
-  mDim = data[0]->getNDim();
-
-  // mDim is the size of the matrix (how many rows)
-
-  mDim *= mDim;
-  // ndim is the dimension of the FFT (always 2 here)
-
-  // for each component of the matrix fill the input array for the FFT (resort
-  // as you fill in)
-
-  //    cout << "mDim=" << mDim << endl;
+  const int ntot = nn[0] * nn[1];
+  const int mDim = data[0]->getNDim() * data[0]->getNDim();
+  if (mDim > manyComponents) {
+    cerr << "[FFT::fftnMany]: ERROR: " << mDim
+         << " matrix components, the batched plans hold at most "
+         << manyComponents << ". Exiting." << endl;
+    exit(1);
+  }
 
-  for (int k = 0; k < mDim; k++) {
-    //	oo   ->  xo
-    //      ox       oo
-    for (int i = nn[0] / 2; i < nn[0]; i++) {
-      for (int j = nn[1] / 2; j < nn[1]; j++) {
-        pos = i * nn[1] + j;
-        newpos = (i - nn[0] / 2) * nn[1] + j - nn[1] / 2 + k * ntot;
-        input[newpos][0] = data[pos]->getRe(k);
-        input[newpos][1] = data[pos]->getIm(k);
-      }
-    }
-    //	xo   ->  oo
-    //      oo       ox
-    for (int i = 0; i < nn[0] / 2; i++) {
-      for (int j = 0; j < nn[1] / 2; j++) {
-        pos = i * nn[1] + j + k;
-        newpos = (i + nn[0] / 2) * nn[1] + nn[1] / 2 + j + k * ntot;
-        input[newpos][0] = data[pos]->getRe(k);
-        input[newpos][1] = data[pos]->getIm(k);
-      }
-    }
-    //	ox   ->  oo
-    //      oo       xo
-    for (int i = nn[0] / 2; i < nn[0]; i++) {
-      for (int j = 0; j < nn[1] / 2; j++) {
-        pos = i * nn[1] + j;
-        newpos = (i - nn[0] / 2) * nn[1] + j + nn[1] / 2 + k * ntot;
-        input[newpos][0] = data[pos]->getRe(k);
-        input[newpos][1] = data[pos]->getIm(k);
-      }
-    }
-    //	oo   ->  ox
-    //      xo       oo
-    for (int i = 0; i < nn[0] / 2; i++) {
-      for (int j = nn[1] / 2; j < nn[1]; j++) {
-        pos = i * nn[1] + j;
-        newpos = (i + nn[0] / 2) * nn[1] + j - nn[1] / 2 + k * ntot;
-        input[newpos][0] = data[pos]->getRe(k);
-        input[newpos][1] = data[pos]->getIm(k);
+  // the same resorting as in fftn (swap of the quadrants, i.e. a shift by
+  // half the lattice in both directions), for all components in one pass
+#pragma omp parallel for
+  for (int i = 0; i < nn[0]; i++) {
+    const int inew = (i + nn[0] / 2) % nn[0];
+    for (int j = 0; j < nn[1]; j++) {
+      const int pos = i * nn[1] + j;
+      const int newpos = inew * nn[1] + (j + nn[1] / 2) % nn[1];
+      for (int k = 0; k < manyComponents; k++) {
+        const complex<double> value =
+            (k < mDim) ? (*data[pos])(k) : complex<double>(0., 0.);
+        inputMany[newpos + k * ntot][0] = value.real();
+        inputMany[newpos + k * ntot][1] = value.imag();
       }
     }
   }
@@ -417,59 +386,21 @@ void FFT::fftnMany(T **data, T **outdata, const int nn[], const int isign) {
     fftw_execute(pmanyback);
 
   // if this is inverse transform, normalize.
-  if (isign == -1) {
-    for (unsigned i = 0; i < ntot * 9; i++) {
-      output[i][0] /= static_cast<double>(ntot);
-      output[i][1] /= static_cast<double>(ntot);
-    }
-  }
-
-  for (int k = 0; k < mDim; k++) {
+  const double norm = (isign == -1) ? 1. / static_cast<double>(ntot) : 1.;
 
-    //	oo   ->  xo
-    //      ox       oo
-    for (int i = nn[0] / 2; i < nn[0]; i++) {
-      for (int j = nn[1] / 2; j < nn[1]; j++) {
-        pos = i * nn[1] + j;
-        newpos = (i - nn[0] / 2) * nn[1] + j - nn[1] / 2 + k * ntot;
-        outdata[pos]->setRe(k, output[newpos][0]);
-        outdata[pos]->setIm(k, output[newpos][1]);
-      }
-    }
-    //	xo   ->  oo
-    //      oo       ox
-    for (int i = 0; i < nn[0] / 2; i++) {
-      for (int j = 0; j < nn[1] / 2; j++) {
-        pos = i * nn[1] + j;
-        newpos = (i + nn[0] / 2) * nn[1] + nn[1] / 2 + j + k * ntot;
-        outdata[pos]->setRe(k, output[newpos][0]);
-        outdata[pos]->setIm(k, output[newpos][1]);
-      }
-    }
-    //	ox   ->  oo
-    //      oo       xo
-    for (int i = nn[0] / 2; i < nn[0]; i++) {
-      for (int j = 0; j < nn[1] / 2; j++) {
-        pos = i * nn[1] + j;
-        newpos = (i - nn[0] / 2) * nn[1] + j + nn[1] / 2 + k * ntot;
-        outdata[pos]->setRe(k, output[newpos][0]);
-        outdata[pos]->setIm(k, output[newpos][1]);
-      }
-    }
-    //	oo   ->  ox
-    //      xo       oo
-
-    for (int i = 0; i < nn[0] / 2; i++) {
-      for (int j = nn[1] / 2; j < nn[1]; j++) {
-        pos = i * nn[1] + j;
-        newpos = (i + nn[0] / 2) * nn[1] + j - nn[1] / 2 + k * ntot;
-        outdata[pos]->setRe(k, output[newpos][0]);
-        outdata[pos]->setIm(k, output[newpos][1]);
+#pragma omp parallel for
+  for (int i = 0; i < nn[0]; i++) {
+    const int inew = (i + nn[0] / 2) % nn[0];
+    for (int j = 0; j < nn[1]; j++) {
+      const int pos = i * nn[1] + j;
+      const int newpos = inew * nn[1] + (j + nn[1] / 2) % nn[1];
+      for (int k = 0; k < mDim; k++) {
+        outdata[pos]->set(k, complex<double>(
+                                 outputMany[newpos + k * ntot][0] * norm,
+                                 outputMany[newpos + k * ntot][1] * norm));
       }
     }
   }
-
-  //------
 }
 
 void FFT::fftnComplex(complex<double> *data, complex<double> *outdata,
@@ -586,6 +517,38 @@ void FFT::fftnComplex(complex<double> *data, complex<double> *outdata,
   }
 }
 
+void FFT::fftnComplex(complex<double> *data, complex<double> *outdata,
+                      const int nn[], const int isign, fftw_complex *in,
+                      fftw_complex *out) {
+  const int ntot = nn[0] * nn[1];
+
+  // same quadrant reordering as above: shift by half the lattice in x and y
+  for (int i = 0; i < nn[0]; i++) {
+    const int inew = (i + nn[0] / 2) % nn[0];
+    for (int j = 0; j < nn[1]; j++) {
+      const int newpos = inew * nn[1] + (j + nn[1] / 2) % nn[1];
+      in[newpos][0] = data[i * nn[1] + j].real();
+      in[newpos][1] = data[i * nn[1] + j].imag();
+    }
+  }
+
+  // executing an existing plan on new arrays is thread safe in FFTW
+  if (isign == 1)
+    fftw_execute_dft(p, in, out);
+  else
+    fftw_execute_dft(pback, in, out);
+
+  const double norm = (isign == -1) ? 1. / static_cast<double>(ntot) : 1.;
+  for (int i = 0; i < nn[0]; i++) {
+    const int inew = (i + nn[0] / 2) % nn[0];
+    for (int j = 0; j < nn[1]; j++) {
+      const int newpos = inew * nn[1] + (j + nn[1] / 2) % nn[1];
+      outdata[i * nn[1] + j] =
+          complex<double>(out[newpos][0] * norm, out[newpos][1] * norm);
+    }
+  }
+}
+
 // Define specializations of the template:
 template void FFT::fftn(Matrix **data, Matrix **outdata, const int nn[],
                         const int isign);
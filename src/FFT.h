@@ -62,6 +62,9 @@ std::vector<T> operator/(const std::vector<T> &a, const double b) {
 
 class FFT {
 private:
+  // components of the batched transforms of fftnMany: Nc^2 for Nc <= 3
+  int const static manyComponents = 9;
+
   fftw_complex *input, *output;
   fftw_complex *inputMany, *outputMany;
   fftw_plan p, pback, pmany, pmanyback;
@@ -78,16 +81,17 @@ public:
                          FFTW_MEASURE);
     pback = fftw_plan_dft_2d(nn[0], nn[1], input, output, FFTW_BACKWARD,
                              FFTW_MEASURE);
-    inputMany =
-        (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * nn[0] * nn[1] * 9);
-    outputMany =
-        (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * nn[0] * nn[1] * 9);
-    pmany =
-        fftw_plan_many_dft(2, nn, 9, input, nn, 1, nn[0] * nn[1], output, nn, 1,
-                           nn[0] * nn[1], FFTW_FORWARD, FFTW_MEASURE);
-    pmanyback =
-        fftw_plan_many_dft(2, nn, 9, input, nn, 1, nn[0] * nn[1], output, nn, 1,
-                           nn[0] * nn[1], FFTW_BACKWARD, FFTW_MEASURE);
+    inputMany = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * nn[0] *
+                                            nn[1] * manyComponents);
+    outputMany = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * nn[0] *
+                                             nn[1] * manyComponents);
+    // all (up to manyComponents) matrix components in one batched transform
+    pmany = fftw_plan_many_dft(2, nn, manyComponents, inputMany, nn, 1,
+                               nn[0] * nn[1], outputMany, nn, 1, nn[0] * nn[1],
+                               FFTW_FORWARD, FFTW_MEASURE);
+    pmanyback = fftw_plan_many_dft(2, nn, manyComponents, inputMany, nn, 1,
+                                   nn[0] * nn[1], outputMany, nn, 1,
+                                   nn[0] * nn[1], FFTW_BACKWARD, FFTW_MEASURE);
   };
   // Destructor
   ~FFT() {
@@ -109,11 +113,18 @@ public:
 
   template <class T>
   void fftn(T **data, T **outdata, const int nn[], const int isign);
+  // same as fftn, but all Nc^2 <= manyComponents components are transformed
+  // at once; exits for larger Nc
   template <class T>
   void fftnMany(T **data, T **outdata, const int nn[], const int isign);
 
   void fftnComplex(complex<double> *data, complex<double> *outdata,
                    const int nn[], const int isign);
+  // same as above, but working in the caller's fftw_malloc'ed buffers, so that
+  // several transforms can run concurrently on different threads
+  void fftnComplex(complex<double> *data, complex<double> *outdata,
+                   const int nn[], const int isign, fftw_complex *in,
+                   fftw_complex *out);
 };
 
 #endif // FFT_H
@@ -3,6 +3,9 @@
 #include "Fragmentation.h"
 #include <cmath>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 
 namespace Fragmentation {
 //**************************************************************************
@@ -873,4 +876,31 @@ double kkp(int ih, int iset, double x, double qs) {
   return dh[0]; // return gluon part
 }
 
+constexpr double KkpTable::zMin;
+constexpr double KkpTable::dz;
+constexpr double KkpTable::QMax;
+
+KkpTable::KkpTable(int ih, int iset)
+    : logQMin(0.5 * log(2.)), dlogQ((log(QMax) - logQMin) / QSteps),
+      table((zSteps + 1) * (QSteps + 1)) {
+#pragma omp parallel for
+  for (int iz = 0; iz <= zSteps; iz++) {
+    for (int iq = 0; iq <= QSteps; iq++) {
+      table[iz * (QSteps + 1) + iq] =
+          kkp(ih, iset, z(iz), exp(logQMin + iq * dlogQ));
+    }
+  }
+}
+
+const KkpTable &KkpTable::get(int ih, int iset) {
+  static std::mutex mutex;
+  static std::map<std::pair<int, int>, std::unique_ptr<KkpTable>> tables;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  std::unique_ptr<KkpTable> &table = tables[std::make_pair(ih, iset)];
+  if (!table)
+    table.reset(new KkpTable(ih, iset));
+  return *table;
+}
+
 } // namespace Fragmentation
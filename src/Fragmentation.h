@@ -4,8 +4,50 @@
 #ifndef Fragmentation_H
 #define Fragmentation_H
 
+#include <vector>
+
 namespace Fragmentation {
 double kkp(int ih, int iset, double x, double qs);
-}
+
+// The gluon fragmentation function kkp(ih, iset, z, Q) of one hadron species
+// tabulated on the nodes z_i = zMin + i dz, i = 0..zSteps (z_zSteps = 1), and
+// on an equidistant grid in log Q. Values in between are interpolated
+// linearly in log Q; below Q_0 = sqrt(2) GeV the scale is frozen as in kkp
+// and above QMax the last value is used. The tables are built once per job
+// and shared, see get.
+class KkpTable {
+public:
+  static constexpr double zMin = 0.05;
+  static constexpr int zSteps = 6000;
+  static constexpr double dz = (1. - zMin) / zSteps;
+  static constexpr double QMax = 1000.; // in GeV
+  static constexpr int QSteps = 128;
+
+  KkpTable(int ih, int iset);
+
+  static double z(int iz) { return iz == zSteps ? 1. : zMin + iz * dz; }
+
+  // D(z_iz, Q) for logQ = log(Q/GeV)
+  double operator()(int iz, double logQ) const {
+    double t = (logQ - logQMin) / dlogQ;
+    if (t <= 0.)
+      return table[iz * (QSteps + 1)];
+    if (t >= QSteps)
+      return table[iz * (QSteps + 1) + QSteps];
+    int iq = static_cast<int>(t);
+    double frac = t - iq;
+    const double *d = &table[iz * (QSteps + 1) + iq];
+    return (1. - frac) * d[0] + frac * d[1];
+  }
+
+  // the table of species ih in set iset, built on first use (thread safe)
+  static const KkpTable &get(int ih, int iset);
+
+private:
+  double logQMin;
+  double dlogQ;
+  std::vector<double> table; // D(z_iz, Q_iq) at iz * (QSteps + 1) + iq
+};
+} // namespace Fragmentation
 
 #endif // Fragmentation_H
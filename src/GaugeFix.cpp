@@ -3,178 +3,509 @@
 
 #include "GaugeFix.h"
 
+#include <chrono>
+#include <sstream>
+
+namespace {
+// out = a * b, without temporaries
+void multiply(const Matrix &a, const Matrix &b, Matrix &out) {
+  const int Nc = a.getNDim();
+  for (int i = 0; i < Nc; i++) {
+    for (int j = 0; j < Nc; j++) {
+      complex<double> sum = 0.;
+      for (int k = 0; k < Nc; k++)
+        sum += a(i, k) * b(k, j);
+      out.set(i, j, sum);
+    }
+  }
+}
+
+// out = a * b^dagger, without temporaries
+void multiplyDag(const Matrix &a, const Matrix &b, Matrix &out) {
+  const int Nc = a.getNDim();
+  for (int i = 0; i < Nc; i++) {
+    for (int j = 0; j < Nc; j++) {
+      complex<double> sum = 0.;
+      for (int k = 0; k < Nc; k++)
+        sum += a(i, k) * conj(b(j, k));
+      out.set(i, j, sum);
+    }
+  }
+}
+
+// M -> g M h^dagger in place, temp is scratch space
+void transform(const Matrix &g, Matrix &M, const Matrix &h, Matrix &temp) {
+  multiply(g, M, temp);
+  multiplyDag(temp, h, M);
+}
+} // namespace
+
 //**************************************************************************
 // GaugeFix class.
 
-void GaugeFix::FFTChi(FFT *fft, Lattice *lat, Group *group, Parameters *param,
-                      int steps) {
+GaugeFix::GaugeFix(Parameters *param)
+    : alpha_(0.), fixed_(false), relaxing_(false), startResidual_(0.),
+      sites_(param->getSize() * param->getSize()), chi_(NULL), p_(NULL),
+      pOld_(NULL), d_(NULL) {
+  const int Nc = param->getNc();
+  const int method = param->getGaugeFixMethod();
+  chi_ = allocate(Nc);
+  if (method != 1)
+    p_ = allocate(Nc);
+  if (method == 2) {
+    pOld_ = allocate(Nc);
+    d_ = allocate(Nc);
+  }
+}
+
+Matrix **GaugeFix::allocate(int Nc) {
+  Matrix **m = new Matrix *[sites_];
+  for (int i = 0; i < sites_; i++)
+    m[i] = new Matrix(Nc, 0.);
+  return m;
+}
+
+void GaugeFix::release(Matrix **m) {
+  if (m == NULL)
+    return;
+  for (int i = 0; i < sites_; i++)
+    delete m[i];
+  delete[] m;
+}
+
+double GaugeFix::divergence(Lattice *lat, Group *group, Parameters *param,
+                            Matrix **chi) {
+  const int N = param->getSize();
+  const int Nc = param->getNc();
+  const int Nc2 = Nc * Nc;
+  const int Nc2m1 = Nc2 - 1;
+  double gresidual = 0.;
+
+#pragma omp parallel
+  {
+    Matrix divA(Nc);
+#pragma omp for reduction(+ : gresidual)
+    for (int i = 0; i < N; i++) {
+      const int im = (i > 0) ? i - 1 : N - 1;
+      for (int j = 0; j < N; j++) {
+        const int jm = (j > 0) ? j - 1 : N - 1;
+        const int pos = i * N + j;
+        const Matrix &Ux = lat->cells[pos]->getUx();
+        const Matrix &Uy = lat->cells[pos]->getUy();
+        const Matrix &UxMx = lat->cells[im * N + j]->getUx();
+        const Matrix &UyMy = lat->cells[i * N + jm]->getUy();
+
+        for (int k = 0; k < Nc2; k++)
+          divA.set(k, Ux(k) - UxMx(k) + Uy(k) - UyMy(k));
+
+        // projection on the generators: chi = sum_a Im tr(div A t^a) t^a
+        Matrix &g = *chi[pos];
+        for (int k = 0; k < Nc2; k++)
+          g.set(k, 0.);
+        for (int ig = 0; ig < Nc2m1; ig++) {
+          const Matrix &t = group->getT(ig);
+          complex<double> tr = 0.;
+          for (int a = 0; a < Nc; a++)
+            for (int b = 0; b < Nc; b++)
+              tr += divA(a, b) * t(b, a);
+          for (int k = 0; k < Nc2; k++)
+            g.set(k, g(k) + tr.imag() * t(k));
+        }
+
+        double trg2 = 0.;
+        for (int k = 0; k < Nc2; k++)
+          trg2 += norm(g(k));
+        gresidual += trg2 / static_cast<double>(Nc);
+      }
+    }
+  }
+
+  return gresidual / (N * N);
+}
+
+void GaugeFix::precondition(FFT *fft, Parameters *param, Matrix **chi) {
   const int N = param->getSize();
   int nn[2];
   nn[0] = N;
   nn[1] = N;
-  int pos, posmX, posmY;
-  int Nc = param->getNc();
-  int Nc2m1 = Nc * Nc - 1;
 
+  fft->fftnMany(chi, chi, nn, 1);
+
+#pragma omp parallel for
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      double kx, ky, kt2;
+      int localpos = i * N + j;
+      kx = sin(M_PI *
+               (-0.5 + static_cast<double>(i) / static_cast<double>(N)));
+      ky = sin(M_PI *
+               (-0.5 + static_cast<double>(j) / static_cast<double>(N)));
+      kt2 = 4. * (kx * kx + ky * ky); // lattice momentum squared
+      *chi[localpos] *= 1. / (kt2 + 1e-9);
+    }
+  }
+
+  fft->fftnMany(chi, chi, nn, -1);
+}
+
+void GaugeFix::setg(Lattice *lat, Parameters *param, Matrix **d,
+                    double factor) {
+  const int N = param->getSize();
+  const int Nc = param->getNc();
   Matrix one(Nc, 1.);
-  Matrix oldg(Nc), g(Nc), gdag(Nc), temp(Nc);
-  Matrix divA(Nc), divAdag(Nc);
-  Matrix divANew(Nc);
-  Matrix Uplaq(Nc), U(Nc), UDx(Nc), UDy(Nc), UDxMx(Nc), UDyMy(Nc), Ux(Nc),
-      Uy(Nc), UxMx(Nc), UyMy(Nc);
-  Matrix UmxDag(Nc), UmyDag(Nc);
 
-  int max_gfiter = steps;
+#pragma omp parallel
+  {
+    Matrix localg(Nc);
+#pragma omp for
+    for (int i = 0; i < N; i++) {
+      for (int j = 0; j < N; j++) {
+        int localpos = i * N + j;
+        // exponentiate
+        localg = complex<double>(0, factor) * (*d[localpos]);
+        localg.expm();
+        // reunitarize
+        localg.reu();
+
+        if (localg(2) != localg(2)) {
+          cout << "problem at " << i << " " << j << " with g=" << localg
+               << endl;
+          localg = one;
+        }
+
+        lat->cells[localpos]->setg(localg);
+      }
+    }
+  }
+}
 
-  Matrix zero(Nc, 0.);
-  double gresidual = 10000.;
+double GaugeFix::dot(Parameters *param, Matrix **a, Matrix **b) {
+  const int N = param->getSize();
+  const int Nc = param->getNc();
+  double sum = 0.;
+
+#pragma omp parallel for reduction(+ : sum)
+  for (int pos = 0; pos < N * N; pos++) {
+    for (int i = 0; i < Nc; i++)
+      for (int k = 0; k < Nc; k++)
+        sum += ((*a[pos])(i, k) * (*b[pos])(k, i)).real();
+  }
+  return sum;
+}
 
-  Matrix **chi;
-  chi = new Matrix *[N * N];
+bool GaugeFix::tuneAlpha(double gresidual, double &lastResidual,
+                         double &alpha, double alphaMax) {
+  const bool improved = (gresidual < lastResidual);
+  if (improved)
+    alpha = min(1.05 * alpha, alphaMax);
+  else
+    alpha *= 0.5;
+  lastResidual = gresidual;
+  return improved;
+}
 
-  for (int i = 0; i < N * N; i++) {
-    chi[i] = new Matrix(Nc, 0.);
+void GaugeFix::fixCoulombGauge(FFT *fft, Lattice *lat, Group *group,
+                               Parameters *param, int steps) {
+  const int method = param->getGaugeFixMethod();
+  const char *methodName[3] = {"Fourier accelerated steepest descent",
+                               "stochastic overrelaxation",
+                               "Fourier preconditioned conjugate gradient"};
+  if (method < 0 || method > 2) {
+    cerr << "[GaugeFix::fixCoulombGauge]: ERROR: gaugeFixMethod " << method
+         << " is not supported (0, 1 or 2). Exiting." << endl;
+    exit(1);
   }
 
-  cout << "gauge fixing" << endl;
+  cout << "gauge fixing with " << methodName[method] << endl;
+
+  double gresidual = 0.;
+  int iterations;
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  if (method == 1)
+    iterations = overrelaxation(lat, group, param, steps, gresidual);
+  else
+    iterations = FFTChi(fft, lat, group, param, steps, method == 2, gresidual);
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+
+  fixed_ = true;
+
+  cout << "gauge fixing: " << iterations << " iterations, residual "
+       << startResidual_ << " -> " << gresidual << ", " << seconds << " s"
+       << endl;
+
+  stringstream strup_name;
+  strup_name << "usedParameters" << param->getEventId() << ".dat";
+  ofstream fout(strup_name.str().c_str(), ios::app);
+  fout << "Gauge fixing (" << methodName[method] << "): " << iterations
+       << " iterations, residual " << startResidual_ << " -> " << gresidual << ", " << seconds << " s"
+       << endl;
+  fout.close();
+}
 
-  for (int gfiter = 0; gfiter < max_gfiter; gfiter++) {
-    gresidual = 0.;
-    for (int i = 0; i < N; i++) {
-      for (int j = 0; j < N; j++) {
-        pos = i * N + j;
-        if (i > 0)
-          posmX = (i - 1) * N + j;
-        else
-          posmX = (N - 1) * N + j;
-        if (j > 0)
-          posmY = i * N + (j - 1);
-        else
-          posmY = i * N + (N - 1);
-
-        Ux = UDx = lat->cells[pos]->getUx();
-        Uy = UDy = lat->cells[pos]->getUy();
-        UxMx = UDxMx = lat->cells[posmX]->getUx();
-        UyMy = UDyMy = lat->cells[posmY]->getUy();
-        UDx.conjg();
-        UDy.conjg();
-        UDxMx.conjg();
-        UDyMy.conjg();
-
-        divA = (Ux - UxMx + Uy - UyMy);
-
-        g = zero;
-        for (int ig = 0; ig < Nc2m1; ig++) {
-          g = g + ((divA)*group->getT(ig)).trace().imag() * group->getT(ig);
-        }
+void GaugeFix::relax(FFT *fft, Lattice *lat, Group *group,
+                     Parameters *param) {
+  if (!fixed_)
+    return;
+
+  double gresidual;
+  relaxing_ = true;
+  if (param->getGaugeFixMethod() == 1)
+    overrelaxation(lat, group, param, 1, gresidual);
+  else
+    FFTChi(fft, lat, group, param, 1, param->getGaugeFixMethod() == 2,
+           gresidual);
+  relaxing_ = false;
+}
+
+int GaugeFix::FFTChi(FFT *fft, Lattice *lat, Group *group, Parameters *param,
+                     int steps, bool conjugateGradient, double &gresidual) {
+  const int N = param->getSize();
+  int Nc = param->getNc();
 
-        *chi[pos] = gdag = g;
-        gdag.conjg();
+  int max_gfiter = steps;
 
-        gresidual += ((gdag * g).trace()).real() / static_cast<double>(Nc);
+  // step size; a non-positive gaugeFixAlpha lets the tuner choose it
+  const bool tune = (param->getGaugeFixAlpha() <= 0.);
+  const double alphaMax = 1.9;
+  double alpha =
+      tune ? (alpha_ > 0. ? alpha_ : 1.5) : param->getGaugeFixAlpha();
+  double lastResidual = 1e300;
+
+  gresidual = 10000.;
+
+  // gradient chi, preconditioned gradient p (and p of the previous
+  // iteration) and search direction d, from the work arrays; the values left
+  // in d by an earlier call are not used, the first iteration sets d = p
+  Matrix **chi = chi_, **p = p_, **pOld = pOld_, **d = d_;
+  if (p == NULL || (conjugateGradient && (pOld == NULL || d == NULL))) {
+    cerr << "[GaugeFix::FFTChi]: ERROR: work arrays not allocated for "
+            "gaugeFixMethod "
+         << param->getGaugeFixMethod() << ". Exiting." << endl;
+    exit(1);
+  }
+  double chiOldpOld = 0.;
+  bool restart = true;
 
-      } // i loop
-    }   // j loop
+  int gfiter;
+  for (gfiter = 0; gfiter < max_gfiter; gfiter++) {
+    gresidual = divergence(lat, group, param, chi);
 
-    gresidual /= N * N;
+    if (gfiter == 0)
+      startResidual_ = gresidual;
 
-    if (gfiter % 10 == 0) {
+    if (gfiter % 10 == 0 && !relaxing_) {
       cout << gfiter << " " << gresidual << endl;
     }
 
-    if (gresidual < 1e-9) {
+    if (gresidual < tolerance) {
       break;
     }
 
-    fft->fftn(chi, chi, nn, 1);
+    // a step that raised the residual restarts the conjugate directions
+    if (tune && !relaxing_ &&
+        !tuneAlpha(gresidual, lastResidual, alpha, alphaMax))
+      restart = true;
 
 #pragma omp parallel for
-    for (int i = 0; i < N; i++) {
-      for (int j = 0; j < N; j++) {
-        double kx, ky, kt2;
-        int localpos = i * N + j;
-        kx = sin(M_PI *
-                 (-0.5 + static_cast<double>(i) / static_cast<double>(N)));
-        ky = sin(M_PI *
-                 (-0.5 + static_cast<double>(j) / static_cast<double>(N)));
-        kt2 = 4. * (kx * kx + ky * ky); // lattice momentum squared
-        *chi[localpos] = -1.5 * (1. / (kt2 + 1e-9)) * (*chi[localpos]);
+    for (int pos = 0; pos < N * N; pos++)
+      *p[pos] = *chi[pos];
+    precondition(fft, param, p);
+
+    if (!conjugateGradient) {
+      setg(lat, param, p, -alpha);
+    } else {
+      // Polak-Ribiere: beta = <chi, p - pOld> / <chiOld, pOld>, at least 0
+      double beta = 0.;
+      if (!restart && chiOldpOld > 0.)
+        beta = max(0., (dot(param, chi, p) - dot(param, chi, pOld)) /
+                           chiOldpOld);
+      chiOldpOld = dot(param, chi, p);
+      restart = false;
+
+#pragma omp parallel for
+      for (int pos = 0; pos < N * N; pos++) {
+        for (int k = 0; k < Nc * Nc; k++)
+          d[pos]->set(k, (beta > 0.) ? (*p[pos])(k) + beta * (*d[pos])(k)
+                                     : (*p[pos])(k));
+        *pOld[pos] = *p[pos];
       }
+      setg(lat, param, d, -alpha);
     }
 
-    fft->fftn(chi, chi, nn, -1);
+    gaugeTransform(lat, param);
+  } // gfiter loop
 
-#pragma omp parallel
-    {
-      Matrix localg(Nc);
-#pragma omp for
-      for (int i = 0; i < N; i++) {
-        for (int j = 0; j < N; j++) {
-          int localpos = i * N + j;
-          // exponentiate
-          localg = complex<double>(0, 1.) * (*chi[localpos]);
-          localg.expm();
-          // reunitarize
-          localg.reu();
-
-          if (localg(2) != localg(2)) {
-            cout << "problem at " << i << " " << j << " with g=" << localg
-                 << endl;
-            localg = one;
-          }
+  // the next gauge fixing starts from the tuned value
+  if (tune && !relaxing_ && param->getGaugeFixWarmStart() > 0)
+    alpha_ = alpha;
 
-          lat->cells[localpos]->setg(localg);
-        }
-      }
+  return gfiter;
+}
+
+int GaugeFix::overrelaxation(Lattice *lat, Group *group, Parameters *param,
+                             int steps, double &gresidual) {
+  const int N = param->getSize();
+  const int Nc = param->getNc();
+
+  // overrelaxation probability; a non-positive gaugeFixAlpha lets the tuner
+  // choose it
+  const bool tune = (param->getGaugeFixAlpha() <= 0.);
+  const double alphaMax = 0.98;
+  double alpha = tune ? (alpha_ > 0. ? alpha_ : 0.9)
+                      : min(param->getGaugeFixAlpha(), 1.);
+  double lastResidual = 1e300;
+
+  Matrix **chi = chi_;
+
+  int gfiter;
+  for (gfiter = 0; gfiter < steps; gfiter++) {
+    gresidual = divergence(lat, group, param, chi);
+
+    if (gfiter == 0)
+      startResidual_ = gresidual;
+
+    if (gfiter % 10 == 0 && !relaxing_) {
+      cout << gfiter << " " << gresidual << endl;
     }
 
-    for (int i = 0; i < N; i++) {
-      for (int j = 0; j < N; j++) {
-        gaugeTransform(lat, param, i, j);
+    if (gresidual < tolerance) {
+      break;
+    }
+
+    if (tune && !relaxing_)
+      tuneAlpha(gresidual, lastResidual, alpha, alphaMax);
+
+    // sites of one parity only touch links shared with the other parity,
+    // so each half of the lattice is updated in parallel. For odd N the
+    // periodic boundary joins sites of equal parity, and the half-sweeps
+    // run on one thread instead.
+    for (int parity = 0; parity < 2; parity++) {
+#pragma omp parallel if (N % 2 == 0)
+      {
+        Matrix w(Nc), g(Nc), temp(Nc);
+#pragma omp for
+        for (int i = 0; i < N; i++) {
+          const int im = (i > 0) ? i - 1 : N - 1;
+          for (int j = (i + parity) % 2; j < N; j += 2) {
+            const int jm = (j > 0) ? j - 1 : N - 1;
+            const int pos = i * N + j;
+            Cell *cell = lat->cells[pos];
+            Matrix &UxMx = lat->cells[im * N + j]->getUx();
+            Matrix &UyMy = lat->cells[i * N + jm]->getUy();
+
+            // the site maximizes Re tr(g w)
+            for (int a = 0; a < Nc; a++)
+              for (int b = 0; b < Nc; b++)
+                w.set(a, b, cell->getUx()(a, b) + cell->getUy()(a, b) +
+                                conj(UxMx(b, a)) + conj(UyMy(b, a)));
+            for (int k = 0; k < Nc * Nc; k++)
+              g.set(k, (k % (Nc + 1) == 0) ? 1. : 0.);
+
+            // Cabibbo-Marinari: one SU(2) subgroup after the other
+            int subgroup = 0;
+            for (int r = 0; r < Nc - 1; r++) {
+              for (int s = r + 1; s < Nc; s++, subgroup++) {
+                // quaternion components of the (r,s) block of w
+                double a0 = 0.5 * (w(r, r) + w(s, s)).real();
+                double a1 = 0.5 * (w(r, s) + w(s, r)).imag();
+                double a2 = 0.5 * (w(r, s) - w(s, r)).real();
+                double a3 = 0.5 * (w(r, r) - w(s, s)).imag();
+                const double norm =
+                    sqrt(a0 * a0 + a1 * a1 + a2 * a2 + a3 * a3);
+                if (norm < 1e-15)
+                  continue;
+                // h = (block of w)^dagger / norm maximizes the subgroup
+                double h0 = a0 / norm, h1 = -a1 / norm, h2 = -a2 / norm,
+                       h3 = -a3 / norm;
+
+                // overrelax (h -> h^2) with probability alpha, from a hash
+                // of site, iteration and subgroup
+                unsigned long long z =
+                    (static_cast<unsigned long long>(pos) << 32) ^
+                    (static_cast<unsigned long long>(gfiter) << 4) ^ subgroup;
+                z += 0x9e3779b97f4a7c15ULL;
+                z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+                z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+                z ^= z >> 31;
+                if (static_cast<double>(z >> 11) / 9007199254740992. < alpha) {
+                  const double h0New = h0 * h0 - h1 * h1 - h2 * h2 - h3 * h3;
+                  h1 *= 2. * h0;
+                  h2 *= 2. * h0;
+                  h3 *= 2. * h0;
+                  h0 = h0New;
+                }
+
+                const complex<double> hrr(h0, h3), hrs(h2, h1),
+                    hsr(-h2, h1), hss(h0, -h3);
+                // w -> h w and g -> h g (rows r and s)
+                for (int c = 0; c < Nc; c++) {
+                  const complex<double> wr = w(r, c), ws = w(s, c);
+                  w.set(r, c, hrr * wr + hrs * ws);
+                  w.set(s, c, hsr * wr + hss * ws);
+                  const complex<double> gr = g(r, c), gs = g(s, c);
+                  g.set(r, c, hrr * gr + hrs * gs);
+                  g.set(s, c, hsr * gr + hss * gs);
+                }
+              }
+            }
+
+            // U_i(x) -> g U_i(x), U_i(x-i) -> U_i(x-i) g^dagger, and the
+            // fields at x -> g F g^dagger
+            multiply(g, cell->getUx(), temp);
+            cell->getUx() = temp;
+            multiply(g, cell->getUy(), temp);
+            cell->getUy() = temp;
+            multiplyDag(UxMx, g, temp);
+            UxMx = temp;
+            multiplyDag(UyMy, g, temp);
+            UyMy = temp;
+
+            transform(g, cell->getE1(), g, temp);
+            transform(g, cell->getE2(), g, temp);
+            transform(g, cell->getphi(), g, temp);
+            transform(g, cell->getpi(), g, temp);
+          }
+        }
       }
     }
   } // gfiter loop
 
-  for (int i = 0; i < N * N; i++) {
-    delete chi[i];
-  }
-  delete[] chi;
-}
+  // the next gauge fixing starts from the tuned value
+  if (tune && !relaxing_ && param->getGaugeFixWarmStart() > 0)
+    alpha_ = alpha;
 
-void GaugeFix::gaugeTransform(Lattice *lat, Parameters *param, int i, int j) {
-  int N = param->getSize();
-  int pos, posmX, posmY;
-  int Nc = param->getNc();
-  Matrix g(Nc), gdag(Nc), temp(Nc);
-
-  pos = i * N + j;
-  if (i > 0) {
-    posmX = (i - 1) * N + j;
-  } else {
-    posmX = (N - 1) * N + j;
-  }
-
-  if (j > 0) {
-    posmY = i * N + (j - 1);
-  } else {
-    posmY = i * N + N - 1;
-  }
+  return gfiter;
+}
 
-  g = gdag = lat->cells[pos]->getg();
-  gdag.conjg();
+void GaugeFix::gaugeTransform(Lattice *lat, Parameters *param) {
+  const int N = param->getSize();
+  const int Nc = param->getNc();
 
-  // gauge transform Ux and Uy
-  lat->cells[pos]->setUx(g * lat->cells[pos]->getUx());
-  lat->cells[pos]->setUy(g * lat->cells[pos]->getUy());
+  // U_i(x) -> g(x) U_i(x) g^dagger(x+i), fields at x -> g(x) F(x) g^dagger(x)
+#pragma omp parallel
+  {
+    Matrix temp(Nc);
+#pragma omp for
+    for (int i = 0; i < N; i++) {
+      const int ip = (i < N - 1) ? i + 1 : 0;
+      for (int j = 0; j < N; j++) {
+        const int jp = (j < N - 1) ? j + 1 : 0;
+        const int pos = i * N + j;
+        Cell *cell = lat->cells[pos];
+        const Matrix &g = cell->getg();
 
-  lat->cells[posmX]->setUx(lat->cells[posmX]->getUx() * gdag);
-  lat->cells[posmY]->setUy(lat->cells[posmY]->getUy() * gdag);
+        transform(g, cell->getUx(), lat->cells[ip * N + j]->getg(), temp);
+        transform(g, cell->getUy(), lat->cells[i * N + jp]->getg(), temp);
 
-  // gauge transform Ex and Ey
-  lat->cells[pos]->setE1(g * lat->cells[pos]->getE1() * gdag);
-  lat->cells[pos]->setE2(g * lat->cells[pos]->getE2() * gdag);
+        transform(g, cell->getE1(), g, temp);
+        transform(g, cell->getE2(), g, temp);
 
-  // gauge transform phi and pi
-  lat->cells[pos]->setphi(g * lat->cells[pos]->getphi() * gdag);
-  lat->cells[pos]->setpi(g * lat->cells[pos]->getpi() * gdag);
+        transform(g, cell->getphi(), g, temp);
+        transform(g, cell->getpi(), g, temp);
+      }
+    }
+  }
 }
@@ -28,22 +28,77 @@ private:
   // FFT *fft;
   // Random *random;
 
+  // gauge fixing stops once the residual is below this value
+  double const tolerance = 1e-9;
+
+  // state carried from one gauge fixing to the next (gaugeFixWarmStart > 0)
+  double alpha_;         // tuned step size or overrelaxation probability, 0
+                         // before the first gauge fixing
+  bool fixed_;           // the lattice has been gauge fixed before
+  bool relaxing_;        // single iterations between measurements: no output
+                         // and no tuning
+  double startResidual_; // residual before the last gauge fixing
+
+  // work arrays of N^2 matrices, allocated once for the event: the gradient
+  // chi (all methods), its preconditioned form p (methods 0 and 2), and p of
+  // the previous iteration pOld and the search direction d (method 2)
+  int sites_;
+  Matrix **chi_, **p_, **pOld_, **d_;
+  Matrix **allocate(int Nc);
+  void release(Matrix **m);
+
+  // chi -> (k_T^2)^{-1} chi, the Fourier preconditioner
+  void precondition(FFT *fft, Parameters *param, Matrix **chi);
+  // stores g = exp(i factor d) in the cells
+  void setg(Lattice *lat, Parameters *param, Matrix **d, double factor);
+  // sum_x Re tr(a(x) b(x))
+  double dot(Parameters *param, Matrix **a, Matrix **b);
+  // step size tuner: grows alpha slowly while the residual falls and halves
+  // it when the residual rises; returns true if the residual fell
+  bool tuneAlpha(double gresidual, double &lastResidual, double &alpha,
+                 double alphaMax);
+
 public:
-  // Constructor.
-  GaugeFix(){
-      //  fft = new FFT(nn);
-      // random = new Random();
-  };
+  // Constructor: allocates the work arrays that param's gaugeFixMethod needs
+  GaugeFix(Parameters *param);
 
   // Destructor.
-  ~GaugeFix(){
-      // delete fft;
-      // delete random;
+  ~GaugeFix() {
+    release(chi_);
+    release(p_);
+    release(pOld_);
+    release(d_);
+    // delete fft;
+    // delete random;
   };
 
-  void gaugeTransform(Lattice *lat, Parameters *param, int i, int j);
-  void FFTChi(FFT *fft, Lattice *lat, Group *group, Parameters *param,
-              int steps);
+  GaugeFix(const GaugeFix &) = delete;
+  GaugeFix &operator=(const GaugeFix &) = delete;
+
+  // sets chi = sum_a Im tr(div A t^a) t^a at every site and returns the
+  // residual (1/N^2) sum_x tr(chi^2)/Nc
+  double divergence(Lattice *lat, Group *group, Parameters *param,
+                    Matrix **chi);
+  // applies the g stored in the cells to all links and fields (in parallel:
+  // every site only writes its own links and reads its neighbours' g)
+  void gaugeTransform(Lattice *lat, Parameters *param);
+
+  // transverse Coulomb gauge with the method chosen by gaugeFixMethod; the
+  // iterations and the time to reach the tolerance are reported in
+  // usedParameters*.dat
+  void fixCoulombGauge(FFT *fft, Lattice *lat, Group *group, Parameters *param,
+                       int steps);
+  // one iteration of the gaugeFixMethod on a lattice that has been gauge fixed
+  // before, keeps the evolution near Coulomb gauge between measurements
+  void relax(FFT *fft, Lattice *lat, Group *group, Parameters *param);
+  // Fourier accelerated steepest descent, or nonlinear conjugate gradient
+  // with the same preconditioner; returns the number of iterations
+  int FFTChi(FFT *fft, Lattice *lat, Group *group, Parameters *param,
+             int steps, bool conjugateGradient, double &gresidual);
+  // stochastic overrelaxation in checkerboard sweeps over SU(2) subgroups;
+  // returns the number of iterations
+  int overrelaxation(Lattice *lat, Group *group, Parameters *param, int steps,
+                     double &gresidual);
 };
 
 #endif // GaugeFix_H
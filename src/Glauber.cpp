@@ -1,5 +1,8 @@
 #include "Glauber.h"
 #include "Util.h"
+#include <algorithm>
+#include <deque>
+#include <mutex>
 #include <string>
 #include <fstream>
 #include <iostream>
@@ -508,71 +511,125 @@ double *Glauber::ReadInVy(char *file_name, int maxi_num, int quiet) {
 
 /* %%%%%%%%%%%%%%%%%%%%%%%%%%%% */
 
-double Glauber::InterNuPInSP(double s) {
-  double y;
-  static int ind = 0;
-  static double up, down;
-  static int maxi_num;
-  static double *vx, *vy;
-  ind++;
+// T(s) of the species, built with the current SigmaNN, SCutOff and InterMax
+// on first use and shared by all later Glauber objects (events) and threads
+const ThicknessTable *Glauber::thicknessTable(const Nucleus &nucleus) {
+  static std::mutex mutex;
+  static std::deque<ThicknessTable> library;
+
+  std::lock_guard<std::mutex> lock(mutex);
+
+  const double sMax = 2.0 * GlauberData.SCutOff;
+  const int nIntervals = GlauberData.InterMax;
+  for (const ThicknessTable &table : library) {
+    const Nucleus &key = table.nucleus;
+    if (key.name == nucleus.name && key.A == nucleus.A &&
+        key.AnumFunc == nucleus.AnumFunc &&
+        key.DensityFunc == nucleus.DensityFunc &&
+        key.R_WS == nucleus.R_WS && key.a_WS == nucleus.a_WS &&
+        key.w_WS == nucleus.w_WS && key.rho_WS == nucleus.rho_WS &&
+        table.SigmaNN == GlauberData.SigmaNN && table.sMax == sMax &&
+        table.nIntervals == nIntervals)
+      return &table;
+  }
 
-  if (GlauberData.Projectile.A == 1.0)
-    return 0.0;
+  if (nIntervals < 3) {
+    cerr << "[Glauber::thicknessTable]: ERROR: need at least 3 intervals, "
+         << "InterMax=" << nIntervals << ". Exiting." << endl;
+    exit(1);
+  }
 
-  if (ind == 1) {
-    CalcRho(&(GlauberData.Projectile));
-    up = 2.0 * GlauberData.SCutOff;
-    down = 0.0;
-    maxi_num = GlauberData.InterMax;
-    vx = MakeVx(down, up, maxi_num);
-    vy = MakeVy(vx, maxi_num);
-  } /* if ind */
+  ThicknessTable table;
+  table.nucleus = nucleus;
+  table.SigmaNN = GlauberData.SigmaNN;
+  table.nIntervals = nIntervals;
+  table.sMax = sMax;
+  table.ds = sMax / nIntervals;
+  table.invDs = nIntervals / sMax;
+
+  Nucleus normalised = nucleus;
+  CalcRho(&normalised);
+  table.rho_WS = normalised.rho_WS;
+  std::vector<double> vy(nIntervals + 1);
+  for (int i = 0; i <= nIntervals; i++)
+    vy[i] = NuInS(table.ds * i);
+  Nuc_WS = NULL;
+
+  table.coefficients.resize(4 * (nIntervals - 2));
+  for (int iOrg = 0; iOrg <= nIntervals - 3; iOrg++) {
+    double *coeff = &table.coefficients[4 * iOrg];
+    MakeCoeff(&coeff[0], &coeff[1], &coeff[2], &coeff[3], &vy[0], table.ds,
+              iOrg);
+  }
 
-  if (s > up)
-    return 0.0;
-  else {
-    y = VInterpolate(s, vx, vy, maxi_num);
-    if (y < 0.0)
-      return 0.0;
-    else {
-      return y;
+  // inverse CDF of s in d^2s T(s), i.e. of the weight s T(s) on [0, sCut]:
+  // cumulative integral on a fine grid, inverted on a uniform grid in the
+  // probability. The inversion is linear in s^2, which is exact near s = 0.
+  const int nCdf = 4096;
+  const double sCut = std::min(15., sMax);
+  const double dsCdf = sCut / nCdf;
+  std::vector<double> cdf(nCdf + 1, 0.);
+  double fLow = 0.;
+  for (int i = 1; i <= nCdf; i++) {
+    const double f = dsCdf * i * table.value(dsCdf * i);
+    cdf[i] = cdf[i - 1] + 0.5 * (fLow + f) * dsCdf;
+    fLow = f;
+  }
+  if (cdf[nCdf] > 0.) {
+    table.inverseCdfS2.resize(nCdf + 1);
+    int i = 0;
+    for (int j = 0; j <= nCdf; j++) {
+      const double target = cdf[nCdf] * j / nCdf;
+      while (i < nCdf - 1 && cdf[i + 1] < target)
+        i++;
+      const double width = cdf[i + 1] - cdf[i];
+      double frac = (width > 0.) ? (target - cdf[i]) / width : 0.;
+      frac = std::min(std::max(frac, 0.), 1.);
+      const double s2Low = dsCdf * i * dsCdf * i;
+      const double s2High = dsCdf * (i + 1) * dsCdf * (i + 1);
+      table.inverseCdfS2[j] = s2Low + frac * (s2High - s2Low);
     }
   }
-} /* InterNuPInSP */
 
-double Glauber::InterNuTInST(double s) {
-  double y;
-  static int ind = 0;
-  static double up, down;
-  static int maxi_num;
-  static double *vx, *vy;
+  library.push_back(table);
+  return &library.back();
+}
 
-  ind++;
-  if (GlauberData.Target.A == 1.0)
+double ThicknessTable::value(double s) const {
+  if (s > sMax)
     return 0.0;
 
-  if (ind == 1) {
-    CalcRho(&(GlauberData.Target));
-
-    up = 2.0 * GlauberData.SCutOff;
-    down = 0.0;
-    maxi_num = GlauberData.InterMax;
+  // first of the four nodes, as in LinearFindXorg
+  int iOrg = static_cast<int>(s * invDs) - 1;
+  iOrg = std::min(std::max(iOrg, 0), nIntervals - 3);
+  const double t = s - ds * iOrg;
+  const double *coeff = &coefficients[4 * iOrg];
+  const double y = coeff[3] + t * (coeff[2] + t * (coeff[1] + t * coeff[0]));
+  if (y < 0.0)
+    return 0.0;
+  else
+    return y;
+}
 
-    vx = MakeVx(down, up, maxi_num);
-    vy = MakeVy(vx, maxi_num);
-  } /* if ind */
+// s distributed as s T(s) for a uniform u in [0,1]
+double ThicknessTable::sampleRadius(double u) const {
+  const int n = static_cast<int>(inverseCdfS2.size()) - 1;
+  const double x = u * n;
+  const int j = std::min(std::max(static_cast<int>(x), 0), n - 1);
+  const double frac = x - j;
+  return sqrt(inverseCdfS2[j] + frac * (inverseCdfS2[j + 1] - inverseCdfS2[j]));
+}
 
-  // cout << *vx << " " << *vy << endl;
+double Glauber::InterNuPInSP(double s) {
+  if (GlauberData.Projectile.A == 1.0)
+    return 0.0;
+  return projectileThickness_->value(s);
+} /* InterNuPInSP */
 
-  if (s > up)
+double Glauber::InterNuTInST(double s) {
+  if (GlauberData.Target.A == 1.0)
     return 0.0;
-  else {
-    y = VInterpolate(s, vx, vy, maxi_num);
-    if (y < 0.0)
-      return 0.0;
-    else
-      return y;
-  }
+  return targetThickness_->value(s);
 } /* InterNuTInST */
 
 void Glauber::CalcRho(Nucleus *nucleus) {
@@ -1190,65 +1247,36 @@ void Glauber::initGlauber(double SigmaNN, string Target, string Projectile,
   GlauberData.SCutOff = 12.;
 
   b = inb;
-}
 
-double Glauber::areaTA(double x, double A) {
-  double f;
-  f = A * 220. * (1. - exp(-0.025 * x * x));
-  return f;
+  // T_A(s) of both species, tabulated once per job
+  if (GlauberData.Projectile.A != 1.0) {
+    projectileThickness_ = thicknessTable(GlauberData.Projectile);
+    GlauberData.Projectile.rho_WS = projectileThickness_->rho_WS;
+  }
+  if (GlauberData.Target.A != 1.0) {
+    targetThickness_ = thicknessTable(GlauberData.Target);
+    GlauberData.Target.rho_WS = targetThickness_->rho_WS;
+  }
 }
 
-ReturnValue Glauber::SampleTARejection(Random *random, int PorT) {
+// Transverse position r(cos(phi), sin(phi)) with r distributed as r T_A(r)
+// (for the deuteron: the proton-neutron distance), from the inverse CDF of
+// the thickness table of the projectile (PorT=1) or target
+ReturnValue Glauber::SampleTA(Random *random, int PorT) {
   ReturnValue returnVec;
 
-  double r, x, y, tmp;
-  double phi;
-  double A = 1.2 * GlauberData.SigmaNN /
-             4.21325504715; // increase the envelope for larger sigma_inel
-                            // (larger root_s) (was originally written
-  // for root(s)=200 GeV, hence the cross section of 4.21325504715 fm^2 (=42.13
-  // mb)
-  cout.precision(10);
-  if (PorT == 1) {
-    do {
-      phi = 2. * M_PI * random->genrand64_real1();
-      r = 6.32456 *
-          sqrt(-log((-0.00454545 *
-                     (-220. * A + areaTA(15., A) * random->genrand64_real1())) /
-                    A));
-      // here random->genrand64_real1()*areaTA(GlauberData.SCutOff)
-      // is a uniform random number on [0, area under f(x)]
-      tmp = random->genrand64_real1();
-
-      // x is uniform on [0,1]
-      if (r * InterNuPInSP(r) > A * r * 11. * exp(-r * r / 40.))
-        cout << "WARNING: TA>envelope: "
-             << "TA=" << r * InterNuPInSP(r)
-             << ", f=" << A * r * 11. * exp(-r * r / 40.) << endl;
-    } while (tmp > r * InterNuPInSP(r) / (A * r * 11. * exp(-r * r / 40.)));
-  } else {
-    do {
-      phi = 2. * M_PI * random->genrand64_real1();
-      r = 6.32456 *
-          sqrt(-log((-0.00454545 *
-                     (-220. * A + areaTA(15., A) * random->genrand64_real1())) /
-                    A));
-      // here random->genrand64_real1()*areaTA(GlauberData.SCutOff)
-      // is a uniform random number on [0, area under f(x)]
-      tmp = random->genrand64_real1();
-      // x is uniform on [0,1]
-      if (r * InterNuTInST(r) > A * r * 11. * exp(-r * r / 40.))
-        cout << "WARNING: TA>envelope: "
-             << "TA=" << r * InterNuTInST(r)
-             << ", f=" << A * r * 11. * exp(-r * r / 40.) << endl;
-    } while (tmp > r * InterNuTInST(r) / (A * r * 11. * exp(-r * r / 40.)));
+  const ThicknessTable *table =
+      (PorT == 1) ? projectileThickness_ : targetThickness_;
+  if (table == NULL || table->inverseCdfS2.empty()) {
+    cerr << "[Glauber::SampleTA]: ERROR: no thickness table for "
+         << ((PorT == 1) ? "projectile" : "target") << ". Exiting." << endl;
+    exit(1);
   }
-  // reject if tmp is larger than the ratio p(y)/f(y),
-  // f(y)=A*r*11.*exp(-r*r/40.))
-  x = r * cos(phi);
-  y = r * sin(phi);
-  returnVec.x = x;
-  returnVec.y = y;
+
+  double phi = 2. * M_PI * random->genrand64_real1();
+  double r = table->sampleRadius(random->genrand64_real1());
+  returnVec.x = r * cos(phi);
+  returnVec.y = r * sin(phi);
   returnVec.collided = 0;
   return returnVec;
 }
@@ -2,6 +2,7 @@
 #define glauber_h
 
 #include "Random.h"
+#include <vector>
 
 #define TOL (1.0e-6)
 #define tiny (1.0e-10)
@@ -38,6 +39,27 @@ typedef struct nucleus {
   double da_np;
 } Nucleus;
 
+// Thickness function T(s) (times sigma_NN) of one nucleus species, tabulated
+// once per process on a uniform grid in s. Between the nodes it is the same
+// four-point cubic as VInterpolate, stored as coefficients in powers of
+// s - s_org so that a lookup is a single Horner evaluation.
+struct ThicknessTable {
+  Nucleus nucleus; // species and Woods-Saxon parameters, as passed (key)
+  double SigmaNN;
+  int nIntervals;
+  double sMax; // T(s) = 0 beyond sMax
+  double ds;
+  double invDs;
+  double rho_WS;                     // normalisation found by CalcRho
+  std::vector<double> coefficients; // a, b, c, d for every s_org
+  // inverse of the cumulative distribution of s in d^2s T(s) up to
+  // sampleRadius, as s^2 on a uniform grid in the cumulative probability
+  std::vector<double> inverseCdfS2;
+
+  double value(double s) const;
+  double sampleRadius(double u) const;
+};
+
 typedef struct data {
   double SigmaNN;
   Nucleus Target;
@@ -49,6 +71,8 @@ typedef struct data {
 
 class Glauber {
 private:
+  const ThicknessTable *projectileThickness_;
+  const ThicknessTable *targetThickness_;
 
 public:
   typedef double (*ptr_func)(double);
@@ -64,7 +88,7 @@ public:
   double currentZ1;
   double currentZ2;
 
-  Glauber(){};
+  Glauber() : projectileThickness_(NULL), targetThickness_(NULL){};
   ~Glauber() { remove("tmp.dat"); }
 
   double nucleusA1() const { return currentA1; }
@@ -93,6 +117,7 @@ public:
   double *ReadInVx(char *, int maxi_num, int quiet);
   double *ReadInVy(char *, int maxi_num, int quiet);
 
+  const ThicknessTable *thicknessTable(const Nucleus &nucleus);
   double InterNuPInSP(double s);
   double InterNuTInST(double s);
   void CalcRho(Nucleus *nucleus);
@@ -122,7 +147,6 @@ public:
                    double beta2, double beta3, double beta4, double gamma,
                    bool force_dmin, double d_min, double dR_np, double da_np,
                    int imax);
-  double areaTA(double x, double A);
-  ReturnValue SampleTARejection(Random *random, int PorT);
+  ReturnValue SampleTA(Random *random, int PorT);
 };
 #endif
@@ -1,8 +1,14 @@
 // Init.cpp is part of the IP-Glasma solver.
 // Copyright (C) 2012 Bjoern Schenke.
 #include "Init.h"
+#include "NodeShared.h"
+#include "NucleonGrid.h"
 #include "Phys_consts.h"
 #include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <utility>
 
 using namespace std;
@@ -107,7 +113,7 @@ void Init::sampleTA(Parameters *param, Random *random, Glauber *glauber) {
       nucleusA_.push_back(rv);
     } else if (A1 == 2) {
       // deuteron
-      rv = glauber->SampleTARejection(random, 1);
+      rv = glauber->SampleTA(random, 1);
       param->setRnp(sqrt(rv.x * rv.x + rv.y * rv.y));
       // we sample the neutron proton distance, so distance to the center needs
       // to be divided by 2
@@ -148,7 +154,7 @@ void Init::sampleTA(Parameters *param, Random *random, Glauber *glauber) {
       nucleusB_.push_back(rv2);
     } else if (A2 == 2) {
       // deuteron
-      rv = glauber->SampleTARejection(random, 2);
+      rv = glauber->SampleTA(random, 2);
       // we sample the neutron proton distance, so distance to the center needs
       // to be divided by 2
       param->setRnp(sqrt(rv.x * rv.x + rv.y * rv.y));
@@ -183,14 +189,15 @@ void Init::sampleTA(Parameters *param, Random *random, Glauber *glauber) {
           nucleusB_);
     }
   } else if (param->getNucleonPositionsFromFile() == 1) {
-      if (nucleonPosArrA_.size() > 0) {
+      if (nucleusConfigsA_ != NULL && nucleusConfigsA_->size() > 0) {
           double ran2 =random->genrand64_real3();
-          int nucleusNumber = static_cast<int>(ran2 * nucleonPosArrA_.size());
+          int nucleusNumber = static_cast<int>(ran2 * nucleusConfigsA_->size());
           std::cout << "using nucleus Number = " << nucleusNumber << std::endl;
+          const float *config = nucleusConfigsA_->configuration(nucleusNumber);
           for (int iA = 0; iA < glauber->nucleusA1(); iA++) {
-              rv.x = nucleonPosArrA_[nucleusNumber][3*iA];
-              rv.y = nucleonPosArrA_[nucleusNumber][3*iA + 1];
-              rv.z = nucleonPosArrA_[nucleusNumber][3*iA + 2];
+              rv.x = config[3*iA];
+              rv.y = config[3*iA + 1];
+              rv.z = config[3*iA + 2];
               rv.collided = 0;
               if (iA % 2 == 0) {
                 rv.proton = 0;
@@ -222,14 +229,15 @@ void Init::sampleTA(Parameters *param, Random *random, Glauber *glauber) {
               nucleusA_);
       }
 
-      if (nucleonPosArrB_.size() > 0) {
+      if (nucleusConfigsB_ != NULL && nucleusConfigsB_->size() > 0) {
           double ran2 =random->genrand64_real3();
-          int nucleusNumber = static_cast<int>(ran2 * nucleonPosArrB_.size());
+          int nucleusNumber = static_cast<int>(ran2 * nucleusConfigsB_->size());
           std::cout << "using nucleus Number = " << nucleusNumber << std::endl;
+          const float *config = nucleusConfigsB_->configuration(nucleusNumber);
           for (int iA = 0; iA < glauber->nucleusA2(); iA++) {
-              rv.x = nucleonPosArrB_[nucleusNumber][3*iA];
-              rv.y = nucleonPosArrB_[nucleusNumber][3*iA + 1];
-              rv.z = nucleonPosArrB_[nucleusNumber][3*iA + 2];
+              rv.x = config[3*iA];
+              rv.y = config[3*iA + 1];
+              rv.z = config[3*iA + 2];
               rv.collided = 0;
               if (iA % 2 == 0) {
                 rv.proton = 0;
@@ -446,32 +454,46 @@ void Init::sampleTA(Parameters *param, Random *random, Glauber *glauber) {
   //rotate_nucleus(random, nucleusB_);
   rotate_nucleus_3D(random, nucleusA_);
   rotate_nucleus_3D(random, nucleusB_);
+
+  // the heavier nucleus is the one kept in a Wilson line pool
+  pooledNucleus_ = (nucleusB_.size() >= nucleusA_.size()) ? 1 : 0;
+  if (param->getWilsonLinePool() == 2)
+    takeNucleusFromPool(param, random);
 }
 
 
-void Init::readNuclearQs(Parameters *param) {
+// cache image of the Q_s^2 table shared by all ranks of a node, see
+// shareNuclearQsTable
+const char *Init::sharedNuclearQs_ = NULL;
+
+static const char nuclearQsCacheMagic[8] = {'I', 'P', 'G', 'Q', 'S', '2', 'T', '1'};
+
+void Init::parseNuclearQsTable(const std::string &fileName,
+                               std::vector<double> &Tsource,
+                               std::vector<double> &Qs2Source) {
   // steps in qs0 and Y in the file
-  // double y[iymaxNuc];
-  // double qs0[ibmax];
   string dummy;
   string T, Qs;
   // open file
 
   std::cout << "Reading Q_s(sum(T_p),y) from file ";
 
-  std::cout << param->getNucleusQsTableFileName() << " ... " << std::endl;
+  std::cout << fileName << " ... " << std::endl;
+
+  Tsource.resize(iTpmax);
+  Qs2Source.resize(iTpmax * iymaxNuc);
 
   ifstream fin;
-  fin.open((param->getNucleusQsTableFileName()).c_str());
+  fin.open(fileName.c_str());
   if (fin) {
     for (int iT = 0; iT < iTpmax; iT++) {
       for (int iy = 0; iy < iymaxNuc; iy++) {
         if (!fin.eof()) {
           fin >> dummy;
           fin >> T;
-          Tlist[iT] = atof(T.c_str());
+          Tsource[iT] = atof(T.c_str());
           fin >> Qs;
-          Qs2Nuclear[iT][iy] = atof(Qs.c_str());
+          Qs2Source[iT * iymaxNuc + iy] = atof(Qs.c_str());
         } else {
           cerr << " End of file reached prematurely. Did the file change? "
                   "Exiting."
@@ -482,13 +504,215 @@ void Init::readNuclearQs(Parameters *param) {
     }
     fin.close();
   } else {
-    std::cout << "[Init.cpp:readNuclearQs]: File "
-         << param->getNucleusQsTableFileName() << " does not exist. Exiting."
-         << std::endl;
+    std::cout << "[Init.cpp:readNuclearQs]: File " << fileName
+              << " does not exist. Exiting." << std::endl;
     exit(1);
   }
 }
 
+// The Q_s^2 table in the form of its binary cache: the cache next to the text
+// table is read if it was made from the same text table (same size and FNV-1a
+// checksum) and for the same grid, otherwise the text table is parsed and the
+// cache is written anew.
+std::vector<char> Init::loadNuclearQsTable(const std::string &fileName,
+                                           int rank) {
+  ifstream source(fileName.c_str(), ios::binary);
+  if (!source) {
+    std::cout << "[Init.cpp:readNuclearQs]: File " << fileName
+              << " does not exist. Exiting." << std::endl;
+    exit(1);
+  }
+
+  NuclearQsCacheHeader expected;
+  memset(&expected, 0, sizeof(expected));
+  memcpy(expected.magic, nuclearQsCacheMagic, sizeof(expected.magic));
+  expected.nT = iTpmax;
+  expected.ny = iymaxNuc;
+  expected.deltaY = deltaYNuc;
+  unsigned long long checksum = 14695981039346656037ULL;
+  std::vector<char> buffer(1 << 16);
+  while (source.read(&buffer[0], buffer.size()) || source.gcount() > 0) {
+    const std::streamsize n = source.gcount();
+    for (std::streamsize i = 0; i < n; i++) {
+      checksum ^= static_cast<unsigned char>(buffer[i]);
+      checksum *= 1099511628211ULL;
+    }
+    expected.sourceBytes += static_cast<unsigned long long>(n);
+  }
+  source.close();
+  expected.sourceChecksum = checksum;
+
+  const std::string cacheName = fileName + ".bin";
+  std::vector<char> table;
+  if (readNuclearQsCache(cacheName, expected, table)) {
+    std::cout << "Reading Q_s(sum(T_p),y) from cache " << cacheName
+              << std::endl;
+    return table;
+  }
+
+  std::vector<double> Tsource, Qs2Source;
+  parseNuclearQsTable(fileName, Tsource, Qs2Source);
+  resampleNuclearQs(&Tsource[0], &Qs2Source[0], table);
+  NuclearQsCacheHeader *header =
+      reinterpret_cast<NuclearQsCacheHeader *>(&table[0]);
+  header->sourceBytes = expected.sourceBytes;
+  header->sourceChecksum = expected.sourceChecksum;
+  writeNuclearQsCache(cacheName, rank, table);
+  return table;
+}
+
+// Read the cache into table if it exists and matches the expected header; a
+// missing, truncated or stale cache returns false.
+bool Init::readNuclearQsCache(const std::string &cacheName,
+                              const NuclearQsCacheHeader &expected,
+                              std::vector<char> &table) {
+  const size_t bytes = sizeof(NuclearQsCacheHeader) +
+                       (iTpmax + iTpmax * iymaxNuc) * sizeof(double);
+  ifstream fin(cacheName.c_str(), ios::binary);
+  if (!fin)
+    return false;
+
+  std::vector<char> cache(bytes + 1);
+  fin.read(&cache[0], cache.size());
+  if (static_cast<size_t>(fin.gcount()) != bytes)
+    return false;
+  cache.resize(bytes);
+
+  const NuclearQsCacheHeader *header =
+      reinterpret_cast<const NuclearQsCacheHeader *>(&cache[0]);
+  const bool valid =
+      memcmp(header->magic, expected.magic, sizeof(expected.magic)) == 0 &&
+      header->nT == expected.nT && header->ny == expected.ny &&
+      header->deltaY == expected.deltaY &&
+      header->sourceBytes == expected.sourceBytes &&
+      header->sourceChecksum == expected.sourceChecksum;
+  if (valid)
+    table.swap(cache);
+  return valid;
+}
+
+// Write through a temporary file and rename it, so that runs sharing the
+// directory never see a partly written cache. The temporary file carries the
+// MPI rank and a unique mkstemp suffix, so ranks on different nodes of a
+// shared file system cannot collide. A directory that is not writable only
+// costs the parse in the next run.
+void Init::writeNuclearQsCache(const std::string &cacheName, int rank,
+                               const std::vector<char> &table) {
+  stringstream tmpTemplate;
+  tmpTemplate << cacheName << ".tmp" << rank << ".XXXXXX";
+  const std::string tmpPattern = tmpTemplate.str();
+  std::vector<char> tmpName(tmpPattern.begin(), tmpPattern.end());
+  tmpName.push_back('\0');
+
+  bool written = false;
+  int fd = mkstemp(&tmpName[0]);
+  if (fd >= 0) {
+    size_t done = 0;
+    while (done < table.size()) {
+      ssize_t n = write(fd, &table[done], table.size() - done);
+      if (n <= 0)
+        break;
+      done += static_cast<size_t>(n);
+    }
+    // mkstemp creates the file readable by the owner only
+    written = done == table.size() && fchmod(fd, 0644) == 0;
+    written = (close(fd) == 0) && written;
+    written = written && rename(&tmpName[0], cacheName.c_str()) == 0;
+    if (!written)
+      remove(&tmpName[0]);
+  }
+  if (!written) {
+    cerr << " [Init:writeNuclearQsCache]:WARNING: could not write " << cacheName
+         << ", the Q_s table will be parsed again in the next run." << endl;
+  }
+}
+
+// Collective over the ranks of a node: load the Q_s^2 table once per node
+// and keep it in node-shared memory for readNuclearQs
+void Init::shareNuclearQsTable(Parameters *param) {
+  const std::string fileName = param->getNucleusQsTableFileName();
+  const int rank = param->getMPIRank();
+  auto loader = [fileName, rank]() {
+    return loadNuclearQsTable(fileName, rank);
+  };
+  size_t bytes;
+  sharedNuclearQs_ = NodeShared::share(loader, bytes);
+}
+
+void Init::readNuclearQs(Parameters *param) {
+  std::vector<char> localTable;
+  const char *table = sharedNuclearQs_;
+  if (table == NULL) {
+    localTable = loadNuclearQsTable(param->getNucleusQsTableFileName(),
+                                    param->getMPIRank());
+    table = &localTable[0];
+  }
+
+  const NuclearQsCacheHeader *header =
+      reinterpret_cast<const NuclearQsCacheHeader *>(table);
+  const double *Tgrid =
+      reinterpret_cast<const double *>(table + sizeof(NuclearQsCacheHeader));
+  const double *Qs2grid = Tgrid + iTpmax;
+  logTmin_ = header->logTmin;
+  invDeltaLogT_ = 1. / header->deltaLogT;
+  memcpy(Tlist, Tgrid, sizeof(Tlist));
+  memcpy(Qs2Nuclear, Qs2grid, sizeof(Qs2Nuclear));
+}
+
+// Put the tabulated Q_s^2(T,y) onto a grid that is uniform in log(T) with the
+// same end points and number of nodes as the file, in the layout of the
+// binary cache. Interpolation between the source nodes is linear in T, as in
+// getNuclearQs2, so a table that is already log-spaced is reproduced exactly.
+void Init::resampleNuclearQs(const double *Tsource, const double *Qs2Source,
+                             std::vector<char> &table) {
+  if (Tsource[0] <= 0. || Tsource[iTpmax - 1] <= Tsource[0]) {
+    cerr << " [Init:resampleNuclearQs]:ERROR: T values in the Q_s table must "
+            "be positive and increasing. Exiting."
+         << endl;
+    exit(1);
+  }
+
+  table.assign(sizeof(NuclearQsCacheHeader) +
+                   (iTpmax + iTpmax * iymaxNuc) * sizeof(double),
+               0);
+  NuclearQsCacheHeader *header =
+      reinterpret_cast<NuclearQsCacheHeader *>(&table[0]);
+  double *Tgrid =
+      reinterpret_cast<double *>(&table[0] + sizeof(NuclearQsCacheHeader));
+  double *Qs2grid = Tgrid + iTpmax;
+
+  const double logTmin = log(Tsource[0]);
+  const double deltaLogT =
+      (log(Tsource[iTpmax - 1]) - logTmin) / static_cast<double>(iTpmax - 1);
+  memcpy(header->magic, nuclearQsCacheMagic, sizeof(header->magic));
+  header->nT = iTpmax;
+  header->ny = iymaxNuc;
+  header->logTmin = logTmin;
+  header->deltaLogT = deltaLogT;
+  header->deltaY = deltaYNuc;
+
+  int iS = 0;
+  for (int iT = 0; iT < iTpmax; iT++) {
+    double Tnode = exp(logTmin + iT * deltaLogT);
+    if (iT == 0)
+      Tnode = Tsource[0];
+    if (iT == iTpmax - 1)
+      Tnode = Tsource[iTpmax - 1];
+    Tgrid[iT] = Tnode;
+
+    while (iS < iTpmax - 2 && Tsource[iS + 1] <= Tnode)
+      iS++;
+    double fracT = (Tnode - Tsource[iS]) / (Tsource[iS + 1] - Tsource[iS]);
+    fracT = std::min(std::max(fracT, 0.), 1.);
+
+    for (int iy = 0; iy < iymaxNuc; iy++) {
+      Qs2grid[iT * iymaxNuc + iy] =
+          fracT * Qs2Source[(iS + 1) * iymaxNuc + iy] +
+          (1. - fracT) * Qs2Source[iS * iymaxNuc + iy];
+    }
+  }
+}
+
 // void Init::readNuclearQs(Parameters *param)
 // {
 //   int rank = param->getMPIRank();
@@ -560,10 +784,8 @@ void Init::readNuclearQs(Parameters *param) {
 // }
 
 
-void Init::readInNucleusConfigs(const int nucleusA,
-                                const int lightNucleusOption,
-                                vector< vector<float> > &nucleonPosArr) {
-    if (nucleonPosArr.size() > 0) return;
+const NucleusConfigurations *
+Init::readInNucleusConfigs(const int nucleusA, const int lightNucleusOption) {
     std::string path = "nucleusConfigurations/";
     std::string fileName;
     bool readFlag = true;
@@ -593,28 +815,30 @@ void Init::readInNucleusConfigs(const int nucleusA,
         readFlag = false;
     }
 
-    if (!readFlag) return;
+    if (!readFlag) return NULL;
 
     fileName = path + fileName;
-    messager << "read in nucleus configurations from " << fileName;
-    messager.flush("info");
-    std::ifstream inFile(fileName, std::ios::binary);
-    while (true) {
-        vector<float> tempPos;
-        for (int i = 0; i < nucleusA; i++) {
-            for (int j = 0; j < 3; j++) {
-                float temp;
-                inFile.read(reinterpret_cast<char*>(&temp), sizeof(float));
-                tempPos.push_back(temp);
-            }
+    // the file is mapped once per process and shared by all later events,
+    // a missing file is only reported for the first event
+    const bool firstUse = !NucleusConfigurations::tried(fileName);
+    if (firstUse) {
+        messager << "read in nucleus configurations from " << fileName;
+        messager.flush("info");
+    }
+    const NucleusConfigurations *configs =
+        NucleusConfigurations::get(fileName, nucleusA);
+    if (configs == NULL) {
+        if (firstUse) {
+            messager << "could not open " << fileName << ".";
+            messager.flush("warning");
         }
-        if (inFile.eof())
-            break;
-        nucleonPosArr.push_back(tempPos);
+        return NULL;
     }
-    inFile.close();
-    messager << "read in " << nucleonPosArr.size() << " configurations.";
-    messager.flush("info");
+    if (firstUse) {
+        messager << "read in " << configs->size() << " configurations.";
+        messager.flush("info");
+    }
+    return configs;
 }
 
 
@@ -698,62 +922,342 @@ void Init::samplePartonPositions(Parameters *param, Random *random,
 // Q_s as a function of \sum T_p and y (new in this version of the code - v1.2
 // and up)
 double Init::getNuclearQs2(double T, double y) {
-  double value, fracy, fracT, QsYdown, QsYup;
-  int posy, check = 0;
-  fracy = 0.;
-  posy = static_cast<int>(floor(y / deltaYNuc + 0.0000001));
-
   if (y > iymaxNuc * deltaYNuc) {
     cout << " [Init:getNuclearQs2]:ERROR: y out of range. Maximum y value is "
          << iymaxNuc * deltaYNuc << ", you used " << y << ". Exiting." << endl;
     exit(1);
   }
 
-  //  if ( T > Qs2Nuclear[iTpmax-1][iymaxNuc-1] )
+  if (T < Tlist[0]) {
+    return 0.;
+  }
+
   if (T > Tlist[iTpmax - 1]) {
     cerr << "T=" << T << ", maximal T in table=" << Tlist[iTpmax - 1] << endl;
     cerr << " [Init:getNuclearQs2]:WARNING: out of range. Using maximal T in "
             "table."
          << endl;
-    check = 1;
-    fracy = (y - static_cast<double>(posy) * deltaYNuc) / deltaYNuc;
-    QsYdown = (Qs2Nuclear[iTpmax - 1][posy]);
-    QsYup = (Qs2Nuclear[iTpmax - 1][posy + 1]);
-    value = (fracy * QsYup + (1. - fracy) * QsYdown); //*hbarc*hbarc;
-    return value;
+    T = Tlist[iTpmax - 1];
   }
 
-  if (T < Tlist[0]) {
-    check = 1;
+  // the T grid is uniform in log(T), the y grid is uniform in y:
+  // both cells are found directly, then interpolate bilinearly
+  double sT = (log(T) - logTmin_) * invDeltaLogT_;
+  int posT = std::min(std::max(static_cast<int>(sT), 0), iTpmax - 2);
+  double fracT = (T - Tlist[posT]) / (Tlist[posT + 1] - Tlist[posT]);
+  fracT = std::min(std::max(fracT, 0.), 1.);
+
+  double sy = y / deltaYNuc + 0.0000001;
+  int posy = std::min(std::max(static_cast<int>(sy), 0), iymaxNuc - 2);
+  double fracy = (y - static_cast<double>(posy) * deltaYNuc) / deltaYNuc;
+  fracy = std::min(std::max(fracy, 0.), 1.);
+
+  const double *QsTdown = Qs2Nuclear[posT];
+  const double *QsTup = Qs2Nuclear[posT + 1];
+  double QsYdown = fracT * QsTup[posy] + (1. - fracT) * QsTdown[posy];
+  double QsYup = fracT * QsTup[posy + 1] + (1. - fracT) * QsTdown[posy + 1];
+
+  return fracy * QsYup + (1. - fracy) * QsYdown;
+}
+
+// Fixed-point iteration for the fluctuating x: Q_s is evaluated at
+// y = log(0.01/x) with x = Q_s*xFromThisFactorTimesQs/sqrt(s)*exp(yShift),
+// extrapolating below y = 0 with (1-x)^5.6 (see 1212.2974 Eq. (17)).
+// When tabulating, a rapidity beyond the table is reported by returning -1
+// instead of exiting, so that the caller can fall back to a direct solve.
+double Init::solveFluctuatingxQs(Parameters *param, double T, double rapidity,
+                                 double yShift, bool tabulating) {
+  const double exponent = 5.6;
+  const double xPerQs =
+      param->getxFromThisFactorTimesQs() / param->getRoots() * exp(yShift);
+  double localrapidity = rapidity;
+  double Ydeviation = 10000;
+  double Qs = 1.;
+  int iter = 0;
+
+  while (abs(Ydeviation) > 0.001 && iter < 1000) {
+    if (tabulating && localrapidity > iymaxNuc * deltaYNuc)
+      return -1.;
+    if (localrapidity >= 0) {
+      Qs = sqrt(getNuclearQs2(T, abs(localrapidity)));
+    } else {
+      double xVal = Qs * xPerQs;
+      if (xVal == 0)
+        Qs = 0.;
+      else
+        Qs = sqrt(getNuclearQs2(T, 0.)) *
+             sqrt(pow((1 - xVal) / (1 - 0.01), exponent) *
+                  pow((0.01 / xVal), 0.2));
+    }
+    if (Qs == 0)
+      break;
+    Ydeviation = localrapidity - log(0.01 / (Qs * xPerQs));
+    localrapidity = log(0.01 / (Qs * xPerQs));
+    iter++;
+  }
+
+  if (Qs != Qs)
+    Qs = 0.;
+  return Qs;
+}
+
+// Within one call of setColorChargeDensity the converged Q_s of a site only
+// depends on its T, so solve it once per event on a fine log(T) grid instead
+// of once per lattice site. The result also depends on the starting rapidity,
+// on the value of yShift = +-yIn (not just its sign), on
+// xFromThisFactorTimesQs and sqrt(s), and on the full y dependence of the
+// nuclear Q_s table the iteration walks through, so the tables must not be
+// reused when any of these change.
+void Init::tabulateFluctuatingxQs(Parameters *param, double rapidity,
+                                  double yIn) {
+  QsFluctuatingxA_.resize(iTFluctx);
+  QsFluctuatingxB_.resize(iTFluctx);
+  const double deltaLogT =
+      (log(Tlist[iTpmax - 1]) - logTmin_) / static_cast<double>(iTFluctx - 1);
+
+#pragma omp parallel for
+  for (int iT = 0; iT < iTFluctx; iT++) {
+    double T = std::min(exp(logTmin_ + iT * deltaLogT), Tlist[iTpmax - 1]);
+    if (iT == 0)
+      T = Tlist[0];
+    QsFluctuatingxA_[iT] = solveFluctuatingxQs(param, T, rapidity, yIn, true);
+    QsFluctuatingxB_[iT] = solveFluctuatingxQs(param, T, rapidity, -yIn, true);
+  }
+}
+
+double Init::getFluctuatingxQs(Parameters *param,
+                               const std::vector<double> &QsTable, double T,
+                               double rapidity, double yShift) {
+  if (T < Tlist[0])
     return 0.;
+
+  double sT = (log(T) - logTmin_) * (iTFluctx - 1) /
+              (log(Tlist[iTpmax - 1]) - logTmin_);
+  int posT = static_cast<int>(sT);
+  // above the table or next to a node where the iteration left the y range:
+  // solve directly, which reproduces the warnings/errors of getNuclearQs2
+  if (posT >= iTFluctx - 1 || QsTable[posT] < 0. || QsTable[posT + 1] < 0.)
+    return solveFluctuatingxQs(param, T, rapidity, yShift, false);
+
+  double fracT = sT - posT;
+  return fracT * QsTable[posT + 1] + (1. - fracT) * QsTable[posT];
+}
+
+// Geometry-only stage of an event: shift the sampled nucleons by the impact
+// parameter and find the wounded nucleons and binary collisions with the NN
+// cross section. Returns false if the event can be rejected before any
+// lattice work, i.e. if no collision happened or N_part differs from
+// useFixedNpart.
+bool Init::findCollisions(Parameters *param, Random *random,
+                          Glauber *glauber) {
+  int A1, A2;
+  if (param->getNucleonPositionsFromFile() == 2) {
+    A1 = param->getA1FromFile();
+    A2 = param->getA2FromFile();
+  } else {
+    A1 = static_cast<int>(glauber->nucleusA1()) * param->getAverageOverNuclei();
+    A2 = static_cast<int>(glauber->nucleusA2()) * param->getAverageOverNuclei();
   }
 
-  for (int iT = 0; iT < iTpmax; iT++) {
-    if (T >= Tlist[iT] && T < Tlist[iT + 1]) {
-      fracT = (T - Tlist[iT]) / (Tlist[iT + 1] - Tlist[iT]);
-      fracy = (y - static_cast<double>(posy) * deltaYNuc) / deltaYNuc;
+  int Npart = 0;
+  int Ncoll = 0;
+  double b = param->getb();
+  double dx, dy, dij;
+  double d2 = param->getSigmaNN() / (M_PI * 10.); // in fm^2
+
+  // positions are shifted here. not later as in previous versions. bshift below
+  // (in init(..)) is zero.
+
+  if (A1 < 4 && A2 > 1) {
+    nucleusShift_[0] = 0.;
+    nucleusShift_[1] = b;
+  } else if (A2 < 4 && A1 > 1) {
+    nucleusShift_[0] = -b;
+    nucleusShift_[1] = 0.;
+  } else {
+    // shift the nuclei's position by -b/2 or +b/2 respectively
+    nucleusShift_[0] = -b / 2.;
+    nucleusShift_[1] = b / 2.;
+  }
+  for (int i = 0; i < A1; i++) {
+    nucleusA_.at(i).x = nucleusA_.at(i).x + nucleusShift_[0];
+  }
+  for (int i = 0; i < A2; i++) {
+    nucleusB_.at(i).x = nucleusB_.at(i).x + nucleusShift_[1];
+  }
 
-      QsYdown = (fracT) * (Qs2Nuclear[iT + 1][posy]) +
-                (1. - fracT) * (Qs2Nuclear[iT][posy]);
-      QsYup = (fracT) * (Qs2Nuclear[iT + 1][posy + 1]) +
-              (1. - fracT) * (Qs2Nuclear[iT][posy + 1]);
-      value = (fracy * QsYup + (1. - fracy) * QsYdown); //*hbarc*hbarc;
+  // the smooth nucleus has no nucleons to collide
+  if (param->getUseSmoothNucleus() == 1) {
+    param->setNcoll(0);
+    return true;
+  }
 
-      check++;
-      continue;
+  // transverse grid of nucleus B with cell size sqrt(sigma_NN/pi), so that
+  // only neighbouring nucleons are tested for collisions
+  NucleonGrid gridB(nucleusB_, A2, sqrt(d2));
+  std::vector<int> partners;
+
+  stringstream strNcoll_name;
+  strNcoll_name << "NcollList" << param->getEventId() << ".dat";
+  string Ncoll_name;
+  Ncoll_name = strNcoll_name.str();
+
+  ofstream foutNcoll(Ncoll_name.c_str(), ios::out);
+
+  if (param->getGaussianWounding() == 0) {
+    for (int i = 0; i < A1; i++) {
+      gridB.neighbours(nucleusA_.at(i).x, nucleusA_.at(i).y, d2, partners);
+      for (unsigned int jp = 0; jp < partners.size(); jp++) {
+        int j = partners[jp];
+        foutNcoll << (nucleusB_.at(j).x + nucleusA_.at(i).x) / 2. << " "
+                  << (nucleusB_.at(j).y + nucleusA_.at(i).y) / 2. << endl;
+        Ncoll++;
+        nucleusB_.at(j).collided = 1;
+        nucleusA_.at(i).collided = 1;
+      }
+    }
+  } else {
+    double p;
+    double G = 0.92;
+    double ran;
+
+    // pairs further apart than 5 sqrt(d2) have p < 1e-10 and are skipped
+    for (int i = 0; i < A1; i++) {
+      gridB.neighbours(nucleusA_.at(i).x, nucleusA_.at(i).y, 25. * d2,
+                       partners);
+      for (unsigned int jp = 0; jp < partners.size(); jp++) {
+        int j = partners[jp];
+        dx = nucleusB_.at(j).x - nucleusA_.at(i).x;
+        dy = nucleusB_.at(j).y - nucleusA_.at(i).y;
+        dij = dx * dx + dy * dy;
+
+        p = G * exp(-G * dij / d2); // Gaussian profile
+
+        ran = random->genrand64_real1();
+
+        if (ran < p) {
+          foutNcoll << (nucleusB_.at(j).x + nucleusA_.at(i).x) / 2. << " "
+                    << (nucleusB_.at(j).y + nucleusA_.at(i).y) / 2. << endl;
+          Ncoll++;
+          nucleusB_.at(j).collided = 1;
+          nucleusA_.at(i).collided = 1;
+        }
+      }
     }
   }
 
-  if (check != 1) {
-    cout << check << ": T=" << T << endl;
-    cerr << " [Init:getNuclearQs2]:ERROR: something went wrong in determining "
-            "the value of Qs^2. Using maximal T_p"
-         << endl;
-    value = (fracy * Qs2Nuclear[iTpmax - 1][posy + 1] +
-             (1. - fracy) * Qs2Nuclear[iTpmax - 1][posy]);
+  foutNcoll.close();
+
+  stringstream strNpart_name;
+  strNpart_name << "NpartList" << param->getEventId() << ".dat";
+  string Npart_name;
+  Npart_name = strNpart_name.str();
+
+  ofstream foutNpart(Npart_name.c_str(), ios::out);
+
+  for (int i = 0; i < A1; i++) {
+    foutNpart << nucleusA_.at(i).x << " " << nucleusA_.at(i).y << " "
+              << nucleusA_.at(i).proton << " " << nucleusA_.at(i).collided
+              << endl;
+  }
+  foutNpart << endl;
+  for (int i = 0; i < A2; i++) {
+    foutNpart << nucleusB_.at(i).x << " " << nucleusB_.at(i).y << " "
+              << nucleusB_.at(i).proton << " " << nucleusB_.at(i).collided
+              << endl;
+  }
+  foutNpart.close();
+
+  // in p+p assume that they collided in any case
+  if (A1 == 1 && A2 == 1) {
+    nucleusB_.at(0).collided = 1;
+    nucleusA_.at(0).collided = 1;
+  }
+
+  Npart = 0;
+
+  for (int i = 0; i < A1; i++) {
+    if (nucleusA_.at(i).collided == 1)
+      Npart++;
+  }
+
+  for (int i = 0; i < A2; i++) {
+    if (nucleusB_.at(i).collided == 1)
+      Npart++;
+  }
+
+  param->setNpart(Npart);
+  param->setNcoll(Ncoll);
+
+  if (Npart < 2)
+    return false;
+
+  if (param->getUseFixedNpart() != 0 && Npart != param->getUseFixedNpart()) {
+    cout << "current Npart = " << Npart << endl;
+    return false;
+  }
+  return true;
+}
+
+// The geometry of an event is accepted if findCollisions finds a collision
+// and, with the centrality trigger on N_part (centralityEstimator=1) or
+// N_coll (2), the estimator is inside the requested window.
+bool Init::acceptGeometry(Parameters *param, Random *random,
+                          Glauber *glauber) {
+  if (!findCollisions(param, random, glauber))
+    return false;
+
+  const int estimator = param->getCentralityEstimator();
+  if (estimator == 0)
+    return true;
+
+  centralityCandidates_++;
+  if (estimator == 1 || estimator == 2) {
+    const double value = (estimator == 1) ? param->getNpart()
+                                          : param->getNcoll();
+    if (!inCentralityWindow(param, value)) {
+      centralityRejectedGeometry_++;
+      cout << ((estimator == 1) ? "N_part=" : "N_coll=") << value
+           << " outside the centrality window." << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Exit if the N_part (centralityEstimator=1) or N_coll (2) window cannot be
+// reached by the colliding nuclei: a collision has 2 <= N_part <= A1 + A2
+// and 1 <= N_coll <= A1 A2.
+void Init::checkCentralityWindow(Parameters *param, Glauber *glauber) {
+  const int estimator = param->getCentralityEstimator();
+  if (estimator != 1 && estimator != 2)
+    return;
+
+  double A1, A2;
+  if (param->getNucleonPositionsFromFile() == 2) {
+    A1 = param->getA1FromFile();
+    A2 = param->getA2FromFile();
+  } else {
+    A1 = static_cast<int>(glauber->nucleusA1()) * param->getAverageOverNuclei();
+    A2 = static_cast<int>(glauber->nucleusA2()) * param->getAverageOverNuclei();
+  }
+  const double lowest = (estimator == 1) ? 2. : 1.;
+  const double highest = (estimator == 1) ? A1 + A2 : A1 * A2;
+  if (param->getCentralityEstimatorMax() <= lowest ||
+      param->getCentralityEstimatorMin() > highest) {
+    cerr << "[Init::checkCentralityWindow]: ERROR: the window ["
+         << param->getCentralityEstimatorMin() << ", "
+         << param->getCentralityEstimatorMax() << ") of "
+         << ((estimator == 1) ? "N_part" : "N_coll")
+         << " does not overlap the possible range [" << lowest << ", "
+         << highest << "] of the collision. Exiting." << endl;
+    exit(1);
   }
+}
 
-  return value;
+bool Init::inCentralityWindow(Parameters *param, double estimator) {
+  return estimator >= param->getCentralityEstimatorMin() &&
+         estimator < param->getCentralityEstimatorMax();
 }
 
 // set g^2\mu^2 as the sum of the individual nucleons' g^2\mu^2, using Q_s(b,y)
@@ -773,8 +1277,9 @@ void Init::setColorChargeDensity(Lattice *lat, Parameters *param,
     A2 = static_cast<int>(glauber->nucleusA2()) * param->getAverageOverNuclei();
   }
 
-  int Npart = 0;
-  int Ncoll = 0;
+  // wounded nucleons and binary collisions, from findCollisions
+  int Npart = param->getNpart();
+  int Ncoll = param->getNcoll();
   double g2mu2A, g2mu2B;
   double b = param->getb();
   double r;
@@ -800,7 +1305,6 @@ void Init::setColorChargeDensity(Lattice *lat, Parameters *param,
 
   double yIn = rapidity; // param->getRapidity();
   double a = L / N;      // lattice spacing in fm
-  double dx, dy, dij;
   double d2 = param->getSigmaNN() / (M_PI * 10.); // in fm^2
   double averageQs = 0.;
   double averageQs2 = 0.;
@@ -861,32 +1365,6 @@ void Init::setColorChargeDensity(Lattice *lat, Parameters *param,
     }
   }
 
-  // compute N_part
-  // positions are shifted here. not later as in previous versions. bshift below
-  // (in init(..)) is zero.
-
-  if (A1 < 4 && A2 > 1) {
-    for (int i = 0; i < A2; i++) {
-      nucleusB_.at(i).x = nucleusB_.at(i).x + b;
-    }
-  } else if (A2 < 4 && A1 > 1) {
-    for (int i = 0; i < A1; i++) {
-      nucleusA_.at(i).x = nucleusA_.at(i).x - b;
-    }
-  } else {
-    for (int i = 0; i < A1;
-         i++) // shift the nuclei's position by -b/2 or +b/2 respectively
-    {
-      nucleusA_.at(i).x = nucleusA_.at(i).x - b / 2.;
-    }
-
-    for (int i = 0; i < A2;
-         i++) // shift the nuclei's position by -b/2 or +b/2 respectively
-    {
-      nucleusB_.at(i).x = nucleusB_.at(i).x + b / 2.;
-    }
-  }
-
   double xi = param->getProtonAnisotropy();
 
   if (xi != 0.) {
@@ -911,7 +1389,32 @@ void Init::setColorChargeDensity(Lattice *lat, Parameters *param,
   vector< vector<double> > xq1, xq2, yq1, yq2, BGq1, BGq2, gauss1, gauss2;
   vector<double> x_array, y_array, z_array, BGq_array, gauss_array;
 
+  // in a parameter sweep the sub-nucleon structure of every nucleon comes from
+  // its own random stream, so that a parameter that changes the number of
+  // random numbers drawn for one nucleon (N_q, d_qmin) does not shift the
+  // random numbers of all the others. The stream of a nucleon holds the noise
+  // event in bits 32-62, the attempt in bits 20-31, the nucleus in bit 19 and
+  // the nucleon in bits 0-18; bit 63 separates these streams from the event
+  // streams that main.cpp reseeds with the noise event id alone.
+  const bool commonRandomNumbers = param->getSubNucleonParamSweep() > 1;
+  if (commonRandomNumbers &&
+      (A1 >= (1 << 19) || A2 >= (1 << 19) || densityAttempt_ >= (1 << 12))) {
+    cerr << "[Init::setColorChargeDensity]: ERROR: " << A1 << " and " << A2
+         << " nucleons, attempt " << densityAttempt_
+         << " do not fit into the random streams of the parameter sweep. "
+            "Exiting."
+         << endl;
+    exit(1);
+  }
+  const unsigned long long nucleonStream =
+      (1ULL << 63) |
+      (static_cast<unsigned long long>(param->getNoiseEventId()) << 32) |
+      (static_cast<unsigned long long>(densityAttempt_) << 20);
+  densityAttempt_++;
+
   for (int i = 0; i < A1; i++) {
+    if (commonRandomNumbers)
+      random->reseed(param->getRandomSeed(), nucleonStream | i);
     x_array.clear();
     if (NqFlag > 0) {
       samplePartonPositions(param, random, x_array, y_array, z_array,
@@ -930,6 +1433,8 @@ void Init::setColorChargeDensity(Lattice *lat, Parameters *param,
   }
 
   for (int i = 0; i < A2; i++) {
+    if (commonRandomNumbers)
+      random->reseed(param->getRandomSeed(), nucleonStream | (1ULL << 19) | i);
     x_array.clear();
     if (NqFlag > 0) {
       samplePartonPositions(param, random, x_array, y_array, z_array,
@@ -1096,122 +1601,28 @@ void Init::setColorChargeDensity(Lattice *lat, Parameters *param,
     }
   }
 
-  if (param->getUseSmoothNucleus() == 0) {
-    stringstream strNcoll_name;
-    strNcoll_name << "NcollList" << param->getEventId() << ".dat";
-    string Ncoll_name;
-    Ncoll_name = strNcoll_name.str();
-
-    ofstream foutNcoll(Ncoll_name.c_str(), ios::out);
-
-    if (param->getGaussianWounding() == 0) {
-      for (int i = 0; i < A1; i++) {
-        for (int j = 0; j < A2; j++) {
-          dx = nucleusB_.at(j).x - nucleusA_.at(i).x;
-          dy = nucleusB_.at(j).y - nucleusA_.at(i).y;
-          dij = dx * dx + dy * dy;
-          if (dij < d2) {
-            foutNcoll << (nucleusB_.at(j).x + nucleusA_.at(i).x) / 2. << " "
-                      << (nucleusB_.at(j).y + nucleusA_.at(i).y) / 2. << endl;
-            Ncoll++;
-            nucleusB_.at(j).collided = 1;
-            nucleusA_.at(i).collided = 1;
-          }
-        }
-      }
-    } else {
-      double p;
-      double G = 0.92;
-      double ran;
-
-      for (int i = 0; i < A1; i++) {
-        for (int j = 0; j < A2; j++) {
-          dx = nucleusB_.at(j).x - nucleusA_.at(i).x;
-          dy = nucleusB_.at(j).y - nucleusA_.at(i).y;
-          dij = dx * dx + dy * dy;
-
-          p = G * exp(-G * dij / d2); // Gaussian profile
-
-          ran = random->genrand64_real1();
-
-          if (ran < p) {
-            foutNcoll << (nucleusB_.at(j).x + nucleusA_.at(i).x) / 2. << " "
-                      << (nucleusB_.at(j).y + nucleusA_.at(i).y) / 2. << endl;
-            Ncoll++;
-            nucleusB_.at(j).collided = 1;
-            nucleusA_.at(i).collided = 1;
-          }
-        }
-      }
-    }
-
-    foutNcoll.close();
-
-    stringstream strNpart_name;
-    strNpart_name << "NpartList" << param->getEventId() << ".dat";
-    string Npart_name;
-    Npart_name = strNpart_name.str();
-
-    ofstream foutNpart(Npart_name.c_str(), ios::out);
-
-    for (int i = 0; i < A1; i++) {
-      foutNpart << nucleusA_.at(i).x << " " << nucleusA_.at(i).y << " "
-                << nucleusA_.at(i).proton << " " << nucleusA_.at(i).collided
-                << endl;
-    }
-    foutNpart << endl;
-    for (int i = 0; i < A2; i++) {
-      foutNpart << nucleusB_.at(i).x << " " << nucleusB_.at(i).y << " "
-                << nucleusB_.at(i).proton << " " << nucleusB_.at(i).collided
-                << endl;
-    }
-    foutNpart.close();
-
-    // in p+p assume that they collided in any case
-    if (A1 == 1 && A2 == 1) {
-      nucleusB_.at(0).collided = 1;
-      nucleusA_.at(0).collided = 1;
-    }
-
-    Npart = 0;
-
-    for (int i = 0; i < A1; i++) {
-      if (nucleusA_.at(i).collided == 1)
-        Npart++;
-    }
-
-    for (int i = 0; i < A2; i++) {
-      if (nucleusB_.at(i).collided == 1)
-        Npart++;
-    }
-
-    param->setNpart(Npart);
-
-    if (param->getUseFixedNpart() != 0 && Npart != param->getUseFixedNpart()) {
-      cout << "current Npart = " << Npart << endl;
-      return;
-    }
-  }
+  // transverse grids of the nucleons with cell size sqrt(sigma_NN/pi), so that
+  // only neighbouring nucleons are tested for the wounded region
+  NucleonGrid gridA(nucleusA_, A1, sqrt(d2));
+  NucleonGrid gridB(nucleusB_, A2, sqrt(d2));
   // get Q_s^2 (and from that g^2mu^2) for a given \sum T_p and Y
+  if (param->getUseFluctuatingx() == 1)
+    tabulateFluctuatingxQs(param, rapidity, yIn);
+
 #pragma omp parallel
   {
     //    double x;
     //    double y;
     int localpos;
-    double Ydeviation = 10000;
     double QsA, QsB, distanceA, distanceB;
-    double xVal;
     double localrapidity = rapidity;
     int check;
-    QsA = 1;
-    QsB = 1;
 
 #pragma omp for
     for (int ix = 0; ix < N; ix++) // loop over all positions
     {
       // x = -L/2.+a*ix;
       for (int iy = 0; iy < N; iy++) {
-        Ydeviation = 10000;
         check = 0;
         // y = -L/2.+a*iy;
         localpos = ix * N + iy;
@@ -1261,91 +1672,34 @@ void Init::setColorChargeDensity(Lattice *lat, Parameters *param,
           }
         }
 
-        double exponent = 5.6; // see 1212.2974 Eq. (17)
         if (check == 2) {
           if (param->getUseFluctuatingx() == 1) {
-            // iterative loops here to determine the fluctuating Y
-            // _-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-
-            while (abs(Ydeviation) > 0.001) {
-              if (localrapidity >= 0) {
-                QsA = sqrt(getNuclearQs2(lat->cells[localpos]->getTpA(),
-                                         abs(localrapidity)));
-              } else {
-                xVal = QsA * param->getxFromThisFactorTimesQs() /
-                       param->getRoots() * exp(yIn);
-                if (xVal == 0)
-                  QsA = 0.;
-                else
-                  QsA =
-                      sqrt(getNuclearQs2(lat->cells[localpos]->getTpA(), 0.)) *
-                      sqrt(pow((1 - xVal) / (1 - 0.01), exponent) *
-                           pow((0.01 / xVal), 0.2));
-              }
-              if (QsA == 0) {
-                Ydeviation = 0;
-                lat->cells[localpos]->setg2mu2A(0.);
-              } else {
-                // nucleus A
-                lat->cells[localpos]->setg2mu2A(
-                    QsA * QsA / param->getQsmuRatio() / param->getQsmuRatio() *
-                    a * a / hbarc / hbarc / param->getg() /
-                    param->getg()); // lattice units? check
-
-                Ydeviation =
-                    localrapidity -
-                    log(0.01 / (QsA * param->getxFromThisFactorTimesQs() /
-                                param->getRoots() * exp(yIn)));
-                localrapidity =
-                    log(0.01 / (QsA * param->getxFromThisFactorTimesQs() /
-                                param->getRoots() * exp(yIn)));
-              }
-            }
+            // converged Q_s of the fluctuating-x iteration, see
+            // tabulateFluctuatingxQs
+            QsA = getFluctuatingxQs(param, QsFluctuatingxA_,
+                                    lat->cells[localpos]->getTpA(), rapidity,
+                                    yIn);
+            // nucleus A
+            lat->cells[localpos]->setg2mu2A(
+                QsA * QsA / param->getQsmuRatio() / param->getQsmuRatio() * a *
+                a / hbarc / hbarc / param->getg() /
+                param->getg()); // lattice units? check
             if (lat->cells[localpos]->getg2mu2A() !=
                 lat->cells[localpos]->getg2mu2A()) {
               lat->cells[localpos]->setg2mu2A(0.);
             }
 
-            localrapidity = rapidity;
-            Ydeviation = 10000;
-            while (abs(Ydeviation) > 0.001) {
-              if (localrapidity >= 0)
-                QsB = sqrt(getNuclearQs2(lat->cells[localpos]->getTpB(),
-                                         abs(localrapidity)));
-              else {
-                xVal = QsB * param->getxFromThisFactorTimesQs() /
-                       param->getRoots() * exp(-yIn);
-                if (xVal == 0)
-                  QsB = 0.;
-                else
-                  QsB =
-                      sqrt(getNuclearQs2(lat->cells[localpos]->getTpB(), 0.)) *
-                      sqrt(pow((1 - xVal) / (1 - 0.01), exponent) *
-                           pow((0.01 / xVal), 0.2));
-              }
-              if (QsB == 0) {
-                Ydeviation = 0;
-                lat->cells[localpos]->setg2mu2B(0.);
-              } else {
-                // nucleus B
-                lat->cells[localpos]->setg2mu2B(
-                    QsB * QsB / param->getQsmuRatioB() /
-                    param->getQsmuRatioB() * a * a / hbarc / hbarc /
-                    param->getg() / param->getg());
-                Ydeviation =
-                    localrapidity -
-                    log(0.01 / (QsB * param->getxFromThisFactorTimesQs() /
-                                param->getRoots() * exp(-yIn)));
-                localrapidity =
-                    log(0.01 / (QsB * param->getxFromThisFactorTimesQs() /
-                                param->getRoots() * exp(-yIn)));
-              }
-            }
+            QsB = getFluctuatingxQs(param, QsFluctuatingxB_,
+                                    lat->cells[localpos]->getTpB(), rapidity,
+                                    -yIn);
+            // nucleus B
+            lat->cells[localpos]->setg2mu2B(
+                QsB * QsB / param->getQsmuRatioB() / param->getQsmuRatioB() *
+                a * a / hbarc / hbarc / param->getg() / param->getg());
             if (lat->cells[localpos]->getg2mu2B() !=
                 lat->cells[localpos]->getg2mu2B()) {
               lat->cells[localpos]->setg2mu2B(0.);
             }
-            // _-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-_-
-            // end iterative loops here
           } else {
             // nucleus A
             lat->cells[localpos]->setg2mu2A(
@@ -1366,7 +1720,7 @@ void Init::setColorChargeDensity(Lattice *lat, Parameters *param,
 
   count = 0;
   double Tpp = 0.;
-  double x, xm, y, ym;
+  double x, y;
   double alphas = 0.;
   int check = 0;
   for (int ix = 0; ix < N; ix++) // loop over all positions
@@ -1401,24 +1755,12 @@ void Init::setColorChargeDensity(Lattice *lat, Parameters *param,
                           param->getg() * param->getg();
       }
 
-      for (int i = 0; i < A1; i++) {
-        xm = nucleusA_.at(i).x;
-        ym = nucleusA_.at(i).y;
-        r = sqrt((x - xm) * (x - xm) + (y - ym) * (y - ym));
-
-        if (r < sqrt(0.1 * param->getSigmaNN() / M_PI) &&
-            nucleusA_.at(i).collided == 1) {
-          check = 1;
-        }
-      }
-
-      for (int i = 0; i < A2; i++) {
-        xm = nucleusB_.at(i).x;
-        ym = nucleusB_.at(i).y;
-        r = sqrt((x - xm) * (x - xm) + (y - ym) * (y - ym));
-
-        if (r < sqrt(0.1 * param->getSigmaNN() / M_PI) &&
-            nucleusB_.at(i).collided == 1 && check == 1)
+      // is the site within sqrt(sigma_NN/pi) of a wounded nucleon of A and B?
+      if (gridA.collidedNucleonWithin(x, y,
+                                      0.1 * param->getSigmaNN() / M_PI)) {
+        check = 1;
+        if (gridB.collidedNucleonWithin(x, y,
+                                        0.1 * param->getSigmaNN() / M_PI))
           check = 2;
       }
 
@@ -1539,9 +1881,22 @@ void Init::setColorChargeDensity(Lattice *lat, Parameters *param,
     alphas = param->getg() * param->getg() / 4. / M_PI;
   }
 
+  // centrality trigger on Q_s^2(min) S_T (centralityEstimator=3), the
+  // estimator written to NgluonEstimators below
+  bool triggered = true;
+  if (param->getCentralityEstimator() == 3 &&
+      !inCentralityWindow(param, averageQs2min2 * a * a / hbarc / hbarc)) {
+    triggered = false;
+    centralityRejectedQs_++;
+    cout << " **** Rejected event - Qsmin^2 S_T="
+         << averageQs2min2 * a * a / hbarc / hbarc
+         << " outside the centrality window." << endl;
+  }
+
   if (param->getAverageQs() > 0 && param->getAverageQsAvg() > 0 &&
       averageQs2 > 0 && param->getAverageQsmin() > 0 && averageQs2Avg > 0 &&
-      alphas > 0 && Npart >= 2 && averageQs2min2 * a * a / hbarc / hbarc > param->getMinimumQs2ST())
+      alphas > 0 && Npart >= 2 && averageQs2min2 * a * a / hbarc / hbarc > param->getMinimumQs2ST() &&
+      triggered)
     {
       param->setSuccess(1);
       stringstream strup_name;
@@ -1567,6 +1922,17 @@ void Init::setColorChargeDensity(Lattice *lat, Parameters *param,
               << " <Q_s>) = " << param->getalphas() << endl;
       } else
         fout1 << "using fixed coupling alpha_s=" << param->getalphas() << endl;
+      if (param->getCentralityEstimator() > 0) {
+        // the accepted fraction of events with a collision is
+        // 1/(candidates) for this event
+        fout1 << "centrality trigger on estimator "
+              << param->getCentralityEstimator() << " in ["
+              << param->getCentralityEstimatorMin() << ", "
+              << param->getCentralityEstimatorMax() << "): accepted 1 of "
+              << centralityCandidates_ << " candidates ("
+              << centralityRejectedGeometry_ << " rejected by the geometry, "
+              << centralityRejectedQs_ << " by Q_s^2(min) S_T)" << endl;
+      }
       fout1.close();
     }
 
@@ -1597,12 +1963,62 @@ void Init::setColorChargeDensity(Lattice *lat, Parameters *param,
   foutNEst.close();
 }
 
-void Init::setV(Lattice *lat, Group *group, Parameters *param, Random *random) {
-  messager.info("Setting Wilson lines ...");
+// Gaussian color charges rho^a(x) of one longitudinal slice of nucleus A
+// (nucleus=0) or B (nucleus=1). The numbers come from the counter-based
+// generator keyed by the random seed, with counter (site, slice, nucleus and
+// color pair, event), so they do not depend on the number of threads or on
+// the order in which sites and slices are visited. All parameter sets of a
+// sweep share the event (see Parameters::noiseEventId) and so the noise.
+void Init::sampleColorCharges(Lattice *lat, Parameters *param,
+                              complex<double> **rhoCoeff, int slice,
+                              int nucleus) {
   const int N = param->getSize();
   const int Ny = param->getNy();
   const int Nc = param->getNc();
   const int Nc2m1 = Nc * Nc - 1;
+  const unsigned long long key = param->getRandomSeed();
+  const unsigned int eventId =
+      static_cast<unsigned int>(param->getNoiseEventId());
+  const unsigned int stream =
+      (static_cast<unsigned int>(noiseSequence_) << 9) |
+      (static_cast<unsigned int>(nucleus) << 8);
+
+#pragma omp parallel for
+  for (int pos = 0; pos < N * N; pos++) {
+    double g2mu;
+    if (nucleus == 0)
+      g2mu = lat->cells[pos]->getg2mu2A();
+    else
+      g2mu = lat->cells[pos]->getg2mu2B();
+    const double g2muSlice =
+        param->getg() * sqrt(g2mu / static_cast<double>(Ny));
+
+    for (int n = 0; n < Nc2m1; n += 2) {
+      unsigned int ctr[4] = {static_cast<unsigned int>(pos),
+                             static_cast<unsigned int>(slice),
+                             stream | static_cast<unsigned int>(n / 2), eventId};
+      double gauss1, gauss2;
+      Random::CounterGauss(key, ctr, gauss1, gauss2);
+      rhoCoeff[n][pos] = g2muSlice * gauss1;
+      if (n + 1 < Nc2m1)
+        rhoCoeff[n + 1][pos] = g2muSlice * gauss2;
+    }
+  }
+}
+
+// Wilson lines V = prod_k exp(-i A^+_k) of nucleus A (nucleus=0, stored in U)
+// or B (nucleus=1, stored in U2). Groups of slices are processed together:
+// their 2D Fourier transforms run concurrently, and the slice exponentials
+// are combined per site by an ordered tree reduction (later slices multiply
+// from the left), which is then multiplied onto the product so far.
+void Init::computeWilsonLines(Lattice *lat, Group *group, Parameters *param,
+                              int nucleus) {
+  const int N = param->getSize();
+  const int Ny = param->getNy();
+  const int Nc = param->getNc();
+  const int Nc2 = Nc * Nc;
+  const int Nc2m1 = Nc2 - 1;
+  const int nSites = N * N;
   const int nn[2] = {N, N};
   const double L = param->getL();
   const double a = L / N; // lattice spacing in fm
@@ -1610,64 +2026,81 @@ void Init::setV(Lattice *lat, Group *group, Parameters *param, Random *random) {
   const Matrix one(Nc, 1.);
   double UVdamp = param->getUVdamp(); // GeV^-1
   UVdamp = UVdamp / a * hbarc;
-  complex<double> **rhoACoeff;
-  rhoACoeff = new complex<double> *[Nc2m1];
-  for (int i = 0; i < Nc2m1; i++) {
-    rhoACoeff[i] = new complex<double>[N * N];
-  }
 
-  // loop over longitudinal direction
-  for (int k = 0; k < Ny; k++) {
-    double g2muA;
-    for (int pos = 0; pos < N * N; pos++) {
-      for (int n = 0; n < Nc2m1; n++) {
-        g2muA = param->getg() *
-                sqrt(lat->cells[pos]->getg2mu2A() / static_cast<double>(Ny));
-        rhoACoeff[n][pos] = g2muA * random->Gauss();
+  // propagator in the momentum ordering of fftnComplex
+  std::vector<double> propagator(nSites);
+#pragma omp parallel for
+  for (int i = 0; i < N; i++) {
+    for (int j = 0; j < N; j++) {
+      double kt2, kx, ky;
+      kx = 2. * M_PI * (-0.5 + static_cast<double>(i) / static_cast<double>(N));
+      ky = 2. * M_PI * (-0.5 + static_cast<double>(j) / static_cast<double>(N));
+      kt2 = 4. * (sin(kx / 2.) * sin(kx / 2.) +
+                  sin(ky / 2.) * sin(ky / 2.)); // lattice momentum
+      if (m == 0) {
+        propagator[i * N + j] = (kt2 != 0) ? 1. / kt2 : 0.;
+      } else {
+        propagator[i * N + j] =
+            (1. / (kt2 + m * m)) * exp(-sqrt(kt2) * UVdamp);
       }
     }
+  }
+
+  // number of slices done at once: enough to keep all threads busy, but
+  // limited by the memory needed for their rho^a and Wilson lines
+  int nThreads = 1;
+#ifdef _OPENMP
+  nThreads = omp_get_max_threads();
+#endif
+  const double bytesPerSlice =
+      static_cast<double>(nSites) * (Nc2m1 + Nc2) * sizeof(complex<double>);
+  int sliceGroup = std::min(Ny, nThreads);
+  const double sliceMemoryBudget = param->getSliceMemoryGB() * 1.e9; // bytes
+  sliceGroup = std::min(sliceGroup,
+                        static_cast<int>(sliceMemoryBudget / bytesPerSlice));
+  sliceGroup = std::max(sliceGroup, 1);
+
+  std::vector<complex<double>> rhoStore(
+      static_cast<size_t>(sliceGroup) * Nc2m1 * nSites);
+  std::vector<complex<double> *> rhoCoeff(sliceGroup * Nc2m1);
+  for (int t = 0; t < sliceGroup * Nc2m1; t++) {
+    rhoCoeff[t] = &rhoStore[static_cast<size_t>(t) * nSites];
+  }
+  std::vector<complex<double>> sliceV(static_cast<size_t>(sliceGroup) *
+                                      nSites * Nc2);
+  std::vector<char> sliceReset(static_cast<size_t>(sliceGroup) * nSites);
+
+  // loop over longitudinal direction
+  for (int k0 = 0; k0 < Ny; k0 += sliceGroup) {
+    const int nSlices = std::min(sliceGroup, Ny - k0);
 
-    for (int n = 0; n < Nc2m1; n++) {
-      fft.fftnComplex(rhoACoeff[n], rhoACoeff[n], nn, 1);
+    for (int s = 0; s < nSlices; s++) {
+      sampleColorCharges(lat, param, &rhoCoeff[s * Nc2m1], k0 + s, nucleus);
     }
 
-    // compute A^+
-#pragma omp parallel for
-    for (int i = 0; i < N; i++) {
-      for (int j = 0; j < N; j++) {
-        double kt2, kx, ky;
-        int localpos = i * N + j;
-        kx = 2. * M_PI *
-             (-0.5 + static_cast<double>(i) / static_cast<double>(N));
-        ky = 2. * M_PI *
-             (-0.5 + static_cast<double>(j) / static_cast<double>(N));
-        kt2 = 4. * (sin(kx / 2.) * sin(kx / 2.) +
-                    sin(ky / 2.) * sin(ky / 2.)); // lattice momentum
-        if (m == 0) {
-          if (kt2 != 0) {
-            for (int n = 0; n < Nc2m1; n++) {
-              rhoACoeff[n][localpos] = rhoACoeff[n][localpos] * (1. / (kt2));
-            }
-          } else {
-            for (int n = 0; n < Nc2m1; n++) {
-              rhoACoeff[n][localpos] = 0.;
-            }
-          }
-        } else {
-          for (int n = 0; n < Nc2m1; n++) {
-            rhoACoeff[n][localpos] *=
-                (1. / (kt2 + m * m)) * exp(-sqrt(kt2) * UVdamp);
-          }
+    // compute A^+ for all slices and colors of this group
+#pragma omp parallel
+    {
+      fftw_complex *in =
+          (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * nSites);
+      fftw_complex *out =
+          (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * nSites);
+
+#pragma omp for schedule(dynamic)
+      for (int t = 0; t < nSlices * Nc2m1; t++) {
+        complex<double> *field = rhoCoeff[t];
+        fft.fftnComplex(field, field, nn, 1, in, out);
+        for (int pos = 0; pos < nSites; pos++) {
+          field[pos] *= propagator[pos];
         }
+        fft.fftnComplex(field, field, nn, -1, in, out);
       }
-    }
 
-    // Fourier transform back A^+
-    for (int n = 0; n < Nc2m1; n++) {
-      fft.fftnComplex(rhoACoeff[n], rhoACoeff[n], nn, -1);
+      fftw_free(in);
+      fftw_free(out);
     }
-    // compute U
 
+    // exponentiate each slice and multiply them up
 #pragma omp parallel
     {
       double in[8];
@@ -1675,131 +2108,98 @@ void Init::setV(Lattice *lat, Group *group, Parameters *param, Random *random) {
       Matrix temp(Nc, 1.);
       Matrix temp2(Nc, 0.);
       Matrix tempNew(Nc, 0.);
+      Matrix later(Nc, 0.);
+      Matrix earlier(Nc, 0.);
 
 #pragma omp for
-      for (int pos = 0; pos < N * N; pos++) {
-        for (int aa = 0; aa < Nc2m1; aa++) {
-          in[aa] = -(rhoACoeff[aa][pos])
-                        .real(); // expmCoeff will calculate exp(i in[a]t[a]), so
-                                 // just multiply by -1 (not -i)
-        }
-
-        U = temp2.expmCoeff(in, Nc);
-
-        tempNew = U[0] * one + U[1] * group->getT(0) + U[2] * group->getT(1) +
-                  U[3] * group->getT(2) + U[4] * group->getT(3) +
-                  U[5] * group->getT(4) + U[6] * group->getT(5) +
-                  U[7] * group->getT(6) + U[8] * group->getT(7);
-
-        temp = tempNew * lat->cells[pos]->getU();
-
-        if (U[0] == 0.)
-          {
-            temp = one; 
+      for (int pos = 0; pos < nSites; pos++) {
+        for (int s = 0; s < nSlices; s++) {
+          for (int aa = 0; aa < Nc2m1; aa++) {
+            in[aa] = -(rhoCoeff[s * Nc2m1 + aa][pos])
+                          .real(); // expmCoeff will calculate exp(i in[a]t[a]),
+                                   // so just multiply by -1 (not -i)
           }
-        
-        // set U
-        lat->cells[pos]->setU(temp);
-      }
-    }
 
-  } // Ny loop
+          U = temp2.expmCoeff(in, Nc);
 
-  // loop over longitudinal direction
-  for (int k = 0; k < Ny; k++) {
-    double g2muB;
-    for (int pos = 0; pos < N * N; pos++) {
-      for (int n = 0; n < Nc2m1; n++) {
-        g2muB = param->getg() *
-                sqrt(lat->cells[pos]->getg2mu2B() / static_cast<double>(Ny));
-        rhoACoeff[n][pos] = g2muB * random->Gauss();
-      }
-    }
+          tempNew = U[0] * one + U[1] * group->getT(0) +
+                    U[2] * group->getT(1) + U[3] * group->getT(2) +
+                    U[4] * group->getT(3) + U[5] * group->getT(4) +
+                    U[6] * group->getT(5) + U[7] * group->getT(6) +
+                    U[8] * group->getT(7);
 
-    for (int n = 0; n < Nc2m1; n++) {
-      fft.fftnComplex(rhoACoeff[n], rhoACoeff[n], nn, 1);
-    }
+          // a vanishing exponential resets the product to one
+          const size_t idx = static_cast<size_t>(s) * nSites + pos;
+          sliceReset[idx] = (U[0] == 0.);
+          for (int ic = 0; ic < Nc2; ic++) {
+            sliceV[idx * Nc2 + ic] = sliceReset[idx] ? one(ic) : tempNew(ic);
+          }
+        }
 
-    // compute A^+
-#pragma omp parallel for
-    for (int i = 0; i < N; i++) {
-      for (int j = 0; j < N; j++) {
-        double kt2, kx, ky;
-        int localpos = i * N + j;
-        kx = 2. * M_PI *
-             (-0.5 + static_cast<double>(i) / static_cast<double>(N));
-        ky = 2. * M_PI *
-             (-0.5 + static_cast<double>(j) / static_cast<double>(N));
-        kt2 = 4. * (sin(kx / 2.) * sin(kx / 2.) +
-                    sin(ky / 2.) * sin(ky / 2.)); // lattice momentum
-        if (m == 0) {
-          if (kt2 != 0) {
-            for (int n = 0; n < Nc2m1; n++) {
-              rhoACoeff[n][localpos] = rhoACoeff[n][localpos] * (1. / (kt2));
-            }
-          } else {
-            for (int n = 0; n < Nc2m1; n++) {
-              rhoACoeff[n][localpos] = 0.;
+        // ordered tree reduction: (later, earlier) -> later * earlier, unless
+        // the later one was reset, in which case it is kept as is
+        for (int stride = 1; stride < nSlices; stride *= 2) {
+          for (int s = 0; s + stride < nSlices; s += 2 * stride) {
+            const size_t iE = static_cast<size_t>(s) * nSites + pos;
+            const size_t iL = static_cast<size_t>(s + stride) * nSites + pos;
+            if (sliceReset[iL]) {
+              for (int ic = 0; ic < Nc2; ic++)
+                sliceV[iE * Nc2 + ic] = sliceV[iL * Nc2 + ic];
+              sliceReset[iE] = 1;
+            } else {
+              for (int ic = 0; ic < Nc2; ic++) {
+                later.set(ic, sliceV[iL * Nc2 + ic]);
+                earlier.set(ic, sliceV[iE * Nc2 + ic]);
+              }
+              temp = later * earlier;
+              for (int ic = 0; ic < Nc2; ic++)
+                sliceV[iE * Nc2 + ic] = temp(ic);
             }
           }
-        } else {
-          for (int n = 0; n < Nc2m1; n++) {
-            rhoACoeff[n][localpos] *=
-                (1. / (kt2 + m * m)) * exp(-sqrt(kt2) * UVdamp);
-          }
         }
-      }
-    }
 
-    // Fourier transform back A^+
-    for (int n = 0; n < Nc2m1; n++) {
-      fft.fftnComplex(rhoACoeff[n], rhoACoeff[n], nn, -1);
-    }
-    // compute U
+        for (int ic = 0; ic < Nc2; ic++)
+          tempNew.set(ic, sliceV[static_cast<size_t>(pos) * Nc2 + ic]);
 
-    //#pragma omp parallel
-    {
-      double in[8];
-      vector<complex<double>> U;
-      Matrix temp(Nc, 1.);
-      Matrix temp2(Nc, 0.);
-      Matrix tempNew(Nc, 0.);
-
-#pragma omp for
-      for (int pos = 0; pos < N * N; pos++) {
-
-        for (int aa = 0; aa < Nc2m1; aa++) {
-          in[aa] = -(rhoACoeff[aa][pos])
-                        .real(); // expmCoeff will calculate exp(i in[a]t[a]), so
-                                 // just multiply by -1 (not -i)
+        if (sliceReset[pos]) {
+          temp = tempNew;
+        } else if (nucleus == 0) {
+          temp = tempNew * lat->cells[pos]->getU();
+        } else {
+          temp = tempNew * lat->cells[pos]->getU2();
         }
 
-        U = temp2.expmCoeff(in, Nc);
-
-        tempNew = U[0] * one + U[1] * group->getT(0) + U[2] * group->getT(1) +
-                  U[3] * group->getT(2) + U[4] * group->getT(3) +
-                  U[5] * group->getT(4) + U[6] * group->getT(5) +
-                  U[7] * group->getT(6) + U[8] * group->getT(7);
-
-        temp = tempNew * lat->cells[pos]->getU2();
-
-        if (U[0] == 0.)
-          {
-            temp = one; 
-          }
-        
         // set U
-        lat->cells[pos]->setU2(temp);
+        if (nucleus == 0)
+          lat->cells[pos]->setU(temp);
+        else
+          lat->cells[pos]->setU2(temp);
       }
     }
-
   } // Ny loop
+}
 
-  // --------
-  for (int ic = 0; ic < Nc2m1; ic++) {
-    delete[] rhoACoeff[ic];
+void Init::setV(Lattice *lat, Group *group, Parameters *param, Random *random) {
+  messager.info("Setting Wilson lines ...");
+  const int N = param->getSize();
+  const int Nc = param->getNc();
+  const double L = param->getL();
+  const double a = L / N; // lattice spacing in fm
+
+  // V_A and V_B as path ordered products over the Ny longitudinal slices;
+  // with a Wilson line pool only the lighter nucleus is computed
+  for (int nucleus = 0; nucleus < 2; nucleus++) {
+    if (param->getWilsonLinePool() == 2 && nucleus == pooledNucleus_)
+      readVFromPool(lat, param);
+    else
+      computeWilsonLines(lat, group, param, nucleus);
   }
-  delete[] rhoACoeff;
+
+  // a further call of setV for this event draws independent color charges
+  noiseSequence_++;
+
+  if (param->getWilsonLinePool() == 1)
+    writeVToPool(lat, param);
   
 
   // // output U
@@ -2259,6 +2659,143 @@ void Init::readV(Lattice *lat, Parameters *param, int format) {
   messager.flush("info");
 }
 
+// Replaces the sampled heavier nucleus by the nucleons of a random entry of
+// the Wilson line pool, so that the collision geometry and the lighter
+// nucleus see the nucleus whose V is taken from the pool in setV.
+void Init::takeNucleusFromPool(Parameters *param, Random *random) {
+  if (wilsonLinePool_ == NULL) {
+    wilsonLinePool_ = WilsonLinePool::get(param->getWilsonLinePoolFile());
+    if (wilsonLinePool_ == NULL || wilsonLinePool_->size() == 0) {
+      cerr << "[Init::takeNucleusFromPool]: ERROR: Wilson line pool "
+           << param->getWilsonLinePoolFile()
+           << " not found or empty. Exiting." << endl;
+      exit(1);
+    }
+  }
+
+  poolEntry_ = static_cast<int>(random->genrand64_int63() %
+                                wilsonLinePool_->size());
+  const WilsonLinePoolHeader *header = wilsonLinePool_->header(poolEntry_);
+  std::vector<ReturnValue> &nucleus =
+      (pooledNucleus_ == 0) ? nucleusA_ : nucleusB_;
+
+  if (header->N != param->getSize() || header->Nc != param->getNc() ||
+      std::abs(header->L - param->getL()) > 1e-10 ||
+      header->A != static_cast<int>(nucleus.size())) {
+    cerr << "[Init::takeNucleusFromPool]: ERROR: entry " << poolEntry_
+         << " of " << param->getWilsonLinePoolFile() << " has N=" << header->N
+         << ", Nc=" << header->Nc << ", L=" << header->L
+         << ", A=" << header->A << ", this run needs N=" << param->getSize()
+         << ", Nc=" << param->getNc() << ", L=" << param->getL()
+         << ", A=" << nucleus.size() << ". Exiting." << endl;
+    exit(1);
+  }
+
+  const double *nucleons = wilsonLinePool_->nucleons(poolEntry_);
+  for (int i = 0; i < header->A; i++) {
+    nucleus[i].x = nucleons[4 * i];
+    nucleus[i].y = nucleons[4 * i + 1];
+    nucleus[i].z = nucleons[4 * i + 2];
+    nucleus[i].phi = 0.;
+    nucleus[i].collided = 0;
+    nucleus[i].proton = (nucleons[4 * i + 3] > 0.5);
+  }
+
+  messager << "Nucleus " << (pooledNucleus_ == 0 ? "A" : "B")
+           << " taken from entry " << poolEntry_ << " of the Wilson line pool "
+           << param->getWilsonLinePoolFile();
+  messager.flush("info");
+}
+
+// Sets V of the pooled nucleus from its pool entry. As in readV the stored
+// Wilson lines are moved to this event's impact parameter by a shift of
+// whole lattice cells in x; cells moved in from outside the stored lattice
+// get V = 1.
+void Init::readVFromPool(Lattice *lat, Parameters *param) {
+  const int N = param->getSize();
+  const int Nc = param->getNc();
+  const int Nc2 = Nc * Nc;
+  const double a = param->getL() / N;
+  const WilsonLinePoolHeader *header = wilsonLinePool_->header(poolEntry_);
+  const double *links = wilsonLinePool_->links(poolEntry_);
+
+  const int shiftCells = static_cast<int>(
+      lround((nucleusShift_[pooledNucleus_] - header->shift) / a));
+  const Matrix one(Nc, 1.);
+
+#pragma omp parallel for
+  for (int ix = 0; ix < N; ix++) {
+    Matrix temp(Nc, 1.);
+    const int ixSource = ix - shiftCells;
+    for (int iy = 0; iy < N; iy++) {
+      const int pos = ix * N + iy;
+      if (ixSource < 0 || ixSource >= N) {
+        temp = one;
+      } else {
+        const double *v =
+            links + 2 * static_cast<size_t>(ixSource * N + iy) * Nc2;
+        for (int k = 0; k < Nc2; k++)
+          temp.set(k, complex<double>(v[2 * k], v[2 * k + 1]));
+      }
+      if (pooledNucleus_ == 0)
+        lat->cells[pos]->setU(temp);
+      else
+        lat->cells[pos]->setU2(temp);
+    }
+  }
+
+  messager << " V_" << (pooledNucleus_ == 0 ? "A" : "B")
+           << " read from the Wilson line pool, shifted by " << shiftCells
+           << " cells.";
+  messager.flush("info");
+}
+
+// Appends V of the heavier nucleus and its nucleons (without the impact
+// parameter shift) to this rank's part of the Wilson line pool.
+void Init::writeVToPool(Lattice *lat, Parameters *param) {
+  const int N = param->getSize();
+  const int Nc = param->getNc();
+  const int Nc2 = Nc * Nc;
+  const std::vector<ReturnValue> &nucleus =
+      (pooledNucleus_ == 0) ? nucleusA_ : nucleusB_;
+
+  WilsonLinePoolHeader header = WilsonLinePoolHeader();
+  header.N = N;
+  header.Nc = Nc;
+  header.L = param->getL();
+  header.shift = nucleusShift_[pooledNucleus_];
+  header.A = static_cast<int>(nucleus.size());
+  header.nucleus = pooledNucleus_;
+
+  std::vector<double> nucleons(4 * nucleus.size());
+  for (size_t i = 0; i < nucleus.size(); i++) {
+    nucleons[4 * i] = nucleus[i].x - header.shift;
+    nucleons[4 * i + 1] = nucleus[i].y;
+    nucleons[4 * i + 2] = nucleus[i].z;
+    nucleons[4 * i + 3] = nucleus[i].proton ? 1. : 0.;
+  }
+
+  std::vector<double> links(2 * static_cast<size_t>(N) * N * Nc2);
+#pragma omp parallel for
+  for (int pos = 0; pos < N * N; pos++) {
+    const Matrix &V = (pooledNucleus_ == 0) ? lat->cells[pos]->getU()
+                                            : lat->cells[pos]->getU2();
+    double *v = &links[2 * static_cast<size_t>(pos) * Nc2];
+    for (int k = 0; k < Nc2; k++) {
+      v[2 * k] = V(k).real();
+      v[2 * k + 1] = V(k).imag();
+    }
+  }
+
+  stringstream poolName;
+  poolName << param->getWilsonLinePoolFile() << "." << param->getMPIRank();
+  WilsonLinePool::append(poolName.str(), header, nucleons, links);
+
+  messager << " V_" << (pooledNucleus_ == 0 ? "A" : "B") << " appended to "
+           << poolName.str();
+  messager.flush("info");
+}
+
 void Init::init(Lattice *lat, Group *group, Parameters *param, Random *random,
                 Glauber *glauber, int READFROMFILE) {
   const int maxIterations = 100000;
@@ -2272,6 +2809,7 @@ void Init::init(Lattice *lat, Group *group, Parameters *param, Random *random,
 
   messager.info("Initializing fields ... ");
   param->setRnp(0.);
+  param->setNcoll(0);
 
   double b;
   double xb =
@@ -2307,12 +2845,10 @@ void Init::init(Lattice *lat, Group *group, Parameters *param, Random *random,
     readNuclearQs(param);
   }
 
-  readInNucleusConfigs(static_cast<int>(glauber->nucleusA1()),
-                       param->getlightNucleusOption(),
-                       nucleonPosArrA_);
-  readInNucleusConfigs(static_cast<int>(glauber->nucleusA2()),
-                       param->getlightNucleusOption(),
-                       nucleonPosArrB_);
+  nucleusConfigsA_ = readInNucleusConfigs(
+      static_cast<int>(glauber->nucleusA1()), param->getlightNucleusOption());
+  nucleusConfigsB_ = readInNucleusConfigs(
+      static_cast<int>(glauber->nucleusA2()), param->getlightNucleusOption());
 
   // sample nucleon positions
   nucleusA_.clear();
@@ -2328,50 +2864,58 @@ void Init::init(Lattice *lat, Group *group, Parameters *param, Random *random,
     if (param->getUseNucleus() == 1) {
       sampleTA(param, random, glauber); // populate the lists nucleusA_ and
                                         // nucleusB_ with position data of the
-    }
 
-    // set color charge densities
-    setColorChargeDensity(lat, param, random, glauber);
-
-    // for enforcing a specific Npart:
-    if (param->getUseNucleus() == 1 && param->getUseFixedNpart() != 0) {
-      if (param->getNpart() != param->getUseFixedNpart()) {
-        while (param->getNpart() != param->getUseFixedNpart()) {
+      // geometry-only stage: resample b and the nucleon positions until there
+      // is a collision (with the desired Npart, or in the centrality window)
+      // before any lattice work
+      checkCentralityWindow(param, glauber);
+      int geometryAttempts = 1;
+      while (!acceptGeometry(param, random, glauber)) {
+        if (geometryAttempts++ >= maxGeometryAttempts) {
+          cerr << "[Init::init]: ERROR: no accepted geometry in "
+               << maxGeometryAttempts
+               << " attempts; check useFixedNpart, the centrality window "
+                  "and the impact parameter range. Exiting."
+               << endl;
+          exit(1);
+        }
+        if (param->getUseFixedNpart() != 0)
           cout << "resampling... desired Npart=" << param->getUseFixedNpart()
                << endl;
-          nucleusA_.clear();
-          nucleusB_.clear();
-
-          xb = random
-                   ->genrand64_real1(); // uniformly distributed random variable
+        else
+          cout << "Geometry rejected on rank " << param->getMPIRank()
+               << ". Resampling the geometry..." << endl;
+        nucleusA_.clear();
+        nucleusB_.clear();
 
-          if (param->getLinearb() == 1) // use a linear probability distribution
-                                        // for b if we are doing nuclei
-          {
-            cout << "Sampling linearly distributed b between " << bmin
-                 << " and " << bmax << "fm." << endl;
-            b = sqrt((bmax * bmax - bmin * bmin) * xb + bmin * bmin);
-          } else // use a uniform distribution instead
-          {
-            cout << "Sampling uniformly distributed b between " << bmin
-                 << " and " << bmax << "fm." << endl;
-            b = (bmax - bmin) * xb + bmin;
-          }
+        xb =
+            random->genrand64_real1(); // uniformly distributed random variable
 
-          param->setb(b);
-          cout << "Using b=" << b << " fm" << endl;
+        if (param->getLinearb() == 1) // use a linear probability distribution
+                                      // for b if we are doing nuclei
+        {
+          b = sqrt((bmax * bmax - bmin * bmin) * xb + bmin * bmin);
+        } else // use a uniform distribution instead
+        {
+          b = (bmax - bmin) * xb + bmin;
+        }
 
-          // populate the lists nucleusA_ and nucleusB_ with position data
-          sampleTA(param, random, glauber);
+        param->setb(b);
+        cout << "Using b=" << b << " fm" << endl;
 
-          setColorChargeDensity(lat, param, random, glauber);
-        }
+        // populate the lists nucleusA_ and nucleusB_ with position data
+        sampleTA(param, random, glauber);
       }
-      cout << "Using fixed Npart=" << param->getNpart() << endl;
+
+      if (param->getUseFixedNpart() != 0)
+        cout << "Using fixed Npart=" << param->getNpart() << endl;
     }
 
+    // set color charge densities
+    setColorChargeDensity(lat, param, random, glauber);
+
     if (param->getSuccess() == 0) {
-      cout << "No collision happened on rank " << param->getMPIRank()
+      cout << "Event rejected on rank " << param->getMPIRank()
            << ". Restarting with new random number..." << endl;
       return;
     }
@@ -3234,51 +3778,65 @@ void Init::generate_nucleus_configuration_with_deformed_woods_saxon_force_dmin(
   double r = 0.;
   double costheta = 0.;
   double phi = 0.;
-  double R_WS_theta = 0.;
   const double d_min_sq = d_min * d_min;
+  const DeformedWoodsSaxonEnvelope &protonEnvelope =
+      get_deformed_woods_saxon_envelope(a_WS, R_WS, beta2, beta3, beta4,
+                                        gamma, rmaxCut);
+  const DeformedWoodsSaxonEnvelope &neutronEnvelope =
+      get_deformed_woods_saxon_envelope(a_WS + da_np, R_WS + dR_np, beta2,
+                                        beta3, beta4, gamma, rmaxCut);
+
+  // cubic cells of size >= d_min covering |x|,|y|,|z| < rmaxCut: nucleons
+  // closer than d_min are in the same or in neighbouring cells
+  const double cellSize = std::max(d_min, rmaxCut / 32.);
+  const int nCell = static_cast<int>(2. * rmaxCut / cellSize) + 1;
+  std::vector<int> cellHead(nCell * nCell * nCell, -1);
+  std::vector<int> cellNext(A, -1);
+
   std::vector<double> x_array(A, 0.), y_array(A, 0.), z_array(A, 0.);
   for (int i = 0; i < A; i++) {
-    double R_WS_i = R_WS;
-    double a_WS_i = a_WS;
-    if (i >= Z) {
-        R_WS_i = R_WS + dR_np;
-        a_WS_i = a_WS + da_np;
-    }
+    const DeformedWoodsSaxonEnvelope &envelope =
+        (i < Z) ? protonEnvelope : neutronEnvelope;
     bool reSampleFlag = false;
     double x_i, y_i, z_i;
+    int cx, cy, cz;
     do {
       // sample the position of the nucleon i
-      do {
-        r = rmaxCut*pow(random->genrand64_real3(), 1.0/3.0);
-        costheta = 1.0 - 2.0 * random->genrand64_real3();
-        phi  = 2.*M_PI*random->genrand64_real3();
-        double y20 = spherical_harmonics(2, costheta);
-        double y30 = spherical_harmonics(3, costheta);
-        double y40 = spherical_harmonics(4, costheta);
-        double y22 = spherical_harmonics_Y22(costheta, phi);
-        R_WS_theta = R_WS_i*(1.0
-                             + beta2*(cos(gamma)*y20 + sin(gamma)*y22)
-                             + beta3*y30 + beta4*y40);
-      } while (random->genrand64_real3()
-               > fermi_distribution(r, R_WS_theta, a_WS_i));
+      sample_from_deformed_woods_saxon(random, envelope, r, costheta, phi);
       double sintheta = sqrt(1. - costheta*costheta);
       x_i = r*sintheta*cos(phi);
       y_i = r*sintheta*sin(phi);
       z_i = r*costheta;
+      cx = std::min(static_cast<int>((x_i + rmaxCut) / cellSize), nCell - 1);
+      cy = std::min(static_cast<int>((y_i + rmaxCut) / cellSize), nCell - 1);
+      cz = std::min(static_cast<int>((z_i + rmaxCut) / cellSize), nCell - 1);
       reSampleFlag = false;
-      for (int j = i - 1; j >= 0; j--) {
-        double r2 = (  (x_i - x_array[j])*(x_i - x_array[j])
-                     + (y_i - y_array[j])*(y_i - y_array[j])
-                     + (z_i - z_array[j])*(z_i - z_array[j]));
-        if (r2 < d_min_sq) {
-          reSampleFlag = true;
-          break;
+      for (int ix = std::max(cx - 1, 0);
+           ix <= std::min(cx + 1, nCell - 1) && !reSampleFlag; ix++) {
+        for (int iy = std::max(cy - 1, 0);
+             iy <= std::min(cy + 1, nCell - 1) && !reSampleFlag; iy++) {
+          for (int iz = std::max(cz - 1, 0);
+               iz <= std::min(cz + 1, nCell - 1) && !reSampleFlag; iz++) {
+            for (int j = cellHead[(ix * nCell + iy) * nCell + iz]; j >= 0;
+                 j = cellNext[j]) {
+              double r2 = (  (x_i - x_array[j])*(x_i - x_array[j])
+                           + (y_i - y_array[j])*(y_i - y_array[j])
+                           + (z_i - z_array[j])*(z_i - z_array[j]));
+              if (r2 < d_min_sq) {
+                reSampleFlag = true;
+                break;
+              }
+            }
+          }
         }
       }
     } while (reSampleFlag);
     x_array[i] = x_i;
     y_array[i] = y_i;
     z_array[i] = z_i;
+    const int cell = (cx * nCell + cy) * nCell + cz;
+    cellNext[i] = cellHead[cell];
+    cellHead[cell] = i;
   }
 
   recenter_nucleus(x_array, y_array, z_array);
@@ -3308,7 +3866,6 @@ void Init::generate_nucleus_configuration_with_deformed_woods_saxon2(
   double r = 0.;
   double costheta = 0.;
   double phi = 0.;
-  double R_WS_theta = 0.;
   std::vector<double> x_array(A, 0.), y_array(A, 0.), z_array(A, 0.);
   for (int i = 0; i < A; i++) {
     double R_WS_i = R_WS;
@@ -3318,19 +3875,11 @@ void Init::generate_nucleus_configuration_with_deformed_woods_saxon2(
       R_WS_i = R_WS + dR_np;
       a_WS_i = a_WS + da_np;
     }
-    do {
-        r = rmaxCut*pow(random->genrand64_real3(), 1.0/3.0);
-        costheta = 1.0 - 2.0 * random->genrand64_real3();
-        phi  = 2.*M_PI*random->genrand64_real3();
-        double y20 = spherical_harmonics(2, costheta);
-        double y30 = spherical_harmonics(3, costheta);
-        double y40 = spherical_harmonics(4, costheta);
-        double y22 = spherical_harmonics_Y22(costheta, phi);
-        R_WS_theta = R_WS_i*(1.0
-                             + beta2*(cos(gamma)*y20 + sin(gamma)*y22)
-                             + beta3*y30 + beta4*y40);
-    } while (random->genrand64_real3()
-             > fermi_distribution(r, R_WS_theta, a_WS_i));
+    sample_from_deformed_woods_saxon(
+        random,
+        get_deformed_woods_saxon_envelope(a_WS_i, R_WS_i, beta2, beta3, beta4,
+                                          gamma, rmaxCut),
+        r, costheta, phi);
     double sintheta = sqrt(1. - costheta*costheta);
     x_array[i] = r*sintheta*cos(phi);
     y_array[i] = r*sintheta*sin(phi);
@@ -3360,15 +3909,141 @@ void Init::sample_r_and_costheta_from_deformed_woods_saxon(
     Random *random, double a_WS, double R_WS, double beta2, double beta3,
     double beta4, double &r, double &costheta) const {
   double rmaxCut = R_WS + 10. * a_WS;
-  double R_WS_theta = R_WS;
-  do {
-    r = rmaxCut * pow(random->genrand64_real3(), 1.0 / 3.0);
-    costheta = 1.0 - 2.0 * random->genrand64_real3();
-    auto y20 = spherical_harmonics(2, costheta);
-    auto y30 = spherical_harmonics(3, costheta);
-    auto y40 = spherical_harmonics(4, costheta);
-    R_WS_theta = R_WS * (1.0 + beta2 * y20 + beta3 * y30 + beta4 * y40);
-  } while (random->genrand64_real3() > fermi_distribution(r, R_WS_theta, a_WS));
+  double phi;
+  sample_from_deformed_woods_saxon(
+      random,
+      get_deformed_woods_saxon_envelope(a_WS, R_WS, beta2, beta3, beta4, 0.,
+                                        rmaxCut),
+      r, costheta, phi);
+}
+
+double Init::deformed_radius(double R_WS, double beta2, double beta3,
+                             double beta4, double gamma, double costheta,
+                             double phi) const {
+  double y20 = spherical_harmonics(2, costheta);
+  double y30 = spherical_harmonics(3, costheta);
+  double y40 = spherical_harmonics(4, costheta);
+  double y22 = 0.;
+  if (gamma != 0.)
+    y22 = spherical_harmonics_Y22(costheta, phi);
+  return R_WS * (1.0 + beta2 * (cos(gamma) * y20 + sin(gamma) * y22) +
+                 beta3 * y30 + beta4 * y40);
+}
+
+// The envelopes only depend on the Woods-Saxon parameters, so they are built
+// once per parameter set and kept for later nuclei and events. The cache is
+// shared by all Init objects and threads, so it is locked.
+const DeformedWoodsSaxonEnvelope &Init::get_deformed_woods_saxon_envelope(
+    double a_WS, double R_WS, double beta2, double beta3, double beta4,
+    double gamma, double rmaxCut) const {
+  static std::mutex mutex;
+  static std::deque<DeformedWoodsSaxonEnvelope> envelopes;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  for (unsigned int i = 0; i < envelopes.size(); i++) {
+    const DeformedWoodsSaxonEnvelope &e = envelopes[i];
+    if (e.a_WS == a_WS && e.R_WS == R_WS && e.beta2 == beta2 &&
+        e.beta3 == beta3 && e.beta4 == beta4 && e.gamma == gamma &&
+        e.rmaxCut == rmaxCut)
+      return e;
+  }
+
+  DeformedWoodsSaxonEnvelope e;
+  e.a_WS = a_WS;
+  e.R_WS = R_WS;
+  e.beta2 = beta2;
+  e.beta3 = beta3;
+  e.beta4 = beta4;
+  e.gamma = gamma;
+  e.rmaxCut = rmaxCut;
+  e.nCosTheta = 64;
+  e.nPhi = (gamma != 0.) ? 32 : 1; // without gamma R does not depend on phi
+  e.nR = 256;
+  const double dct = 2. / e.nCosTheta;
+  const double dphi = 2. * M_PI / e.nPhi;
+  const double dr = rmaxCut / e.nR;
+  const int nSub = 5;
+
+  e.height.resize(e.nCosTheta * e.nPhi * e.nR);
+  e.cumulative.resize(e.height.size());
+  double sum = 0.;
+  for (int ib = 0; ib < e.nCosTheta; ib++) {
+    for (int ip = 0; ip < e.nPhi; ip++) {
+      // largest deformed radius in the bin: maximum on a sub-grid, plus the
+      // largest change between neighbouring sub-grid points as a margin
+      double Rmax = -1e30, margin = 0.;
+      for (int is = 0; is < nSub; is++) {
+        for (int js = 0; js < nSub; js++) {
+          double ct = -1. + (ib + is / (nSub - 1.)) * dct;
+          double ph = (ip + js / (nSub - 1.)) * dphi;
+          double R = deformed_radius(R_WS, beta2, beta3, beta4, gamma, ct, ph);
+          Rmax = std::max(Rmax, R);
+          if (is > 0) {
+            double Rlow = deformed_radius(R_WS, beta2, beta3, beta4, gamma,
+                                          ct - dct / (nSub - 1.), ph);
+            margin = std::max(margin, std::abs(R - Rlow));
+          }
+          if (js > 0) {
+            double Rlow = deformed_radius(R_WS, beta2, beta3, beta4, gamma, ct,
+                                          ph - dphi / (nSub - 1.));
+            margin = std::max(margin, std::abs(R - Rlow));
+          }
+        }
+      }
+      Rmax += margin;
+
+      for (int k = 0; k < e.nR; k++) {
+        const int idx = (ib * e.nPhi + ip) * e.nR + k;
+        // r^2 grows and f_WS falls with r: bound both at the interval ends
+        e.height[idx] = (k + 1) * dr * (k + 1) * dr *
+                        fermi_distribution(k * dr, Rmax, a_WS);
+        sum += e.height[idx];
+        e.cumulative[idx] = sum;
+      }
+    }
+  }
+
+  envelopes.push_back(e);
+  return envelopes.back();
+}
+
+// Rejection sampling of (r, cos(theta), phi) from r^2 f_WS(r; R(theta,phi), a)
+// with the piecewise constant envelope: pick a (bin, r interval) according to
+// its envelope weight, a uniform point inside it, and accept with
+// density/envelope. The acceptance rate is close to one. Where the density
+// exceeds the estimated envelope it is accepted with probability one, so the
+// sampled distribution is slightly too low there.
+void Init::sample_from_deformed_woods_saxon(
+    Random *random, const DeformedWoodsSaxonEnvelope &envelope, double &r,
+    double &costheta, double &phi) const {
+  const double dct = 2. / envelope.nCosTheta;
+  const double dphi = 2. * M_PI / envelope.nPhi;
+  const double dr = envelope.rmaxCut / envelope.nR;
+  const double total = envelope.cumulative.back();
+  const int nCells = static_cast<int>(envelope.cumulative.size());
+
+  while (true) {
+    int idx = static_cast<int>(
+        std::upper_bound(envelope.cumulative.begin(),
+                         envelope.cumulative.end(),
+                         total * random->genrand64_real3()) -
+        envelope.cumulative.begin());
+    idx = std::min(idx, nCells - 1);
+    const int k = idx % envelope.nR;
+    const int bin = idx / envelope.nR;
+    const int ib = bin / envelope.nPhi;
+    const int ip = bin % envelope.nPhi;
+
+    costheta = -1. + (ib + random->genrand64_real3()) * dct;
+    phi = (ip + random->genrand64_real3()) * dphi;
+    r = (k + random->genrand64_real3()) * dr;
+    double R_WS_theta =
+        deformed_radius(envelope.R_WS, envelope.beta2, envelope.beta3,
+                        envelope.beta4, envelope.gamma, costheta, phi);
+    if (random->genrand64_real3() * envelope.height[idx] <=
+        r * r * fermi_distribution(r, R_WS_theta, envelope.a_WS))
+      return;
+  }
 }
 
 double Init::spherical_harmonics(int l, double ct) const {
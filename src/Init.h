@@ -6,6 +6,7 @@
 
 #include <complex>
 #include <ctime>
+#include <deque>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
@@ -20,11 +21,36 @@
 #include "Group.h"
 #include "Lattice.h"
 #include "Matrix.h"
+#include "NucleusConfigurations.h"
 #include "Parameters.h"
 #include "Random.h"
+#include "WilsonLinePool.h"
 #include "gsl/gsl_linalg.h"
 #include "pretty_ostream.h"
 
+// Piecewise constant envelope of r^2 f_WS(r; R(theta,phi), a) for sampling
+// nucleons from a deformed Woods-Saxon distribution: for every angular bin
+// (cos(theta), phi) and radial interval it holds an estimated upper bound of
+// the density, using the largest deformed radius found in the bin plus a
+// margin. The bound is not proven; see sample_from_deformed_woods_saxon.
+struct DeformedWoodsSaxonEnvelope {
+  double a_WS, R_WS, beta2, beta3, beta4, gamma, rmaxCut;
+  int nCosTheta, nPhi, nR;
+  std::vector<double> height;     // envelope in each (bin, r interval)
+  std::vector<double> cumulative; // running sum of height
+};
+
+// Header of the binary cache of the Q_s^2(T,y) table. It is followed by
+// Tlist[nT] and Q_s^2[nT][ny] on the grid uniform in log(T) used by
+// getNuclearQs2. The size and checksum of the text table tell whether the
+// cache is stale.
+struct NuclearQsCacheHeader {
+  char magic[8];
+  int nT, ny;
+  double logTmin, deltaLogT, deltaY; // grid spacings
+  unsigned long long sourceBytes, sourceChecksum;
+};
+
 class Init {
 
 private:
@@ -32,29 +58,77 @@ private:
 
   int const static iTpmax = 200; // updated in March 2019 to a larger T_A range
 
-  double const deltaYNuc = 0.25; // for the new table
+  // geometry samples (b and nucleon positions) per event before giving up on
+  // finding a collision with the requested Npart or in the centrality window
+  int const static maxGeometryAttempts = 1000000;
+
+  static constexpr double deltaYNuc = 0.25; // for the new table
 
   FFT fft;
   //  Matrix** A;
   //  Glauber *glauber;
+  // Q_s^2(T,y) resampled onto a grid uniform in log(T), so that
+  // getNuclearQs2 can find its cell in O(1)
   double Qs2Nuclear[iTpmax][iymaxNuc];
   double Tlist[iTpmax];
+  double logTmin_;
+  double invDeltaLogT_;
+  static const char *sharedNuclearQs_; // cache image of the Q_s^2 table, if
+                                       // shared on the node
+
+  // converged Q_s(T) of the fluctuating-x iteration for nucleus A (+yIn) and
+  // B (-yIn), tabulated once per event on a grid uniform in log(T)
+  int const static iTFluctx = 4 * iTpmax;
+  std::vector<double> QsFluctuatingxA_;
+  std::vector<double> QsFluctuatingxB_;
 
   double As[1];
 
-  std::vector< vector<float> > nucleonPosArrA_;
-  std::vector< vector<float> > nucleonPosArrB_;
+  // nucleon configurations read from file (shared, not owned)
+  const NucleusConfigurations *nucleusConfigsA_;
+  const NucleusConfigurations *nucleusConfigsB_;
 
   // list of x and y coordinates of nucleons in nucleus A
   std::vector<ReturnValue> nucleusA_;
   // list of x and y coordinates of nucleons in nucleus B
   std::vector<ReturnValue> nucleusB_;
 
+  // number of color charge samplings done so far in this event, part of the
+  // counter of the counter-based random numbers used in setV
+  int noiseSequence_;
+
+  // bookkeeping of the centrality trigger for this event: events with a
+  // collision that reached the trigger, and those rejected by the estimator
+  int centralityCandidates_;
+  int centralityRejectedGeometry_;
+  int centralityRejectedQs_;
+
+  // calls of setColorChargeDensity in this event, labels the random streams
+  // of the sub-nucleon structure in a parameter sweep
+  int densityAttempt_;
+
+  // x shift of nucleus A and B by the impact parameter, in fm
+  double nucleusShift_[2];
+
+  // Wilson line pool of the heavier nucleus (shared, not owned), the entry
+  // used in this event and which nucleus (0: A, 1: B) comes from the pool
+  const WilsonLinePool *wilsonLinePool_;
+  int poolEntry_;
+  int pooledNucleus_;
+
   pretty_ostream messager;
 
 public:
   // Constructor.
-  Init(const int nn[]) : fft(nn){};
+  Init(const int nn[])
+      : fft(nn), nucleusConfigsA_(NULL), nucleusConfigsB_(NULL),
+        noiseSequence_(0), centralityCandidates_(0),
+        centralityRejectedGeometry_(0), centralityRejectedQs_(0),
+        densityAttempt_(0), wilsonLinePool_(NULL), poolEntry_(-1),
+        pooledNucleus_(1) {
+    nucleusShift_[0] = 0.;
+    nucleusShift_[1] = 0.;
+  };
 
   ~Init(){};
 
@@ -62,20 +136,50 @@ public:
             Glauber *glauber, int READFROMFILE);
   void sampleTA(Parameters *param, Random *random, Glauber *glauber);
   void readNuclearQs(Parameters *param);
+  static void shareNuclearQsTable(Parameters *param);
+  static std::vector<char> loadNuclearQsTable(const std::string &fileName,
+                                              int rank);
+  static bool readNuclearQsCache(const std::string &cacheName,
+                                 const NuclearQsCacheHeader &expected,
+                                 std::vector<char> &table);
+  static void writeNuclearQsCache(const std::string &cacheName, int rank,
+                                  const std::vector<char> &table);
+  static void resampleNuclearQs(const double *Tsource,
+                                const double *Qs2Source,
+                                std::vector<char> &table);
+  static void parseNuclearQsTable(const std::string &fileName,
+                                  std::vector<double> &Tsource,
+                                  std::vector<double> &Qs2Source);
   std::vector<complex<double>> solveAxb(Parameters *param, complex<double> *A,
                                         complex<double> *b);
   double getNuclearQs2(double Qs2atZeroY, double y);
+  double solveFluctuatingxQs(Parameters *param, double T, double rapidity,
+                             double yShift, bool tabulating);
+  void tabulateFluctuatingxQs(Parameters *param, double rapidity, double yIn);
+  double getFluctuatingxQs(Parameters *param,
+                           const std::vector<double> &QsTable, double T,
+                           double rapidity, double yShift);
+  bool findCollisions(Parameters *param, Random *random, Glauber *glauber);
+  bool acceptGeometry(Parameters *param, Random *random, Glauber *glauber);
+  void checkCentralityWindow(Parameters *param, Glauber *glauber);
+  bool inCentralityWindow(Parameters *param, double estimator);
   void setColorChargeDensity(Lattice *lat, Parameters *param, Random *random,
                              Glauber *glauber);
+  void sampleColorCharges(Lattice *lat, Parameters *param,
+                          complex<double> **rhoCoeff, int slice, int nucleus);
+  void computeWilsonLines(Lattice *lat, Group *group, Parameters *param,
+                          int nucleus);
   void setV(Lattice *lat, Group *group, Parameters *param, Random *random);
   void readV(Lattice *lat, Parameters *param, int format);
+  void takeNucleusFromPool(Parameters *param, Random *random);
+  void readVFromPool(Lattice *lat, Parameters *param);
+  void writeVToPool(Lattice *lat, Parameters *param);
   // void eccentricity(Lattice *lat, Group *group, Parameters *param, Random
   // *random, Glauber *glauber);
   void multiplicity(Lattice *lat, Parameters *param);
 
-  void readInNucleusConfigs(const int nucleusA,
-                            const int lightNucleusOption,
-                            vector< vector<float> > &nucleonPosArr);
+  const NucleusConfigurations *
+  readInNucleusConfigs(const int nucleusA, const int lightNucleusOption);
 
   void generate_nucleus_configuration(Random *random, int A, int Z, double a_WS,
                                       double R_WS, double beta2, double beta3,
@@ -103,6 +207,14 @@ public:
   void sample_r_and_costheta_from_deformed_woods_saxon(
       Random *random, double a_WS, double R_WS, double beta2, double beta3,
       double beta4, double &r, double &costheta) const;
+  const DeformedWoodsSaxonEnvelope &get_deformed_woods_saxon_envelope(
+      double a_WS, double R_WS, double beta2, double beta3, double beta4,
+      double gamma, double rmaxCut) const;
+  void sample_from_deformed_woods_saxon(
+      Random *random, const DeformedWoodsSaxonEnvelope &envelope, double &r,
+      double &costheta, double &phi) const;
+  double deformed_radius(double R_WS, double beta2, double beta3, double beta4,
+                         double gamma, double costheta, double phi) const;
   double fermi_distribution(double r, double R_WS, double a_WS) const;
   double spherical_harmonics(int l, double ct) const;
   double spherical_harmonics_Y22(double ct, double phi) const;
@@ -0,0 +1,37 @@
+#include "KtSpectrum.h"
+
+#include <cmath>
+
+KtSpectrum::KtSpectrum(int NIn, int binsIn, double dktIn)
+    : N(NIn), bins(binsIn), dkt(dktIn), omega_(NIn * NIn, 0.),
+      bin_(NIn * NIn, -1), count_(binsIn, 0) {
+  for (int i = 0; i < N; i++) {
+    const double kx =
+        2. * M_PI * (-0.5 + static_cast<double>(i) / static_cast<double>(N));
+    for (int j = 0; j < N; j++) {
+      const double ky =
+          2. * M_PI * (-0.5 + static_cast<double>(j) / static_cast<double>(N));
+      const int pos = i * N + j;
+      // lattice dispersion relation (omega squared)
+      const double omega2 =
+          4. * (sin(kx / 2.) * sin(kx / 2.) + sin(ky / 2.) * sin(ky / 2.));
+      const double kt = sqrt(omega2);
+      omega_[pos] = kt;
+
+      // bin ik holds ik*dkt < k_T <= (ik+1)*dkt; the guess from the division
+      // is corrected so that modes on a bin edge land where the comparison
+      // puts them
+      int ik = static_cast<int>(ceil(kt / dkt)) - 1;
+      while (ik >= 0 && !(kt > ik * dkt))
+        ik--;
+      while (ik + 1 < bins && kt > (ik + 1) * dkt)
+        ik++;
+      if (ik < 0 || ik >= bins || !(kt <= (ik + 1) * dkt))
+        ik = -1;
+      bin_[pos] = ik;
+
+      if (ik >= 0 && used(pos))
+        count_[ik]++;
+    }
+  }
+}
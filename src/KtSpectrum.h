@@ -0,0 +1,90 @@
+#ifndef KtSpectrum_h
+#define KtSpectrum_h
+
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// The KtSpectrum class bins quantities of the N x N lattice momentum modes in
+// k_T. Modes are in the order of the fftn output, pos = i*N + j with
+// k = 2 pi (i/N - 1/2). The lattice dispersion
+// omega = 2 sqrt(sin^2(kx/2) + sin^2(ky/2)), which is also |k_T| on the
+// lattice, and the bin of every mode are computed once, so filling the
+// histograms needs no search over the bins; they are filled in parallel
+// with one copy per thread.
+
+class KtSpectrum {
+private:
+  int N;
+  int bins;
+  double dkt;
+  std::vector<double> omega_; // lattice dispersion of each mode
+  std::vector<int> bin_;      // k_T bin of each mode, -1 if outside
+  std::vector<int> count_;    // number of used modes in each bin
+
+public:
+  KtSpectrum(int NIn, int binsIn, double dktIn);
+
+  int getBins() const { return bins; }
+  double getDkt() const { return dkt; }
+  double omega(int pos) const { return omega_[pos]; }
+  int bin(int pos) const { return bin_[pos]; }
+  int count(int ik) const { return count_[ik]; }
+
+  // modes with i = 0 or j = 0 have no partner at -k and are left out
+  bool used(int pos) const { return pos / N != 0 && pos % N != 0; }
+
+  // Sums w = weight(pos) over the used modes: w into sum[ik], omega*w into
+  // sumOmega[ik] and w/omega into sumOverOmega[ik] of the mode's bin.
+  // total and totalOmega are the sums of w and omega*w over all used modes.
+  // weight is called once per mode and from several threads.
+  template <class Weight>
+  void accumulate(const Weight &weight, std::vector<double> &sum,
+                  std::vector<double> &sumOmega,
+                  std::vector<double> &sumOverOmega, double &total,
+                  double &totalOmega) const {
+    sum.assign(bins, 0.);
+    sumOmega.assign(bins, 0.);
+    sumOverOmega.assign(bins, 0.);
+    double localTotal = 0.;
+    double localTotalOmega = 0.;
+
+#pragma omp parallel reduction(+ : localTotal, localTotalOmega)
+    {
+      std::vector<double> threadSum(bins, 0.);
+      std::vector<double> threadSumOmega(bins, 0.);
+      std::vector<double> threadSumOverOmega(bins, 0.);
+#pragma omp for
+      for (int i = 1; i < N; i++) {
+        for (int j = 1; j < N; j++) {
+          const int pos = i * N + j;
+          const double w = weight(pos);
+          const double om = omega_[pos];
+          localTotal += w;
+          localTotalOmega += om * w;
+          const int ik = bin_[pos];
+          if (ik >= 0) {
+            threadSum[ik] += w;
+            threadSumOmega[ik] += om * w;
+            threadSumOverOmega[ik] += w / om;
+          }
+        }
+      }
+#pragma omp critical
+      {
+        for (int ik = 0; ik < bins; ik++) {
+          sum[ik] += threadSum[ik];
+          sumOmega[ik] += threadSumOmega[ik];
+          sumOverOmega[ik] += threadSumOverOmega[ik];
+        }
+      }
+    }
+
+    total = localTotal;
+    totalOmega = localTotalOmega;
+  }
+};
+
+#endif
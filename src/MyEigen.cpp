@@ -9,269 +9,335 @@ using PhysConst::small_eps;
 //**************************************************************************
 // MyEigen class.
 
-void MyEigen::flowVelocity4D(Lattice *lat, Parameters *param, int it) {
-  int N = param->getSize();
-  int pos;
-  int changeSign;
-  int count;
-  double L = param->getL();
-  double a = L / N;                                    // lattice spacing in fm
-  double x, y, ux = 0., uy = 0., ueta = 0., utau = 0.; // [GeV^2]
-  double dtau = param->getdtau();
+// Landau matching T^mu_nu u^nu = eps u^mu for the 4x4 matrix M = T g with
+// g = diag(1, -1, -1, -tau^2). Since T is symmetric, the eigenvectors are
+// the stationary points of the Rayleigh quotient u g M u / u g u of the
+// symmetric pencil (g T g, g), so Rayleigh quotient iteration, started from
+// the energy flux T^{mu tau}, converges cubically. Returns 1 and the
+// time-like eigenvector, normalized to u g u = 1 with u^tau > 0, and its
+// eigenvalue eps, or 0 if the iteration does not end on a time-like
+// eigenvector.
+int MyEigen::landauMatching(const double M[4][4], double tau2, double &eps,
+                            double u[4]) {
+  const double g[4] = {1., -1., -1., -tau2};
+  const int maxIterations = 30;
+  const double tolerance = 1e-12;
+
+  double scale = 0.;
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++)
+      scale = max(scale, abs(M[i][j]) * sqrt(abs(g[j] / g[i])));
+  if (scale == 0.)
+    return 0;
+
+  for (int i = 0; i < 4; i++)
+    u[i] = M[i][0];
+  if (u[0] * u[0] - u[1] * u[1] - u[2] * u[2] - tau2 * u[3] * u[3] <= 0.) {
+    u[0] = 1.;
+    u[1] = u[2] = u[3] = 0.;
+  }
+
+  for (int iteration = 0; iteration < maxIterations; iteration++) {
+    // Rayleigh quotient and residual
+    double Mu[4];
+    double uMu = 0., uu = 0.;
+    for (int i = 0; i < 4; i++) {
+      Mu[i] = M[i][0] * u[0] + M[i][1] * u[1] + M[i][2] * u[2] +
+              M[i][3] * u[3];
+      uMu += g[i] * u[i] * Mu[i];
+      uu += g[i] * u[i] * u[i];
+    }
+    if (uu <= 0.)
+      return 0;
+    eps = uMu / uu;
+
+    double residual = 0.;
+    for (int i = 0; i < 4; i++) {
+      double r = Mu[i] - eps * u[i];
+      residual += abs(g[i]) * r * r;
+    }
+    if (sqrt(residual / uu) <= tolerance * scale) {
+      double norm = sqrt(uu);
+      if (u[0] < 0)
+        norm = -norm;
+      for (int i = 0; i < 4; i++)
+        u[i] /= norm;
+      return 1;
+    }
+
+    // solve (M - eps) y = u by Gaussian elimination with partial pivoting
+    double A[4][5];
+    for (int i = 0; i < 4; i++) {
+      for (int j = 0; j < 4; j++)
+        A[i][j] = M[i][j];
+      A[i][i] -= eps;
+      A[i][4] = u[i];
+    }
+    for (int k = 0; k < 4; k++) {
+      int pivot = k;
+      for (int i = k + 1; i < 4; i++)
+        if (abs(A[i][k]) > abs(A[pivot][k]))
+          pivot = i;
+      if (pivot != k)
+        for (int j = k; j < 5; j++)
+          swap(A[k][j], A[pivot][j]);
+      if (A[k][k] == 0.) // eps is exact to machine precision
+        A[k][k] = 1e-16 * scale;
+      for (int i = k + 1; i < 4; i++) {
+        double f = A[i][k] / A[k][k];
+        for (int j = k; j < 5; j++)
+          A[i][j] -= f * A[k][j];
+      }
+    }
+    double y[4];
+    for (int i = 3; i >= 0; i--) {
+      y[i] = A[i][4];
+      for (int j = i + 1; j < 4; j++)
+        y[i] -= A[i][j] * y[j];
+      y[i] /= A[i][i];
+    }
+
+    double norm = 0.;
+    for (int i = 0; i < 4; i++)
+      norm = max(norm, abs(y[i]) * sqrt(abs(g[i])));
+    if (!(norm > 0.) || std::isinf(norm))
+      return 0; // also catches NaN
+    for (int i = 0; i < 4; i++)
+      u[i] = y[i] / norm;
+  }
+  return 0;
+}
+
+// The general solution with GSL's non-symmetric eigensolver for the cells
+// where landauMatching fails. data is M row by row. Returns the number of
+// time-like eigenvectors found; eps and u are those of the last one.
+int MyEigen::landauMatchingGSL(double *data, double tau2, double Ttautau,
+                               bool checkEps, bool checkU, double &eps,
+                               double u[4]) {
   gsl_complex square;
   gsl_complex factor;
   gsl_complex euklidiansquare;
-  double eps = 0.;
   gsl_complex z_aux;
-  gsl_complex tau2;
-  int foundU;
-  double averageux = 0.;
-  double averageuy = 0.;
-  double averageueta = 0.;
-  double averageeps = 0.;
-  count = 0;
+  gsl_complex gslTau2;
+  int foundU = 0;
 
-  for (int si = 0; si < N; si++) {
-    for (int sj = 0; sj < N; sj++) {
+  gsl_matrix_view m = gsl_matrix_view_array(data, 4, 4); // matrix
 
-      x = -L / 2. + a * si;
-      y = -L / 2. + a * sj;
+  gsl_vector_complex *eval = gsl_vector_complex_alloc(
+      4); // eigenvalues are components of this vector
+  gsl_matrix_complex *evec = gsl_matrix_complex_alloc(
+      4, 4); // eigenvectors are columns of this matrix
 
-      pos = si * N + sj;
-      GSL_SET_COMPLEX(&square, 0, 0);
-      //one upper, one lower index
-      double data[] = {
-          lat->cells[pos]->getTtautau(),
-          -lat->cells[pos]->getTtaux(),
-          -lat->cells[pos]->getTtauy(),
-          -(it * dtau * a) * (it * dtau * a) * lat->cells[pos]->getTtaueta(),
-          lat->cells[pos]->getTtaux(),
-          -lat->cells[pos]->getTxx(),
-          -lat->cells[pos]->getTxy(),
-          -(it * dtau * a) * (it * dtau * a) * lat->cells[pos]->getTxeta(),
-          lat->cells[pos]->getTtauy(),
-          -lat->cells[pos]->getTxy(),
-          -lat->cells[pos]->getTyy(),
-          -(it * dtau * a) * (it * dtau * a) * lat->cells[pos]->getTyeta(),
-          lat->cells[pos]->getTtaueta(),
-          -lat->cells[pos]->getTxeta(),
-          -lat->cells[pos]->getTyeta(),
-          -(it * dtau * a) * (it * dtau * a) * lat->cells[pos]->getTetaeta()};
-
-      gsl_matrix_view m = gsl_matrix_view_array(data, 4, 4); // matrix
-
-      gsl_vector_complex *eval = gsl_vector_complex_alloc(
-          4); // eigenvalues are components of this vector
-      gsl_matrix_complex *evec = gsl_matrix_complex_alloc(
-          4, 4); // eigenvectors are columns of this matrix
-
-      gsl_eigen_nonsymmv_workspace *w = gsl_eigen_nonsymmv_alloc(4); // workspace
-
-      gsl_eigen_nonsymmv(&m.matrix, eval, evec,
-                         w); // solve for eigenvalues and eigenvectors (without
-                             // 'v' only compute eigenvalues)
-
-      gsl_eigen_nonsymmv_free(w); // free memory associated with workspace
-
-      // set to 'zero'
-      lat->cells[pos]->setEpsilon(lat->cells[pos]->getTtautau());
-      lat->cells[pos]->setutau(1.);
-      lat->cells[pos]->setux(0.);
-      lat->cells[pos]->setuy(0.);
-      lat->cells[pos]->setueta(0.);
-
-      { // output:
-        int i;
-        foundU = 0;
-        for (i = 0; i < 4; i++) {
-          gsl_complex eval_i = gsl_vector_complex_get(eval, i);
-          gsl_vector_complex_view evec_i = gsl_matrix_complex_column(evec, i);
-
-          GSL_SET_COMPLEX(&square, 0, 0);
-          GSL_SET_COMPLEX(&tau2, a * it * dtau * a * it * dtau, 0);
-          GSL_SET_COMPLEX(&euklidiansquare, 0, 0);
-
-          for (int j = 0; j < 4; ++j) {
-            gsl_complex z = gsl_vector_complex_get(&evec_i.vector, j);
-            z_aux = gsl_complex_mul(tau2, z);
-            euklidiansquare =
-                gsl_complex_add(euklidiansquare, gsl_complex_mul(z, z));
-
-            if (j == 0)
-              square = gsl_complex_add(square, gsl_complex_mul(z, z));
-            else if (j < 3)
-              square = gsl_complex_sub(square, gsl_complex_mul(z, z));
-            else
-              square = gsl_complex_sub(square, gsl_complex_mul(z_aux, z));
-          }
+  gsl_eigen_nonsymmv_workspace *w = gsl_eigen_nonsymmv_alloc(4); // workspace
 
-          GSL_SET_COMPLEX(
-              &factor, sqrt(abs(GSL_REAL(euklidiansquare) / GSL_REAL(square))),
-              0);
-          if (GSL_REAL(square) > 0) {
-            eps = GSL_REAL(eval_i);
-            if (abs(GSL_IMAG(eval_i)) > 0.001 && si > 0 && sj > 0 &&
-                si < N - 5 && sj < N - 5) {
-              eps = lat->cells[pos]->getTtautau();
-            }
-          }
+  gsl_eigen_nonsymmv(&m.matrix, eval, evec,
+                     w); // solve for eigenvalues and eigenvectors (without
+                         // 'v' only compute eigenvalues)
 
-          GSL_SET_COMPLEX(&square, 0, 0);
+  gsl_eigen_nonsymmv_free(w); // free memory associated with workspace
 
-          for (int j = 0; j < 4; ++j) {
-            gsl_complex z = gsl_vector_complex_get(&evec_i.vector, j);
-            z = gsl_complex_mul(z, factor);
-            z_aux = gsl_complex_mul(tau2, z);
+  for (int i = 0; i < 4; i++) {
+    gsl_complex eval_i = gsl_vector_complex_get(eval, i);
+    gsl_vector_complex_view evec_i = gsl_matrix_complex_column(evec, i);
 
-            if (j == 0)
-              square = gsl_complex_add(square, gsl_complex_mul(z, z));
-            else if (j < 3)
-              square = gsl_complex_sub(square, gsl_complex_mul(z, z));
-            else
-              square = gsl_complex_sub(square, gsl_complex_mul(z_aux, z));
-          }
-          changeSign = 0;
-          // for the time-like eigenvector do the following (this is the flow
-          // velocity)
-          if (GSL_REAL(square) > 0) {
-            foundU += 1;
-            for (int j = 0; j < 4; ++j) {
-              gsl_complex z = gsl_vector_complex_get(&evec_i.vector, j);
-              z = gsl_complex_mul(z, factor);
-
-              if (j == 0 && GSL_REAL(z) < 0) {
-                changeSign = 1;
-                GSL_SET_COMPLEX(&z, -1. * GSL_REAL(z), -1. * GSL_IMAG(z));
-              }
-
-              if (j > 0 && changeSign == 1) {
-                GSL_SET_COMPLEX(&z, -1. * GSL_REAL(z), -1. * GSL_IMAG(z));
-              }
-
-              if (j == 0) {
-                if (eps > 0.1)
-                  utau = GSL_REAL(z);
-                else
-                  utau = 1.;
-              }
-              if (j == 1) {
-                if (eps > 0.1)
-                  ux = GSL_REAL(z);
-                else
-                  ux = 0.;
-              }
-              if (j == 2) {
-                if (eps > 0.1)
-                  uy = GSL_REAL(z);
-                else
-                  uy = 0.;
-              }
-              if (j == 3) {
-                if (eps > 0.1)
-                  ueta = GSL_REAL(z);
-                else
-                  ueta = 0.;
-              }
-              if (abs(GSL_IMAG(z)) > 0.001 && eps > 0.001 && si > 10 &&
-                  sj > 10 && si < N - 10 && sj < N - 10) {
-                utau = 1.;
-                ux = 0.;
-                uy = 0.;
-                ueta = 0.;
-                eps = lat->cells[pos]->getTtautau();
-              }
-            }
-
-            lat->cells[pos]->setutau(utau);
-            lat->cells[pos]->setux(ux);
-            lat->cells[pos]->setuy(uy);
-            lat->cells[pos]->setueta(ueta);
-            lat->cells[pos]->setEpsilon(eps);
-
-            // //clean up numerical noise outside the interaction region
-            // if (lat->cells[pos]->getg2mu2A() < 1e-12 ||
-            //     lat->cells[pos]->getg2mu2B() < 1e-12)
-            //   lat->cells[pos]->setEpsilon(0.);
-
-            averageux += ux * ux * eps;
-            averageuy += uy * uy * eps;
-            averageueta += ueta * ueta * eps * it * dtau * a * it * dtau * a;
-            averageeps += eps;
-
-            count++;
-          }
-        }
+    GSL_SET_COMPLEX(&square, 0, 0);
+    GSL_SET_COMPLEX(&gslTau2, tau2, 0);
+    GSL_SET_COMPLEX(&euklidiansquare, 0, 0);
+
+    for (int j = 0; j < 4; ++j) {
+      gsl_complex z = gsl_vector_complex_get(&evec_i.vector, j);
+      z_aux = gsl_complex_mul(gslTau2, z);
+      euklidiansquare = gsl_complex_add(euklidiansquare, gsl_complex_mul(z, z));
+
+      if (j == 0)
+        square = gsl_complex_add(square, gsl_complex_mul(z, z));
+      else if (j < 3)
+        square = gsl_complex_sub(square, gsl_complex_mul(z, z));
+      else
+        square = gsl_complex_sub(square, gsl_complex_mul(z_aux, z));
+    }
+
+    GSL_SET_COMPLEX(
+        &factor, sqrt(abs(GSL_REAL(euklidiansquare) / GSL_REAL(square))), 0);
+    if (GSL_REAL(square) > 0) {
+      eps = GSL_REAL(eval_i);
+      if (abs(GSL_IMAG(eval_i)) > 0.001 && checkEps) {
+        eps = Ttautau;
       }
+    }
+
+    GSL_SET_COMPLEX(&square, 0, 0);
+
+    for (int j = 0; j < 4; ++j) {
+      gsl_complex z = gsl_vector_complex_get(&evec_i.vector, j);
+      z = gsl_complex_mul(z, factor);
+      z_aux = gsl_complex_mul(gslTau2, z);
 
-      // write Tmunu in case no u was found
-      if (foundU == 0) {
-        if (si == N / 2 && sj == N / 2) {
-          cout << si << " " << sj << endl << endl;
-          cout << lat->cells[pos]->getTtautau() << " "
-               << lat->cells[pos]->getTtaux() << " "
-               << lat->cells[pos]->getTtauy() << " "
-               << lat->cells[pos]->getTtaueta() << endl;
-          cout << lat->cells[pos]->getTtaux() << " "
-               << lat->cells[pos]->getTxx() << " " << lat->cells[pos]->getTxy()
-               << " " << lat->cells[pos]->getTxeta() << endl;
-          cout << lat->cells[pos]->getTtauy() << " "
-               << lat->cells[pos]->getTxy() << " " << lat->cells[pos]->getTyy()
-               << " " << lat->cells[pos]->getTyeta() << endl;
-          cout << lat->cells[pos]->getTtaueta() << " "
-               << lat->cells[pos]->getTxeta() << " "
-               << lat->cells[pos]->getTyeta() << " "
-               << lat->cells[pos]->getTetaeta() << endl;
-          cout << "ux=" << ux << endl;
-          cout << "uy=" << uy << endl;
-          cout << "ueta=" << ueta << endl;
+      if (j == 0)
+        square = gsl_complex_add(square, gsl_complex_mul(z, z));
+      else if (j < 3)
+        square = gsl_complex_sub(square, gsl_complex_mul(z, z));
+      else
+        square = gsl_complex_sub(square, gsl_complex_mul(z_aux, z));
+    }
+    int changeSign = 0;
+    // for the time-like eigenvector do the following (this is the flow
+    // velocity)
+    if (GSL_REAL(square) > 0) {
+      foundU += 1;
+      for (int j = 0; j < 4; ++j) {
+        gsl_complex z = gsl_vector_complex_get(&evec_i.vector, j);
+        z = gsl_complex_mul(z, factor);
+
+        if (j == 0 && GSL_REAL(z) < 0) {
+          changeSign = 1;
+          GSL_SET_COMPLEX(&z, -1. * GSL_REAL(z), -1. * GSL_IMAG(z));
+        }
+
+        if (j > 0 && changeSign == 1) {
+          GSL_SET_COMPLEX(&z, -1. * GSL_REAL(z), -1. * GSL_IMAG(z));
+        }
+
+        u[j] = GSL_REAL(z);
+        if (abs(GSL_IMAG(z)) > 0.001 && eps > 0.001 && checkU) {
+          // complex flow velocity: leave the cell at rest
+          u[0] = 1.;
+          u[1] = u[2] = u[3] = 0.;
+          eps = Ttautau;
+          break;
         }
       }
+    }
+  }
+
+  gsl_vector_complex_free(eval);
+  gsl_matrix_complex_free(evec);
+  return foundU;
+}
 
-      // compute pi^{\mu\nu}
-      if (utau == 1 && ux == 0 && uy == 0 && ueta == 0) {
-        lat->cells[pos]->setpitautau(0.);
-        lat->cells[pos]->setpixx(0.);
-        lat->cells[pos]->setpiyy(0.);
-        lat->cells[pos]->setpietaeta(0.);
-
-        lat->cells[pos]->setpitaux(0.);
-        lat->cells[pos]->setpitauy(0.);
-        lat->cells[pos]->setpitaueta(0.);
-
-        lat->cells[pos]->setpixeta(0.);
-        lat->cells[pos]->setpixy(0.);
-        lat->cells[pos]->setpiyeta(0.);
-      } else {
-        lat->cells[pos]->setpitautau(lat->cells[pos]->getTtautau() -
-                                     4. / 3. * eps * utau * utau + eps / 3.);
-        lat->cells[pos]->setpixx(lat->cells[pos]->getTxx() -
-                                 4. / 3. * eps * ux * ux - eps / 3.);
-        lat->cells[pos]->setpiyy(lat->cells[pos]->getTyy() -
-                                 4. / 3. * eps * uy * uy - eps / 3.);
-        lat->cells[pos]->setpietaeta(lat->cells[pos]->getTetaeta() -
-                                     4. / 3. * eps * ueta * ueta -
-                                     eps / 3. / it / dtau / a / it / dtau / a);
-
-        lat->cells[pos]->setpitaux(lat->cells[pos]->getTtaux() -
-                                   4. / 3. * eps * utau * ux);
-        lat->cells[pos]->setpitauy(lat->cells[pos]->getTtauy() -
-                                   4. / 3. * eps * utau * uy);
-        lat->cells[pos]->setpitaueta(lat->cells[pos]->getTtaueta() -
-                                     4. / 3. * eps * utau * ueta);
-
-        lat->cells[pos]->setpixeta(lat->cells[pos]->getTxeta() -
-                                   4. / 3. * eps * ux * ueta);
-        lat->cells[pos]->setpixy(lat->cells[pos]->getTxy() -
-                                 4. / 3. * eps * ux * uy);
-        lat->cells[pos]->setpiyeta(lat->cells[pos]->getTyeta() -
-                                   4. / 3. * eps * uy * ueta);
+void MyEigen::flowVelocity4D(Lattice *lat, Parameters *param, int it) {
+  const int N = param->getSize();
+  int pos;
+  double L = param->getL();
+  double a = L / N; // lattice spacing in fm
+  double x, y;
+  double dtau = param->getdtau();
+  const double tau2 = (it * dtau * a) * (it * dtau * a);
+  double averageux = 0.;
+  double averageuy = 0.;
+  double averageueta = 0.;
+  double averageeps = 0.;
+  int fallbacks = 0;
+
+#pragma omp parallel for reduction(+ : averageux, averageuy, averageueta,     \
+                                   averageeps, fallbacks)
+  for (pos = 0; pos < N * N; pos++) {
+    const int si = pos / N;
+    const int sj = pos % N;
+    Cell *cell = lat->cells[pos];
+
+    // one upper, one lower index
+    const double M[4][4] = {
+        {cell->getTtautau(), -cell->getTtaux(), -cell->getTtauy(),
+         -tau2 * cell->getTtaueta()},
+        {cell->getTtaux(), -cell->getTxx(), -cell->getTxy(),
+         -tau2 * cell->getTxeta()},
+        {cell->getTtauy(), -cell->getTxy(), -cell->getTyy(),
+         -tau2 * cell->getTyeta()},
+        {cell->getTtaueta(), -cell->getTxeta(), -cell->getTyeta(),
+         -tau2 * cell->getTetaeta()}};
+
+    // 'zero': at rest with the energy density T^{tau tau}
+    double eps = cell->getTtautau();
+    double u[4] = {1., 0., 0., 0.};
+    int foundU = landauMatching(M, tau2, eps, u);
+    if (!foundU) {
+      fallbacks++;
+      double data[16];
+      for (int i = 0; i < 16; i++)
+        data[i] = M[i / 4][i % 4];
+      eps = cell->getTtautau();
+      foundU = landauMatchingGSL(
+          data, tau2, cell->getTtautau(),
+          si > 0 && sj > 0 && si < N - 5 && sj < N - 5,
+          si > 10 && sj > 10 && si < N - 10 && sj < N - 10, eps, u);
+      if (!foundU) {
+        eps = cell->getTtautau();
+        u[0] = 1.;
+        u[1] = u[2] = u[3] = 0.;
       }
+    }
+
+    // no flow where there is (almost) no energy
+    if (eps <= 0.1) {
+      u[0] = 1.;
+      u[1] = u[2] = u[3] = 0.;
+    }
+    const double utau = u[0];
+    const double ux = u[1];
+    const double uy = u[2];
+    const double ueta = u[3];
+
+    cell->setutau(utau);
+    cell->setux(ux);
+    cell->setuy(uy);
+    cell->setueta(ueta);
+    cell->setEpsilon(eps);
+
+    if (foundU) {
+      averageux += ux * ux * eps;
+      averageuy += uy * uy * eps;
+      averageueta += ueta * ueta * eps * tau2;
+      averageeps += eps;
+    }
+
+    // write Tmunu in case no u was found
+    if (foundU == 0 && si == N / 2 && sj == N / 2) {
+#pragma omp critical
+      {
+        cout << si << " " << sj << endl << endl;
+        for (int i = 0; i < 4; i++)
+          cout << M[i][0] << " " << -M[i][1] << " " << -M[i][2] << " "
+               << -M[i][3] / tau2 << endl;
+      }
+    }
 
-      gsl_vector_complex_free(eval);
-      gsl_matrix_complex_free(evec);
+    // compute pi^{\mu\nu}
+    if (utau == 1 && ux == 0 && uy == 0 && ueta == 0) {
+      cell->setpitautau(0.);
+      cell->setpixx(0.);
+      cell->setpiyy(0.);
+      cell->setpietaeta(0.);
+
+      cell->setpitaux(0.);
+      cell->setpitauy(0.);
+      cell->setpitaueta(0.);
+
+      cell->setpixeta(0.);
+      cell->setpixy(0.);
+      cell->setpiyeta(0.);
+    } else {
+      cell->setpitautau(cell->getTtautau() - 4. / 3. * eps * utau * utau +
+                        eps / 3.);
+      cell->setpixx(cell->getTxx() - 4. / 3. * eps * ux * ux - eps / 3.);
+      cell->setpiyy(cell->getTyy() - 4. / 3. * eps * uy * uy - eps / 3.);
+      cell->setpietaeta(cell->getTetaeta() - 4. / 3. * eps * ueta * ueta -
+                        eps / 3. / tau2);
+
+      cell->setpitaux(cell->getTtaux() - 4. / 3. * eps * utau * ux);
+      cell->setpitauy(cell->getTtauy() - 4. / 3. * eps * utau * uy);
+      cell->setpitaueta(cell->getTtaueta() - 4. / 3. * eps * utau * ueta);
+
+      cell->setpixeta(cell->getTxeta() - 4. / 3. * eps * ux * ueta);
+      cell->setpixy(cell->getTxy() - 4. / 3. * eps * ux * uy);
+      cell->setpiyeta(cell->getTyeta() - 4. / 3. * eps * uy * ueta);
     }
   }
 
+  if (fallbacks > 0)
+    cout << it * dtau * a << " Landau matching needed the general eigensolver"
+         << " in " << fallbacks << " cells" << endl;
+
   cout << it * dtau * a << " average u^x=" << sqrt(averageux / averageeps)
        << endl;
   cout << it * dtau * a << " average u^y=" << sqrt(averageuy / averageeps)
@@ -317,21 +383,17 @@ void MyEigen::flowVelocity4D(Lattice *lat, Parameters *param, int it) {
     cout << "WARNING: hydro grid length larger than the computed one." << endl;
   }
 
-  int xpos, ypos, xposUp, yposUp, pos1, pos2, pos3;
-  double fracx, fracy, x1, x2;
-  double xlow, ylow;
-  int pos4;
-  double resultE, resultutau, resultux, resultuy, resultueta;
-  double resultpi00, resultpi0x, resultpi0y, resultpi0eta;
-  double resultpixy, resultpixeta, resultpiyeta, resultpixx, resultpiyy,
-      resultpietaeta;
-  double g2mu2A, g2mu2B;
-
   double tau0 = it * dtau * a;
 
   double ha;
   ha = hL / static_cast<double>(hx);
 
+  // interpolation stencils of all transverse points of the hydro grid, point
+  // p = ix * hy + iy; all eta slices are the same
+  std::vector<HydroStencil> stencils;
+  hydroStencils(param, hx, hy, hL, stencils);
+  const int points = hx * hy;
+
   stringstream streuH_name;
   streuH_name << "epsilon-u-Hydro-t" << it * dtau * a << "-"
               << param->getEventId() << ".dat";
@@ -341,6 +403,20 @@ void MyEigen::flowVelocity4D(Lattice *lat, Parameters *param, int it) {
   // ".dat"; string Etot_name; Etot_name = strEtot_name.str();
 
   if (param->getWriteOutputs() % 2 == 1) {
+    enum { E, UX, UY, UETA, PI00, PI0X, PI0Y, PI0ETA, PIXX, PIXY, PIXETA,
+           PIYY, PIYETA, PIETAETA, FIELDS };
+    const std::vector<CellField> fields = {
+        &Cell::getEpsilon,  &Cell::getux,       &Cell::getuy,
+        &Cell::getueta,     &Cell::getpitautau, &Cell::getpitaux,
+        &Cell::getpitauy,   &Cell::getpitaueta, &Cell::getpixx,
+        &Cell::getpixy,     &Cell::getpixeta,   &Cell::getpiyy,
+        &Cell::getpiyeta,   &Cell::getpietaeta};
+    std::vector<bool> absolute(FIELDS, false);
+    absolute[E] = true;
+    std::vector<double> result;
+    resample(lat, stencils, fields, absolute, result);
+    auto value = [&](int field, int p) { return result[field * points + p]; };
+
     ofstream foutEps2(streuH_name.str().c_str(), ios::out);
     //      ofstream foutEtot(Etot_name.c_str(),ios::out);
 
@@ -348,346 +424,42 @@ void MyEigen::flowVelocity4D(Lattice *lat, Parameters *param, int it) {
              << " ymax= " << hy << " deta= " << deta << " dx= " << ha
              << " dy= " << ha << endl;
 
+    // total energy of one eta slice
+    double Eslice = 0.;
+    for (int p = 0; p < points; p++) {
+      if (stencils[p].inside)
+        Eslice += abs(hbarc * value(E, p) * gfactor) * ha * ha * it * dtau * a;
+    }
+    Etot = heta * Eslice;
+
     for (int ieta = 0; ieta < heta; ieta++) // loop over all positions
     {
       for (int ix = 0; ix < hx; ix++) // loop over all positions
       {
         for (int iy = 0; iy < hy; iy++) {
+          const int p = ix * hy + iy;
           x = -hL / 2. + ha * ix;
           y = -hL / 2. + ha * iy;
 
-          //		  cout << ix << " " << iy << endl;
-
-          if (abs(x) < L / 2. && abs(y) < L / 2.) {
-            xpos = static_cast<int>(floor((x + L / 2.) / a + 0.0000000001));
-            ypos = static_cast<int>(floor((y + L / 2.) / a + 0.0000000001));
-
-            if (xpos < N - 1)
-              xposUp = xpos + 1;
-            else
-              xposUp = xpos;
-
-            if (ypos < N - 1)
-              yposUp = ypos + 1;
-            else
-              yposUp = ypos;
-
-            xlow = -L / 2. + a * xpos;
-            ylow = -L / 2. + a * ypos;
-
-            // xhigh = -L/2.+a*xposUp;
-            // yhigh = -L/2.+a*yposUp;
-
-            fracx = (x - xlow) / ha;
-
-            pos1 = xpos * N + ypos;
-            pos2 = xposUp * N + ypos;
-            pos3 = xpos * N + yposUp;
-            pos4 = xposUp * N + yposUp;
-
-            // -----------------------------epsilon---------------------------------
-            // //
-            if (pos1 > 0 && pos1 < (N) * (N) && pos2 > 0 && pos2 < (N) * (N))
-              x1 = (1 - fracx) * abs(lat->cells[pos1]->getEpsilon()) +
-                   fracx * abs(lat->cells[pos2]->getEpsilon());
-            else
-              x1 = 0.;
-
-            if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N)
-              x2 = (1 - fracx) * abs(lat->cells[pos3]->getEpsilon()) +
-                   fracx * abs(lat->cells[pos4]->getEpsilon());
-            else
-              x2 = 0.;
-
-            fracy = (y - ylow) / ha;
-
-            resultE = (1. - fracy) * x1 + fracy * x2;
-
-            // -----------------------------g2mu2A----------------------------------
-            // //
-            if (pos1 > 0 && pos1 < (N) * (N) && pos2 > 0 && pos2 < (N) * (N))
-              x1 = (1 - fracx) * abs(lat->cells[pos1]->getg2mu2A()) +
-                   fracx * abs(lat->cells[pos2]->getg2mu2A());
-            else
-              x1 = 0.;
-
-            if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N)
-              x2 = (1 - fracx) * abs(lat->cells[pos3]->getg2mu2A()) +
-                   fracx * abs(lat->cells[pos4]->getg2mu2A());
-            else
-              x2 = 0.;
-
-            g2mu2A = (1. - fracy) * x1 + fracy * x2;
-
-            // -----------------------------g2mu2B----------------------------------
-            // //
-            if (pos1 > 0 && pos1 < (N) * (N) && pos2 > 0 && pos2 < (N) * (N))
-              x1 = (1 - fracx) * abs(lat->cells[pos1]->getg2mu2B()) +
-                   fracx * abs(lat->cells[pos2]->getg2mu2B());
-            else
-              x1 = 0.;
-
-            if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N)
-              x2 = (1 - fracx) * abs(lat->cells[pos3]->getg2mu2B()) +
-                   fracx * abs(lat->cells[pos4]->getg2mu2B());
-            else
-              x2 = 0.;
-
-            g2mu2B = (1. - fracy) * x1 + fracy * x2;
-
-            // -----------------------------utau------------------------------------
-            // //
-            if (pos1 > 0 && pos1 < (N) * (N) && pos2 > 0 && pos2 < (N) * (N))
-              x1 = (1 - fracx) * (lat->cells[pos1]->getutau()) +
-                   fracx * (lat->cells[pos2]->getutau());
-            else
-              x1 = 0.;
-
-            if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N)
-              x2 = (1 - fracx) * (lat->cells[pos3]->getutau()) +
-                   fracx * (lat->cells[pos4]->getutau());
-            else
-              x2 = 0.;
-
-            resultutau = (1. - fracy) * x1 + fracy * x2;
-
-            // -----------------------------ux--------------------------------------
-            // //
-            if (pos1 > 0 && pos1 < (N) * (N) && pos2 > 0 && pos2 < (N) * (N))
-              x1 = (1 - fracx) * (lat->cells[pos1]->getux()) +
-                   fracx * (lat->cells[pos2]->getux());
-            else
-              x1 = 0.;
-
-            if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N)
-              x2 = (1 - fracx) * (lat->cells[pos3]->getux()) +
-                   fracx * (lat->cells[pos4]->getux());
-            else
-              x2 = 0.;
-
-            resultux = (1. - fracy) * x1 + fracy * x2;
-
-            // -----------------------------uy--------------------------------------
-            // //
-            if (pos1 > 0 && pos1 < (N) * (N) && pos2 > 0 && pos2 < (N) * (N))
-              x1 = (1 - fracx) * (lat->cells[pos1]->getuy()) +
-                   fracx * (lat->cells[pos2]->getuy());
-            else
-              x1 = 0.;
-
-            if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N)
-              x2 = (1 - fracx) * (lat->cells[pos3]->getuy()) +
-                   fracx * (lat->cells[pos4]->getuy());
-            else
-              x2 = 0.;
-
-            resultuy = (1. - fracy) * x1 + fracy * x2;
-
-            // -----------------------------ueta------------------------------------
-            // //
-            if (pos1 > 0 && pos1 < (N) * (N) && pos2 > 0 && pos2 < (N) * (N))
-              x1 = (1 - fracx) * (lat->cells[pos1]->getueta()) +
-                   fracx * (lat->cells[pos2]->getueta());
-            else
-              x1 = 0.;
-
-            if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N)
-              x2 = (1 - fracx) * (lat->cells[pos3]->getueta()) +
-                   fracx * (lat->cells[pos4]->getueta());
-            else
-              x2 = 0.;
-
-            resultueta = (1. - fracy) * x1 + fracy * x2;
-
-            // -----------------------------pitautau--------------------------------
-            // //
-            if (pos1 > 0 && pos1 < (N) * (N) && pos2 > 0 && pos2 < (N) * (N))
-              x1 = (1 - fracx) * (lat->cells[pos1]->getpitautau()) +
-                   fracx * (lat->cells[pos2]->getpitautau());
-            else
-              x1 = 0.;
-
-            if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N)
-              x2 = (1 - fracx) * (lat->cells[pos3]->getpitautau()) +
-                   fracx * (lat->cells[pos4]->getpitautau());
-            else
-              x2 = 0.;
-
-            resultpi00 = (1. - fracy) * x1 + fracy * x2;
-
-            // -----------------------------pitaux----------------------------------
-            // //
-            if (pos1 > 0 && pos1 < (N) * (N) && pos2 > 0 && pos2 < (N) * (N))
-              x1 = (1 - fracx) * (lat->cells[pos1]->getpitaux()) +
-                   fracx * (lat->cells[pos2]->getpitaux());
-            else
-              x1 = 0.;
-
-            if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N)
-              x2 = (1 - fracx) * (lat->cells[pos3]->getpitaux()) +
-                   fracx * (lat->cells[pos4]->getpitaux());
-            else
-              x2 = 0.;
-
-            resultpi0x = (1. - fracy) * x1 + fracy * x2;
-
-            // -----------------------------pitauy----------------------------------
-            // //
-            if (pos1 > 0 && pos1 < (N) * (N) && pos2 > 0 && pos2 < (N) * (N))
-              x1 = (1 - fracx) * (lat->cells[pos1]->getpitauy()) +
-                   fracx * (lat->cells[pos2]->getpitauy());
-            else
-              x1 = 0.;
-
-            if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N)
-              x2 = (1 - fracx) * (lat->cells[pos3]->getpitauy()) +
-                   fracx * (lat->cells[pos4]->getpitauy());
-            else
-              x2 = 0.;
-
-            resultpi0y = (1. - fracy) * x1 + fracy * x2;
-
-            // -----------------------------pitaueta--------------------------------
-            // //
-            if (pos1 > 0 && pos1 < (N) * (N) && pos2 > 0 && pos2 < (N) * (N))
-              x1 = (1 - fracx) * (lat->cells[pos1]->getpitaueta()) +
-                   fracx * (lat->cells[pos2]->getpitaueta());
-            else
-              x1 = 0.;
-
-            if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N)
-              x2 = (1 - fracx) * (lat->cells[pos3]->getpitaueta()) +
-                   fracx * (lat->cells[pos4]->getpitaueta());
-            else
-              x2 = 0.;
-
-            resultpi0eta = (1. - fracy) * x1 + fracy * x2;
-
-            // -----------------------------pixy----------------------------------
-            // //
-            if (pos1 > 0 && pos1 < (N) * (N) && pos2 > 0 && pos2 < (N) * (N))
-              x1 = (1 - fracx) * (lat->cells[pos1]->getpixy()) +
-                   fracx * (lat->cells[pos2]->getpixy());
-            else
-              x1 = 0.;
-
-            if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N)
-              x2 = (1 - fracx) * (lat->cells[pos3]->getpixy()) +
-                   fracx * (lat->cells[pos4]->getpixy());
-            else
-              x2 = 0.;
-
-            resultpixy = (1. - fracy) * x1 + fracy * x2;
-
-            // -----------------------------pixeta----------------------------------
-            // //
-            if (pos1 > 0 && pos1 < (N) * (N) && pos2 > 0 && pos2 < (N) * (N))
-              x1 = (1 - fracx) * (lat->cells[pos1]->getpixeta()) +
-                   fracx * (lat->cells[pos2]->getpixeta());
-            else
-              x1 = 0.;
-
-            if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N)
-              x2 = (1 - fracx) * (lat->cells[pos3]->getpixeta()) +
-                   fracx * (lat->cells[pos4]->getpixeta());
-            else
-              x2 = 0.;
-
-            resultpixeta = (1. - fracy) * x1 + fracy * x2;
-
-            // -----------------------------piyeta----------------------------------
-            // //
-            if (pos1 > 0 && pos1 < (N) * (N) && pos2 > 0 && pos2 < (N) * (N))
-              x1 = (1 - fracx) * (lat->cells[pos1]->getpiyeta()) +
-                   fracx * (lat->cells[pos2]->getpiyeta());
-            else
-              x1 = 0.;
-
-            if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N)
-              x2 = (1 - fracx) * (lat->cells[pos3]->getpiyeta()) +
-                   fracx * (lat->cells[pos4]->getpiyeta());
-            else
-              x2 = 0.;
-
-            resultpiyeta = (1. - fracy) * x1 + fracy * x2;
-
-            // -----------------------------pixx------------------------------------
-            // //
-            if (pos1 > 0 && pos1 < (N) * (N) && pos2 > 0 && pos2 < (N) * (N))
-              x1 = (1 - fracx) * (lat->cells[pos1]->getpixx()) +
-                   fracx * (lat->cells[pos2]->getpixx());
-            else
-              x1 = 0.;
-
-            if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N)
-              x2 = (1 - fracx) * (lat->cells[pos3]->getpixx()) +
-                   fracx * (lat->cells[pos4]->getpixx());
-            else
-              x2 = 0.;
-
-            resultpixx = (1. - fracy) * x1 + fracy * x2;
-
-            // -----------------------------piyy------------------------------------
-            // //
-            if (pos1 > 0 && pos1 < (N) * (N) && pos2 > 0 && pos2 < (N) * (N))
-              x1 = (1 - fracx) * (lat->cells[pos1]->getpiyy()) +
-                   fracx * (lat->cells[pos2]->getpiyy());
-            else
-              x1 = 0.;
-
-            if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N)
-              x2 = (1 - fracx) * (lat->cells[pos3]->getpiyy()) +
-                   fracx * (lat->cells[pos4]->getpiyy());
-            else
-              x2 = 0.;
-
-            resultpiyy = (1. - fracy) * x1 + fracy * x2;
-
-            // -----------------------------pietaeta--------------------------------
-            // //
-            if (pos1 > 0 && pos1 < (N) * (N) && pos2 > 0 && pos2 < (N) * (N))
-              x1 = (1 - fracx) * (lat->cells[pos1]->getpietaeta()) +
-                   fracx * (lat->cells[pos2]->getpietaeta());
-            else
-              x1 = 0.;
-
-            if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N)
-              x2 = (1 - fracx) * (lat->cells[pos3]->getpietaeta()) +
-                   fracx * (lat->cells[pos4]->getpietaeta());
-            else
-              x2 = 0.;
-
-            resultpietaeta = (1. - fracy) * x1 + fracy * x2;
-
-            resultutau = sqrt(1. + resultux * resultux + resultuy * resultuy +
-                              tau0 * tau0 * resultueta * resultueta);
-
-            Etot += abs(hbarc * resultE * gfactor) * ha * ha * it * dtau * a;
-            if (abs(hbarc * resultE * gfactor) > 0.0000000001) {
-              foutEps2 << -(heta - 1) / 2. * deta + deta * ieta << " " << x
-                       << " " << y << " " << abs(hbarc * resultE * gfactor)
-                       << " " << resultutau << " " << resultux << " "
-                       << resultuy << " " << resultueta << " "
-                       << resultpi00 * gfactor << " " << resultpi0x * gfactor
-                       << " " << resultpi0y * gfactor << " "
-                       << resultpi0eta * gfactor << " " << resultpixx * gfactor
-                       << " " << resultpixy * gfactor << " "
-                       << resultpixeta * gfactor << " " << resultpiyy * gfactor
-                       << " " << resultpiyeta * gfactor << " "
-                       << resultpietaeta * gfactor << endl;
-            } else {
-              foutEps2 << -(heta - 1) / 2. * deta + deta * ieta << " " << x
-                       << " " << y << " " << 0. << " " << 1. << " " << 0. << " "
-                       << 0. << " " << 0. << " " << 0. << " " << 0. << " " << 0.
-                       << " " << 0. << " " << 0. << " " << 0. << " " << 0.
-                       << " " << 0. << " " << 0. << " " << 0. << endl;
-            }
+          if (stencils[p].inside &&
+              abs(hbarc * value(E, p) * gfactor) > 0.0000000001) {
+            const double ux = value(UX, p);
+            const double uy = value(UY, p);
+            const double ueta = value(UETA, p);
+            const double utau =
+                sqrt(1. + ux * ux + uy * uy + tau0 * tau0 * ueta * ueta);
+            foutEps2 << -(heta - 1) / 2. * deta + deta * ieta << " " << x
+                     << " " << y << " " << abs(hbarc * value(E, p) * gfactor)
+                     << " " << utau << " " << ux << " " << uy << " " << ueta;
+            for (int field = PI00; field < FIELDS; field++)
+              foutEps2 << " " << value(field, p) * gfactor;
+            foutEps2 << endl;
           } else {
-            foutEps2 << -(heta - 1) / 2. * deta + deta * ieta << " " << x << " "
-                     << y << " " << 0. << " " << 1. << " " << 0. << " " << 0.
-                     << " " << 0. << " " << 0. << " " << 0. << " " << 0. << " "
+            foutEps2 << -(heta - 1) / 2. * deta + deta * ieta << " " << x
+                     << " " << y << " " << 0. << " " << 1. << " " << 0. << " "
                      << 0. << " " << 0. << " " << 0. << " " << 0. << " " << 0.
-                     << " " << 0. << " " << 0. << endl;
+                     << " " << 0. << " " << 0. << " " << 0. << " " << 0.
+                     << " " << 0. << " " << 0. << " " << 0. << endl;
           }
         }
       }
@@ -701,8 +473,20 @@ void MyEigen::flowVelocity4D(Lattice *lat, Parameters *param, int it) {
   // foutEtot.close();
 
   if (static_cast<int>(param->getWriteOutputs() / 4) == 1) {
-    double resultT00, resultT0x, resultT0y, resultT0eta, resultTxx, resultTxy;
-    double resultTxeta, resultTyy, resultTyeta, resultTetaeta;
+    enum { T00, T0X, T0Y, T0ETA, TXX, TXY, TXETA, TYY, TYETA, TETAETA,
+           FIELDS };
+    const std::vector<CellField> fields = {
+        &Cell::getTtautau, &Cell::getTtaux,  &Cell::getTtauy,
+        &Cell::getTtaueta, &Cell::getTxx,    &Cell::getTxy,
+        &Cell::getTxeta,   &Cell::getTyy,    &Cell::getTyeta,
+        &Cell::getTetaeta};
+    std::vector<double> result;
+    resample(lat, stencils, fields, std::vector<bool>(FIELDS, false), result);
+    // in GeV/fm^3
+    auto value = [&](int field, int p) {
+      return result[field * points + p] * gfactor * hbarc;
+    };
+
     stringstream strTmunu_name;
     strTmunu_name << "Tmunu-t" << it * dtau * a << "-" << param->getEventId()
                   << ".dat";
@@ -713,201 +497,15 @@ void MyEigen::flowVelocity4D(Lattice *lat, Parameters *param, int it) {
     // loop over all positions
     for (int iy = 0; iy < hy; iy++) {
       for (int ix = 0; ix < hx; ix++) {
-        x = -hL / 2. + ha * ix;
-        y = -hL / 2. + ha * iy;
-        if (abs(x) < L / 2. && abs(y) < L / 2.) {
-          xpos = static_cast<int>(floor((x + L / 2.) / a + 0.0000000001));
-          ypos = static_cast<int>(floor((y + L / 2.) / a + 0.0000000001));
-
-          if (xpos < N - 1) {
-            xposUp = xpos + 1;
-          } else {
-            xposUp = xpos;
-          }
-          if (ypos < N - 1) {
-            yposUp = ypos + 1;
-          } else {
-            yposUp = ypos;
-          }
-
-          xlow = -L / 2. + a * xpos;
-          ylow = -L / 2. + a * ypos;
-
-          pos1 = xpos * N + ypos;
-          pos2 = xposUp * N + ypos;
-          pos3 = xpos * N + yposUp;
-          pos4 = xposUp * N + yposUp;
-
-          fracx = (x - xlow) / ha;
-          fracy = (y - ylow) / ha;
-
-          // ---------------------T^tautau----------------------- //
-          if (pos1 > 0 && pos1 < N * N && pos2 > 0 && pos2 < N * N) {
-            x1 = ((1 - fracx) * (lat->cells[pos1]->getTtautau()) +
-                  fracx * (lat->cells[pos2]->getTtautau()));
-          } else {
-            x1 = 0.;
-          }
-          if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N) {
-            x2 = ((1 - fracx) * (lat->cells[pos3]->getTtautau()) +
-                  fracx * (lat->cells[pos4]->getTtautau()));
-          } else {
-            x2 = 0.;
-          }
-          resultT00 = (1. - fracy) * x1 + fracy * x2;
-
-          // ---------------------T^taux----------------------- //
-          if (pos1 > 0 && pos1 < N * N && pos2 > 0 && pos2 < N * N) {
-            x1 = ((1 - fracx) * (lat->cells[pos1]->getTtaux()) +
-                  fracx * (lat->cells[pos2]->getTtaux()));
-          } else {
-            x1 = 0.;
-          }
-          if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N) {
-            x2 = ((1 - fracx) * (lat->cells[pos3]->getTtaux()) +
-                  fracx * (lat->cells[pos4]->getTtaux()));
-          } else {
-            x2 = 0.;
-          }
-          resultT0x = (1. - fracy) * x1 + fracy * x2;
-
-          // ---------------------T^tauy----------------------- //
-          if (pos1 > 0 && pos1 < N * N && pos2 > 0 && pos2 < N * N) {
-            x1 = ((1 - fracx) * (lat->cells[pos1]->getTtauy()) +
-                  fracx * (lat->cells[pos2]->getTtauy()));
-          } else {
-            x1 = 0.;
-          }
-          if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N) {
-            x2 = ((1 - fracx) * (lat->cells[pos3]->getTtauy()) +
-                  fracx * (lat->cells[pos4]->getTtauy()));
-          } else {
-            x2 = 0.;
-          }
-          resultT0y = (1. - fracy) * x1 + fracy * x2;
-
-          // ---------------------T^taueta----------------------- //
-          if (pos1 > 0 && pos1 < N * N && pos2 > 0 && pos2 < N * N) {
-            x1 = ((1 - fracx) * (lat->cells[pos1]->getTtaueta()) +
-                  fracx * (lat->cells[pos2]->getTtaueta()));
-          } else {
-            x1 = 0.;
-          }
-          if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N) {
-            x2 = ((1 - fracx) * (lat->cells[pos3]->getTtaueta()) +
-                  fracx * (lat->cells[pos4]->getTtaueta()));
-          } else {
-            x2 = 0.;
-          }
-          resultT0eta = (1. - fracy) * x1 + fracy * x2;
-
-          // ---------------------T^xx----------------------- //
-          if (pos1 > 0 && pos1 < N * N && pos2 > 0 && pos2 < N * N) {
-            x1 = ((1 - fracx) * (lat->cells[pos1]->getTxx()) +
-                  fracx * (lat->cells[pos2]->getTxx()));
-          } else {
-            x1 = 0.;
-          }
-          if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N) {
-            x2 = ((1 - fracx) * (lat->cells[pos3]->getTxx()) +
-                  fracx * (lat->cells[pos4]->getTxx()));
-          } else {
-            x2 = 0.;
-          }
-          resultTxx = (1. - fracy) * x1 + fracy * x2;
-
-          // ---------------------T^xy----------------------- //
-          if (pos1 > 0 && pos1 < N * N && pos2 > 0 && pos2 < N * N) {
-            x1 = ((1 - fracx) * (lat->cells[pos1]->getTxy()) +
-                  fracx * (lat->cells[pos2]->getTxy()));
-          } else {
-            x1 = 0.;
-          }
-          if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N) {
-            x2 = ((1 - fracx) * (lat->cells[pos3]->getTxy()) +
-                  fracx * (lat->cells[pos4]->getTxy()));
-          } else {
-            x2 = 0.;
-          }
-          resultTxy = (1. - fracy) * x1 + fracy * x2;
-
-          // ---------------------T^xeta----------------------- //
-          if (pos1 > 0 && pos1 < N * N && pos2 > 0 && pos2 < N * N) {
-            x1 = ((1 - fracx) * (lat->cells[pos1]->getTxeta()) +
-                  fracx * (lat->cells[pos2]->getTxeta()));
-          } else {
-            x1 = 0.;
-          }
-          if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N) {
-            x2 = ((1 - fracx) * (lat->cells[pos3]->getTxeta()) +
-                  fracx * (lat->cells[pos4]->getTxeta()));
-          } else {
-            x2 = 0.;
-          }
-          resultTxeta = (1. - fracy) * x1 + fracy * x2;
-
-          // ---------------------T^yy----------------------- //
-          if (pos1 > 0 && pos1 < N * N && pos2 > 0 && pos2 < N * N) {
-            x1 = ((1 - fracx) * (lat->cells[pos1]->getTyy()) +
-                  fracx * (lat->cells[pos2]->getTyy()));
-          } else {
-            x1 = 0.;
-          }
-          if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N) {
-            x2 = ((1 - fracx) * (lat->cells[pos3]->getTyy()) +
-                  fracx * (lat->cells[pos4]->getTyy()));
-          } else {
-            x2 = 0.;
-          }
-          resultTyy = (1. - fracy) * x1 + fracy * x2;
-
-          // ---------------------T^yeta----------------------- //
-          if (pos1 > 0 && pos1 < N * N && pos2 > 0 && pos2 < N * N) {
-            x1 = ((1 - fracx) * (lat->cells[pos1]->getTyeta()) +
-                  fracx * (lat->cells[pos2]->getTyeta()));
-          } else {
-            x1 = 0.;
-          }
-          if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N) {
-            x2 = ((1 - fracx) * (lat->cells[pos3]->getTyeta()) +
-                  fracx * (lat->cells[pos4]->getTyeta()));
-          } else {
-            x2 = 0.;
-          }
-          resultTyeta = (1. - fracy) * x1 + fracy * x2;
-
-          // ---------------------T^etaeta----------------------- //
-          if (pos1 > 0 && pos1 < N * N && pos2 > 0 && pos2 < N * N) {
-            x1 = ((1 - fracx) * (lat->cells[pos1]->getTetaeta()) +
-                  fracx * (lat->cells[pos2]->getTetaeta()));
-          } else {
-            x1 = 0.;
-          }
-          if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N) {
-            x2 = ((1 - fracx) * (lat->cells[pos3]->getTetaeta()) +
-                  fracx * (lat->cells[pos4]->getTetaeta()));
-          } else {
-            x2 = 0.;
-          }
-          resultTetaeta = (1. - fracy) * x1 + fracy * x2;
-
-          if (resultT00 * gfactor * hbarc > small_eps) {
-            foutEps1 << ix << " " << iy << " " << resultT00 * gfactor * hbarc
-                     << " " << resultTxx * gfactor * hbarc << " "
-                     << resultTyy * gfactor * hbarc << " "
-                     << tau0 * tau0 * resultTetaeta * gfactor * hbarc << " "
-                     << -resultT0x * gfactor * hbarc << " "
-                     << -resultT0y * gfactor * hbarc << " "
-                     << -tau0 * resultT0eta * gfactor * hbarc << " "
-                     << -resultTxy * gfactor * hbarc << " "
-                     << -tau0 * resultTyeta * gfactor * hbarc << " "
-                     << -tau0 * resultTxeta * gfactor * hbarc << endl;
-          } else {
-            foutEps1 << ix << " " << iy << " " << small_eps << " "
-                     << small_eps / 2. << " " << small_eps / 2. << " " << 0.0
-                     << " " << 0.0 << " " << 0.0 << " " << 0.0 << " " << 0.0
-                     << " " << 0.0 << " " << 0.0 << endl;
-          }
+        const int p = ix * hy + iy;
+        if (stencils[p].inside && value(T00, p) > small_eps) {
+          foutEps1 << ix << " " << iy << " " << value(T00, p) << " "
+                   << value(TXX, p) << " " << value(TYY, p) << " "
+                   << tau0 * tau0 * value(TETAETA, p) << " "
+                   << -value(T0X, p) << " " << -value(T0Y, p) << " "
+                   << -tau0 * value(T0ETA, p) << " " << -value(TXY, p) << " "
+                   << -tau0 * value(TYETA, p) << " "
+                   << -tau0 * value(TXETA, p) << endl;
         } else {
           foutEps1 << ix << " " << iy << " " << small_eps << " "
                    << small_eps / 2. << " " << small_eps / 2. << " " << 0.0
@@ -921,81 +519,21 @@ void MyEigen::flowVelocity4D(Lattice *lat, Parameters *param, int it) {
   }
 
   if (static_cast<int>((param->getWriteOutputs() % 4) / 2) == 1) {
-    double Jaztot = 0.;
+    std::vector<double> result;
+    resample(lat, stencils, {&Cell::getg2mu2A, &Cell::getg2mu2B},
+             std::vector<bool>(2, true), result);
+    const double *g2mu2A = &result[0];
+    const double *g2mu2B = &result[points];
+
     // Jazma output:
     // compute sum first for normalization
-    for (int ieta = 0; ieta < heta; ieta++) // loop over all positions
-    {
-      for (int ix = 0; ix < hx; ix++) // loop over all positions
-      {
-        for (int iy = 0; iy < hy; iy++) {
-          x = -hL / 2. + ha * ix;
-          y = -hL / 2. + ha * iy;
-
-          if (abs(x) < L / 2. && abs(y) < L / 2.) {
-            xpos = static_cast<int>(floor((x + L / 2.) / a + 0.0000000001));
-            ypos = static_cast<int>(floor((y + L / 2.) / a + 0.0000000001));
-
-            if (xpos < N - 1)
-              xposUp = xpos + 1;
-            else
-              xposUp = xpos;
-
-            if (ypos < N - 1)
-              yposUp = ypos + 1;
-            else
-              yposUp = ypos;
-
-            xlow = -L / 2. + a * xpos;
-            ylow = -L / 2. + a * ypos;
-
-            fracx = (x - xlow) / ha;
-
-            pos1 = xpos * N + ypos;
-            pos2 = xposUp * N + ypos;
-            pos3 = xpos * N + yposUp;
-            pos4 = xposUp * N + yposUp;
-
-            // -----------------------------g2mu2A----------------------------------
-            // //
-            if (pos1 > 0 && pos1 < (N) * (N) && pos2 > 0 && pos2 < (N) * (N))
-              x1 = (1 - fracx) * abs(lat->cells[pos1]->getg2mu2A()) +
-                   fracx * abs(lat->cells[pos2]->getg2mu2A());
-            else
-              x1 = 0.;
-
-            if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N)
-              x2 = (1 - fracx) * abs(lat->cells[pos3]->getg2mu2A()) +
-                   fracx * abs(lat->cells[pos4]->getg2mu2A());
-            else
-              x2 = 0.;
-
-            fracy = (y - ylow) / ha;
-
-            g2mu2A = (1. - fracy) * x1 + fracy * x2;
-
-            // -----------------------------g2mu2B----------------------------------
-            // //
-            if (pos1 > 0 && pos1 < (N) * (N) && pos2 > 0 && pos2 < (N) * (N))
-              x1 = (1 - fracx) * abs(lat->cells[pos1]->getg2mu2B()) +
-                   fracx * abs(lat->cells[pos2]->getg2mu2B());
-            else
-              x1 = 0.;
-
-            if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N)
-              x2 = (1 - fracx) * abs(lat->cells[pos3]->getg2mu2B()) +
-                   fracx * abs(lat->cells[pos4]->getg2mu2B());
-            else
-              x2 = 0.;
-
-            g2mu2B = (1. - fracy) * x1 + fracy * x2;
-
-            Jaztot += g2mu2A * g2mu2B * ha * ha * it * dtau *
-                      a; // same units as in Etot above
-          }
-        }
-      }
+    double JazSlice = 0.;
+    for (int p = 0; p < points; p++) {
+      if (stencils[p].inside)
+        JazSlice += g2mu2A[p] * g2mu2B[p] * ha * ha * it * dtau *
+                    a; // same units as in Etot above
     }
+    const double Jaztot = heta * JazSlice;
 
     stringstream strJaz_name;
     strJaz_name << "Jazma-Hydro-t" << it * dtau * a << "-"
@@ -1024,78 +562,22 @@ void MyEigen::flowVelocity4D(Lattice *lat, Parameters *param, int it) {
       for (int ix = 0; ix < hx; ix++) // loop over all positions
       {
         for (int iy = 0; iy < hy; iy++) {
+          const int p = ix * hy + iy;
           x = -hL / 2. + ha * ix;
           y = -hL / 2. + ha * iy;
 
-          if (abs(x) < L / 2. && abs(y) < L / 2.) {
-            xpos = static_cast<int>(floor((x + L / 2.) / a + 0.0000000001));
-            ypos = static_cast<int>(floor((y + L / 2.) / a + 0.0000000001));
-
-            if (xpos < N - 1)
-              xposUp = xpos + 1;
-            else
-              xposUp = xpos;
-
-            if (ypos < N - 1)
-              yposUp = ypos + 1;
-            else
-              yposUp = ypos;
-
-            xlow = -L / 2. + a * xpos;
-            ylow = -L / 2. + a * ypos;
-
-            fracx = (x - xlow) / ha;
-
-            pos1 = xpos * N + ypos;
-            pos2 = xposUp * N + ypos;
-            pos3 = xpos * N + yposUp;
-            pos4 = xposUp * N + yposUp;
-
-            // -----------------------------g2mu2A----------------------------------
-            // //
-            if (pos1 > 0 && pos1 < (N) * (N) && pos2 > 0 && pos2 < (N) * (N))
-              x1 = (1 - fracx) * abs(lat->cells[pos1]->getg2mu2A()) +
-                   fracx * abs(lat->cells[pos2]->getg2mu2A());
-            else
-              x1 = 0.;
-
-            if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N)
-              x2 = (1 - fracx) * abs(lat->cells[pos3]->getg2mu2A()) +
-                   fracx * abs(lat->cells[pos4]->getg2mu2A());
-            else
-              x2 = 0.;
-
-            fracy = (y - ylow) / ha;
-
-            g2mu2A = (1. - fracy) * x1 + fracy * x2;
-
-            // -----------------------------g2mu2B----------------------------------
-            // //
-            if (pos1 > 0 && pos1 < (N) * (N) && pos2 > 0 && pos2 < (N) * (N))
-              x1 = (1 - fracx) * abs(lat->cells[pos1]->getg2mu2B()) +
-                   fracx * abs(lat->cells[pos2]->getg2mu2B());
-            else
-              x1 = 0.;
-
-            if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N)
-              x2 = (1 - fracx) * abs(lat->cells[pos3]->getg2mu2B()) +
-                   fracx * abs(lat->cells[pos4]->getg2mu2B());
-            else
-              x2 = 0.;
-
-            g2mu2B = (1. - fracy) * x1 + fracy * x2;
-
+          if (stencils[p].inside) {
             // QsAsqr=
             // g2mu2A*param->getQsmuRatio()*param->getQsmuRatio()/a/a*hbarc*hbarc*param->getg()*param->getg();
             // QsBsqr=
             // g2mu2B*param->getQsmuRatio()*param->getQsmuRatio()/a/a*hbarc*hbarc*param->getg()*param->getg();
 
             foutEps3 << -(heta - 1) / 2. * deta + deta * ieta << " " << x << " "
-                     << y << " " << g2mu2A * g2mu2B / Jaztot * Etot << " " << 1.
-                     << " " << 0. << " " << 0. << " " << 0. << " " << 0. << " "
+                     << y << " " << g2mu2A[p] * g2mu2B[p] / Jaztot * Etot
+                     << " " << 1. << " " << 0. << " " << 0. << " " << 0. << " "
                      << 0. << " " << 0. << " " << 0. << " " << 0. << " " << 0.
-                     << " " << 0. << " " << 0. << " " << 0. << " " << 0.
-                     << endl;
+                     << " " << 0. << " " << 0. << " " << 0. << " " << 0. << " "
+                     << 0. << endl;
 
             // // write two point and one point functions in [1/fm^6] and
             // [1/fm^4] from https://arxiv.org/pdf/1902.07168.pdf if (QsAsqr>0
@@ -1141,6 +623,83 @@ void MyEigen::flowVelocity4D(Lattice *lat, Parameters *param, int it) {
   // done output for hydro
 }
 
+void MyEigen::hydroStencils(Parameters *param, int hx, int hy, double hL,
+                            std::vector<HydroStencil> &stencils) {
+  const int N = param->getSize();
+  const double L = param->getL();
+  const double a = L / N;
+  const double ha = hL / static_cast<double>(hx);
+
+  stencils.assign(hx * hy, HydroStencil());
+  for (int ix = 0; ix < hx; ix++) {
+    for (int iy = 0; iy < hy; iy++) {
+      HydroStencil &s = stencils[ix * hy + iy];
+      const double x = -hL / 2. + ha * ix;
+      const double y = -hL / 2. + ha * iy;
+      s.inside = (abs(x) < L / 2. && abs(y) < L / 2.);
+      for (int i = 0; i < 4; i++) {
+        s.pos[i] = 0;
+        s.weight[i] = 0.;
+      }
+      if (!s.inside)
+        continue;
+
+      const int xpos = static_cast<int>(floor((x + L / 2.) / a + 0.0000000001));
+      const int ypos = static_cast<int>(floor((y + L / 2.) / a + 0.0000000001));
+      const int xposUp = (xpos < N - 1) ? xpos + 1 : xpos;
+      const int yposUp = (ypos < N - 1) ? ypos + 1 : ypos;
+
+      const double fracx = (x - (-L / 2. + a * xpos)) / ha;
+      const double fracy = (y - (-L / 2. + a * ypos)) / ha;
+
+      const int pos1 = xpos * N + ypos;
+      const int pos2 = xposUp * N + ypos;
+      const int pos3 = xpos * N + yposUp;
+      const int pos4 = xposUp * N + yposUp;
+
+      if (pos1 > 0 && pos1 < N * N && pos2 > 0 && pos2 < N * N) {
+        s.pos[0] = pos1;
+        s.pos[1] = pos2;
+        s.weight[0] = (1. - fracy) * (1 - fracx);
+        s.weight[1] = (1. - fracy) * fracx;
+      }
+      if (pos3 > 0 && pos3 < N * N && pos4 > 0 && pos4 < N * N) {
+        s.pos[2] = pos3;
+        s.pos[3] = pos4;
+        s.weight[2] = fracy * (1 - fracx);
+        s.weight[3] = fracy * fracx;
+      }
+    }
+  }
+}
+
+void MyEigen::resample(Lattice *lat, const std::vector<HydroStencil> &stencils,
+                       const std::vector<CellField> &fields,
+                       const std::vector<bool> &absolute,
+                       std::vector<double> &result) {
+  const int points = stencils.size();
+  const int nFields = fields.size();
+  result.assign(nFields * points, 0.);
+
+#pragma omp parallel for
+  for (int p = 0; p < points; p++) {
+    const HydroStencil &s = stencils[p];
+    if (!s.inside)
+      continue;
+    Cell *cells[4];
+    for (int i = 0; i < 4; i++)
+      cells[i] = lat->cells[s.pos[i]];
+    for (int f = 0; f < nFields; f++) {
+      double value = 0.;
+      for (int i = 0; i < 4; i++) {
+        const double v = (cells[i]->*fields[f])();
+        value += s.weight[i] * (absolute[f] ? abs(v) : v);
+      }
+      result[f * points + p] = value;
+    }
+  }
+}
+
 void MyEigen::test() {
   gsl_complex square;
   gsl_complex factor;
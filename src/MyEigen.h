@@ -7,6 +7,8 @@
 #include "gsl/gsl_complex.h"
 #include "gsl/gsl_complex_math.h"
 #include "gsl/gsl_eigen.h"
+#include <algorithm>
+#include <cmath>
 #include <complex>
 #include <fstream>
 #include <iomanip>
@@ -14,6 +16,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <vector>
 
 #include "Lattice.h"
 #include "Matrix.h"
@@ -23,6 +26,36 @@ using namespace std;
 
 class MyEigen {
 private:
+  // bilinear interpolation of the lattice onto one point of the hydro grid:
+  // cells pos with weights weight, zero weight where the lattice code drops
+  // a pair of cells
+  struct HydroStencil {
+    bool inside;
+    int pos[4];
+    double weight[4];
+  };
+  typedef double (Cell::*CellField)();
+
+  // stencils of the hx*hy transverse hydro grid points of length hL,
+  // point ix*hy+iy
+  void hydroStencils(Parameters *param, int hx, int hy, double hL,
+                     std::vector<HydroStencil> &stencils);
+  // all fields interpolated with the stencils in one pass, field f at point
+  // p in result[f*stencils.size()+p]; absolute fields use |value| per cell
+  void resample(Lattice *lat, const std::vector<HydroStencil> &stencils,
+                const std::vector<CellField> &fields,
+                const std::vector<bool> &absolute,
+                std::vector<double> &result);
+
+  // time-like eigenvector u and eigenvalue eps of M = T^mu_nu at proper
+  // time squared tau2 by Rayleigh quotient iteration; returns 0 if it fails
+  int landauMatching(const double M[4][4], double tau2, double &eps,
+                     double u[4]);
+  // the same with the general GSL eigensolver, for the cells where
+  // landauMatching fails
+  int landauMatchingGSL(double *data, double tau2, double Ttautau,
+                        bool checkEps, bool checkU, double &eps, double u[4]);
+
 public:
   // Constructor.
   MyEigen(){};
@@ -0,0 +1,97 @@
+#include "NodeShared.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sys/mman.h>
+
+bool NodeShared::enabled = false;
+#ifndef DISABLEMPI
+MPI_Comm NodeShared::nodeComm = MPI_COMM_NULL;
+std::vector<MPI_Win> NodeShared::windows;
+#endif
+std::vector<std::pair<void *, size_t>> NodeShared::mappings;
+
+void NodeShared::init(bool enable) {
+#ifndef DISABLEMPI
+  enabled = enable;
+  if (enabled && nodeComm == MPI_COMM_NULL) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank,
+                        MPI_INFO_NULL, &nodeComm);
+  }
+#else
+  // a single process: nothing to share, use the local read-only copy
+  enabled = false;
+  (void)enable;
+#endif
+}
+
+const char *NodeShared::mapLocally(const std::vector<char> &table) {
+  size_t length = std::max(table.size(), static_cast<size_t>(1));
+  void *mapped = mmap(NULL, length, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapped == MAP_FAILED) {
+    std::cerr << "[NodeShared]: ERROR: could not map " << length
+              << " bytes. Exiting." << std::endl;
+    exit(1);
+  }
+  if (!table.empty())
+    memcpy(mapped, &table[0], table.size());
+  mprotect(mapped, length, PROT_READ);
+  mappings.push_back(std::make_pair(mapped, length));
+  return static_cast<const char *>(mapped);
+}
+
+const char *NodeShared::share(const std::function<std::vector<char>()> &loader,
+                              size_t &bytes) {
+#ifndef DISABLEMPI
+  if (enabled) {
+    int nodeRank;
+    MPI_Comm_rank(nodeComm, &nodeRank);
+
+    std::vector<char> table;
+    unsigned long long length = 0;
+    if (nodeRank == 0) {
+      table = loader();
+      length = table.size();
+    }
+    MPI_Bcast(&length, 1, MPI_UNSIGNED_LONG_LONG, 0, nodeComm);
+
+    char *base = NULL;
+    MPI_Win win;
+    MPI_Win_allocate_shared(nodeRank == 0 ? static_cast<MPI_Aint>(length) : 0,
+                            1, MPI_INFO_NULL, nodeComm, &base, &win);
+    MPI_Aint segmentSize;
+    int dispUnit;
+    MPI_Win_shared_query(win, 0, &segmentSize, &dispUnit, &base);
+    if (nodeRank == 0 && length > 0)
+      memcpy(base, &table[0], length);
+    MPI_Barrier(nodeComm);
+
+    windows.push_back(win);
+    bytes = static_cast<size_t>(length);
+    return base;
+  }
+#endif
+  std::vector<char> table = loader();
+  bytes = table.size();
+  return mapLocally(table);
+}
+
+void NodeShared::finalize() {
+#ifndef DISABLEMPI
+  for (unsigned int i = 0; i < windows.size(); i++) {
+    MPI_Win_free(&windows[i]);
+  }
+  windows.clear();
+  if (nodeComm != MPI_COMM_NULL)
+    MPI_Comm_free(&nodeComm);
+#endif
+  for (unsigned int i = 0; i < mappings.size(); i++) {
+    munmap(mappings[i].first, mappings[i].second);
+  }
+  mappings.clear();
+}
@@ -0,0 +1,44 @@
+#ifndef NodeShared_h
+#define NodeShared_h
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#ifndef DISABLEMPI
+#include "mpi.h"
+#endif
+
+// NodeShared keeps one copy of a read-only table per compute node instead of
+// one per rank. The table is produced (read from file, parsed) by the first
+// rank of the node and placed in an MPI shared memory window
+// (MPI_Win_allocate_shared); all ranks of the node get a pointer into it.
+// Without MPI, or when sharing is switched off, every rank produces its own
+// copy in a read-only anonymous mapping.
+
+class NodeShared {
+private:
+  static bool enabled;
+#ifndef DISABLEMPI
+  static MPI_Comm nodeComm;
+  static std::vector<MPI_Win> windows;
+#endif
+  static std::vector<std::pair<void *, size_t>> mappings;
+
+  static const char *mapLocally(const std::vector<char> &table);
+
+public:
+  // collective over MPI_COMM_WORLD: set up the node communicator
+  static void init(bool enable);
+
+  // collective over the node (all ranks have to call it in the same order):
+  // loader is called on one rank per node and returns the table as bytes;
+  // returns a read-only pointer to the node's copy and its size in bytes
+  static const char *share(const std::function<std::vector<char>()> &loader,
+                           size_t &bytes);
+
+  // release all windows and mappings (before MPI_Finalize)
+  static void finalize();
+};
+
+#endif
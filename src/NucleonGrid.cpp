@@ -0,0 +1,112 @@
+#include "NucleonGrid.h"
+#include <algorithm>
+#include <cmath>
+
+// constructor
+NucleonGrid::NucleonGrid(const std::vector<ReturnValue> &nucleonList, int n,
+                         double cellSizeIn) {
+  nucleons = &nucleonList;
+  nNucleons = std::min(n, static_cast<int>(nucleonList.size()));
+  cellSize = cellSizeIn;
+
+  double xmax = 0., ymax = 0.;
+  xmin = ymin = 0.;
+  for (int i = 0; i < nNucleons; i++) {
+    const ReturnValue &nucleon = nucleonList[i];
+    if (i == 0 || nucleon.x < xmin)
+      xmin = nucleon.x;
+    if (i == 0 || nucleon.x > xmax)
+      xmax = nucleon.x;
+    if (i == 0 || nucleon.y < ymin)
+      ymin = nucleon.y;
+    if (i == 0 || nucleon.y > ymax)
+      ymax = nucleon.y;
+  }
+
+  // never use more cells than needed: at most ~ one per nucleon per direction
+  const int maxCells = std::max(1, nNucleons);
+  if (cellSize <= 0. || (xmax - xmin) / cellSize > maxCells ||
+      (ymax - ymin) / cellSize > maxCells)
+    cellSize = std::max(xmax - xmin, ymax - ymin) / maxCells + 1e-12;
+
+  nx = static_cast<int>((xmax - xmin) / cellSize) + 1;
+  ny = static_cast<int>((ymax - ymin) / cellSize) + 1;
+
+  // counting sort of the nucleons into the cells, keeping the original order
+  // within each cell
+  std::vector<int> cellOf(nNucleons);
+  cellStart.assign(nx * ny + 1, 0);
+  for (int i = 0; i < nNucleons; i++) {
+    int ix = std::min(
+        static_cast<int>((nucleonList[i].x - xmin) / cellSize), nx - 1);
+    int iy = std::min(
+        static_cast<int>((nucleonList[i].y - ymin) / cellSize), ny - 1);
+    cellOf[i] = ix * ny + iy;
+    cellStart[cellOf[i] + 1]++;
+  }
+  for (int c = 0; c < nx * ny; c++) {
+    cellStart[c + 1] += cellStart[c];
+  }
+  std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+  cellNucleons.resize(nNucleons);
+  for (int i = 0; i < nNucleons; i++) {
+    cellNucleons[fill[cellOf[i]]++] = i;
+  }
+}
+
+void NucleonGrid::cellRange(double x, double y, double radius, int &ixmin,
+                            int &ixmax, int &iymin, int &iymax) const {
+  // pad by a little so rounding never drops a cell at the edge of the range
+  radius = radius * (1. + 1e-12) + 1e-12;
+  ixmin = std::max(static_cast<int>(floor((x - radius - xmin) / cellSize)), 0);
+  ixmax =
+      std::min(static_cast<int>(floor((x + radius - xmin) / cellSize)), nx - 1);
+  iymin = std::max(static_cast<int>(floor((y - radius - ymin) / cellSize)), 0);
+  iymax =
+      std::min(static_cast<int>(floor((y + radius - ymin) / cellSize)), ny - 1);
+}
+
+void NucleonGrid::neighbours(double x, double y, double radius2,
+                             std::vector<int> &result) const {
+  result.clear();
+  if (nNucleons == 0)
+    return;
+  int ixmin, ixmax, iymin, iymax;
+  cellRange(x, y, sqrt(radius2), ixmin, ixmax, iymin, iymax);
+
+  for (int ix = ixmin; ix <= ixmax; ix++) {
+    for (int iy = iymin; iy <= iymax; iy++) {
+      const int c = ix * ny + iy;
+      for (int k = cellStart[c]; k < cellStart[c + 1]; k++) {
+        const ReturnValue &nucleon = (*nucleons)[cellNucleons[k]];
+        const double dx = nucleon.x - x;
+        const double dy = nucleon.y - y;
+        if (dx * dx + dy * dy < radius2)
+          result.push_back(cellNucleons[k]);
+      }
+    }
+  }
+  std::sort(result.begin(), result.end());
+}
+
+bool NucleonGrid::collidedNucleonWithin(double x, double y,
+                                        double radius2) const {
+  if (nNucleons == 0)
+    return false;
+  int ixmin, ixmax, iymin, iymax;
+  cellRange(x, y, sqrt(radius2), ixmin, ixmax, iymin, iymax);
+
+  for (int ix = ixmin; ix <= ixmax; ix++) {
+    for (int iy = iymin; iy <= iymax; iy++) {
+      const int c = ix * ny + iy;
+      for (int k = cellStart[c]; k < cellStart[c + 1]; k++) {
+        const ReturnValue &nucleon = (*nucleons)[cellNucleons[k]];
+        const double dx = nucleon.x - x;
+        const double dy = nucleon.y - y;
+        if (nucleon.collided == 1 && dx * dx + dy * dy < radius2)
+          return true;
+      }
+    }
+  }
+  return false;
+}
@@ -0,0 +1,44 @@
+#ifndef NucleonGrid_h
+#define NucleonGrid_h
+
+#include "Glauber.h"
+#include <vector>
+
+// The NucleonGrid class bins the transverse positions of a list of nucleons
+// into a uniform grid of square cells (stored in compressed form: the
+// nucleons of cell c are cellNucleons[cellStart[c]] ... [cellStart[c+1]-1]).
+// Queries for all nucleons within some distance of a point then only look at
+// the neighbouring cells instead of the full list.
+
+using namespace std;
+
+class NucleonGrid {
+private:
+  const std::vector<ReturnValue> *nucleons; // the binned nucleons (not owned)
+  int nNucleons;       // only the first nNucleons entries are binned
+  double cellSize;     // in fm
+  double xmin, ymin;   // lower left corner of the grid in fm
+  int nx, ny;          // number of cells in x and y
+  std::vector<int> cellStart;
+  std::vector<int> cellNucleons;
+
+  void cellRange(double x, double y, double radius, int &ixmin, int &ixmax,
+                 int &iymin, int &iymax) const;
+
+public:
+  // constructor
+  NucleonGrid(const std::vector<ReturnValue> &nucleonList, int n,
+              double cellSizeIn);
+  ~NucleonGrid(){};
+
+  // indices (in increasing order) of the nucleons with
+  // (x_i-x)^2+(y_i-y)^2 < radius2
+  void neighbours(double x, double y, double radius2,
+                  std::vector<int> &result) const;
+
+  // true if a nucleon with collided == 1 satisfies
+  // (x_i-x)^2+(y_i-y)^2 < radius2
+  bool collidedNucleonWithin(double x, double y, double radius2) const;
+};
+
+#endif
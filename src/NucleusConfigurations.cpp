@@ -0,0 +1,86 @@
+#include "NucleusConfigurations.h"
+
+#include <cstdlib>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::map<std::string, NucleusConfigurations *> NucleusConfigurations::library;
+std::mutex NucleusConfigurations::libraryMutex;
+
+NucleusConfigurations::NucleusConfigurations(const std::string &fileNameIn,
+                                             int AIn)
+    : fileName(fileNameIn), A(AIn), nConfigurations(0), mapped(NULL),
+      mappedBytes(0), opened(false) {
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if (fd < 0)
+    return;
+
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0) {
+    close(fd);
+    return;
+  }
+  mappedBytes = static_cast<size_t>(fileStat.st_size);
+  opened = true;
+
+  // the file has to hold a whole number of configurations of A nucleons
+  const size_t bytesPerConfiguration =
+      3 * static_cast<size_t>(A) * sizeof(float);
+  if (mappedBytes % bytesPerConfiguration != 0) {
+    cerr << "[NucleusConfigurations]: ERROR: size of " << fileName << " ("
+         << mappedBytes << " bytes) is not a multiple of the "
+         << bytesPerConfiguration << " bytes of a configuration with A=" << A
+         << ". Exiting." << endl;
+    exit(1);
+  }
+  nConfigurations = mappedBytes / bytesPerConfiguration;
+
+  if (mappedBytes > 0) {
+    mapped = mmap(NULL, mappedBytes, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+      cerr << "[NucleusConfigurations]: ERROR: could not map " << fileName
+           << ". Exiting." << endl;
+      exit(1);
+    }
+  }
+  close(fd);
+}
+
+NucleusConfigurations::~NucleusConfigurations() {
+  if (mapped != NULL)
+    munmap(mapped, mappedBytes);
+}
+
+const NucleusConfigurations *
+NucleusConfigurations::get(const std::string &fileNameIn, int AIn) {
+  std::lock_guard<std::mutex> lock(libraryMutex);
+  std::map<std::string, NucleusConfigurations *>::iterator it =
+      library.find(fileNameIn);
+  if (it == library.end()) {
+    NucleusConfigurations *configs =
+        new NucleusConfigurations(fileNameIn, AIn);
+    if (!configs->opened) {
+      delete configs;
+      configs = NULL;
+    }
+    it = library.insert(std::make_pair(fileNameIn, configs)).first;
+  }
+
+  if (it->second == NULL)
+    return NULL;
+  if (it->second->A != AIn) {
+    cerr << "[NucleusConfigurations]: ERROR: " << fileNameIn
+         << " was opened with A=" << it->second->A << ", now requested with A="
+         << AIn << ". Exiting." << endl;
+    exit(1);
+  }
+  return it->second;
+}
+
+bool NucleusConfigurations::tried(const std::string &fileNameIn) {
+  std::lock_guard<std::mutex> lock(libraryMutex);
+  return library.find(fileNameIn) != library.end();
+}
@@ -0,0 +1,52 @@
+#ifndef NucleusConfigurations_h
+#define NucleusConfigurations_h
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+
+// The NucleusConfigurations class gives read-only access to a file of
+// nucleon configurations (nucleusConfigurations/*.bin.in): a sequence of
+// configurations, each A nucleons times (x, y, z) as native floats.
+// The file is memory mapped, so all ranks on a node share the page cache,
+// and configurations are handed out as pointers into the mapping.
+
+using namespace std;
+
+class NucleusConfigurations {
+private:
+  std::string fileName;
+  int A;                  // number of nucleons per configuration
+  size_t nConfigurations; // number of configurations in the file
+  void *mapped;           // start of the mapping
+  size_t mappedBytes;     // length of the mapping
+  bool opened;            // false if the file could not be opened
+
+  NucleusConfigurations(const std::string &fileNameIn, int AIn);
+
+  // one entry per file for the lifetime of the process, NULL for a file that
+  // could not be opened
+  static std::map<std::string, NucleusConfigurations *> library;
+  static std::mutex libraryMutex;
+
+public:
+  ~NucleusConfigurations();
+
+  // maps the file on first use and returns the same object afterwards;
+  // returns NULL if the file cannot be opened, and does not try again
+  static const NucleusConfigurations *get(const std::string &fileNameIn,
+                                          int AIn);
+  // true if get was already called for this file
+  static bool tried(const std::string &fileNameIn);
+
+  int size() const { return static_cast<int>(nConfigurations); }
+  int getA() const { return A; }
+
+  // x, y, z of nucleon iA of configuration i are at [3*iA], [3*iA+1], [3*iA+2]
+  const float *configuration(int i) const {
+    return static_cast<const float *>(mapped) + 3 * static_cast<size_t>(A) * i;
+  }
+};
+
+#endif
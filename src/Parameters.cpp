@@ -1,72 +1,118 @@
 // Copyright (C) 2023 Chun Shen
 
+#include <cstdlib>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <sstream>
 #include <fstream>
 #include <iostream>
+#include "NodeShared.h"
 #include "Parameters.h"
 
 void Parameters::loadPosteriorParameterSetsFromFile(
-    std::string posteriorFileName, std::vector<std::vector<float>> &ParamSet) {
-    std::ifstream posteriorFile(posteriorFileName.c_str());
-    if (!posteriorFile.is_open()) {
-        std::cout << "[Paramters] Can not open posterior file: "
-                  << posteriorFileName << std::endl;
-        exit(1);
-    }
-    std::string tempLine;
-    std::getline(posteriorFile, tempLine);
-    while (std::getline(posteriorFile, tempLine)) {
-        std::stringstream lineStream(tempLine);
-        std::string cell;
-        std::vector<float> parsedRow;
-        while (std::getline(lineStream, cell, ',')) {
-            parsedRow.push_back(std::stof(cell));
+    std::string posteriorFileName, const float *&ParamSet, int &nRows,
+    int &nColumns) {
+    // parsed on one rank per node; the table is two ints (rows, columns)
+    // followed by the values
+    auto loader = [posteriorFileName]() {
+        std::ifstream posteriorFile(posteriorFileName.c_str());
+        if (!posteriorFile.is_open()) {
+            std::cout << "[Paramters] Can not open posterior file: "
+                      << posteriorFileName << std::endl;
+            exit(1);
         }
-        ParamSet.push_back(parsedRow);
-    }
-    posteriorFile.close();
+        std::vector<float> values;
+        int header[2] = {0, 0};
+        std::string tempLine;
+        std::getline(posteriorFile, tempLine);
+        while (std::getline(posteriorFile, tempLine)) {
+            std::stringstream lineStream(tempLine);
+            std::string cell;
+            int nCells = 0;
+            while (std::getline(lineStream, cell, ',')) {
+                values.push_back(std::stof(cell));
+                nCells++;
+            }
+            if (header[0] == 0) {
+                header[1] = nCells;
+            } else if (nCells != header[1]) {
+                std::cout << "[Paramters] Row " << header[0] + 1 << " of "
+                          << posteriorFileName << " has " << nCells
+                          << " entries instead of " << header[1] << std::endl;
+                exit(1);
+            }
+            header[0]++;
+        }
+        posteriorFile.close();
+
+        std::vector<char> table(sizeof(header) + values.size() * sizeof(float));
+        memcpy(&table[0], header, sizeof(header));
+        if (!values.empty())
+            memcpy(&table[sizeof(header)], &values[0],
+                   values.size() * sizeof(float));
+        return table;
+    };
+
+    size_t bytes;
+    const char *table = NodeShared::share(loader, bytes);
+    const int *header = reinterpret_cast<const int *>(table);
+    nRows = header[0];
+    nColumns = header[1];
+    ParamSet = reinterpret_cast<const float *>(table + 2 * sizeof(int));
 }
 
 
 void Parameters::loadPosteriorParameterSets(const int itype) {
     if (itype == 1) {
         loadPosteriorParameterSetsFromFile("tables/posterior.csv",
-                                           posteriorParamSets_);
+                                           posteriorParamSets_,
+                                           nPosteriorParamSets_,
+                                           nPosteriorColumns_);
     } else if (itype == 2) {
         loadPosteriorParameterSetsFromFile("tables/posterior_Nq3.csv",
-                                           posteriorParamSetsNq3_);
+                                           posteriorParamSetsNq3_,
+                                           nPosteriorParamSetsNq3_,
+                                           nPosteriorColumnsNq3_);
     } else if (itype == 4) {
         loadPosteriorParameterSetsFromFile("tables/posterior5020_Nq3.csv",
-                                           posteriorParamSetsNq3_);
+                                           posteriorParamSetsNq3_,
+                                           nPosteriorParamSetsNq3_,
+                                           nPosteriorColumnsNq3_);
     }
 }
 
 
-void Parameters::setParamsWithPosteriorParameterSet(const int itype,
-                                                    int iset) {
+// returns the row that was used
+int Parameters::setParamsWithPosteriorParameterSet(const int itype,
+                                                   int iset) {
     if (itype == 1) {
         // variant Nq
-        iset = (iset % posteriorParamSets_.size());
+        iset = static_cast<int>(static_cast<size_t>(iset) %
+                                static_cast<size_t>(nPosteriorParamSets_));
         std::cout << "set subnucleon param set:" << iset << std::endl;
-        setm(posteriorParamSets_[iset][0]);
-        setBG(posteriorParamSets_[iset][1]);
-        setBGq(posteriorParamSets_[iset][2]);
-        setSmearingWidth(posteriorParamSets_[iset][3]);
-        setNqBase(posteriorParamSets_[iset][4]);
-        setQsmuRatio(posteriorParamSets_[iset][5]);
-        setDqmin(posteriorParamSets_[iset][6]);
+        const float *paramSet = posteriorParamSets_ + iset * nPosteriorColumns_;
+        setm(paramSet[0]);
+        setBG(paramSet[1]);
+        setBGq(paramSet[2]);
+        setSmearingWidth(paramSet[3]);
+        setNqBase(paramSet[4]);
+        setQsmuRatio(paramSet[5]);
+        setDqmin(paramSet[6]);
     } else if (itype == 2 || itype == 4) {
         // fixed Nq = 3
-        iset = (iset % posteriorParamSetsNq3_.size());
+        iset = static_cast<int>(static_cast<size_t>(iset) %
+                                static_cast<size_t>(nPosteriorParamSetsNq3_));
         std::cout << "set subnucleon param set (Nq = 3):" << iset << std::endl;
-        setm(posteriorParamSetsNq3_[iset][0]);
-        setBG(posteriorParamSetsNq3_[iset][1]);
-        setBGq(posteriorParamSetsNq3_[iset][2]);
-        setSmearingWidth(posteriorParamSetsNq3_[iset][3]);
+        const float *paramSet =
+            posteriorParamSetsNq3_ + iset * nPosteriorColumnsNq3_;
+        setm(paramSet[0]);
+        setBG(paramSet[1]);
+        setBGq(paramSet[2]);
+        setSmearingWidth(paramSet[3]);
         setNqBase(3.);
-        setQsmuRatio(posteriorParamSetsNq3_[iset][4]);
-        setDqmin(posteriorParamSetsNq3_[iset][5]);
+        setQsmuRatio(paramSet[4]);
+        setDqmin(paramSet[5]);
     }
+    return iset;
 }
@@ -11,8 +11,16 @@ class Parameters {
 private:
   int subNucleonParamType_;
   int subNucleonParamSet_;
-  std::vector<std::vector<float>> posteriorParamSets_;
-  std::vector<std::vector<float>> posteriorParamSetsNq3_;
+  int subNucleonParamSweep_; // number of consecutive posterior sets run with
+                             // the same random numbers for every event
+  // posterior parameter sets: row-major nRows x nColumns tables, read only
+  // (possibly in memory shared by all ranks of a node)
+  const float *posteriorParamSets_ = nullptr;
+  int nPosteriorParamSets_ = 0;
+  int nPosteriorColumns_ = 0;
+  const float *posteriorParamSetsNq3_ = nullptr;
+  int nPosteriorParamSetsNq3_ = 0;
+  int nPosteriorColumnsNq3_ = 0;
   // switches:
   int initMethod;
 
@@ -39,6 +47,8 @@ private:
                                // depending on the value of getUseTimeforSeed())
   double ds;                   // 'time' step
   int Ny;      // longitudinal 'resolution' (see Lappi, Eur. Phys. J. C55,285)
+  double sliceMemoryGB; // memory in GB (10^9 bytes) for the rho^a and Wilson
+                        // lines of the longitudinal slices done at once
   double g2mu; // g^2 mu [in lattice units]
   double Qs;   // Q_s, to be dynamically determined
   int steps;   // number of rapidity steps
@@ -91,6 +101,9 @@ private:
                                // Wilson lines (before any evolution)
   int readInitialWilsonLines; // decide wheter to generate initial Wilson lines (0),
                               // or read these in plain text (1) or in binary format (2)
+  int wilsonLinePool; // Wilson line pool of the heavier nucleus: off (0),
+                      // append to it (1) or take the heavier nucleus from it (2)
+  std::string wilsonLinePoolFile; // the Wilson line pool file
   unsigned long long int randomSeed; // stores the random seed used (so the
                                      // event can be reproduced)
   std::string NucleusQsTableFileName; // the file name for the table containing Qs^2
@@ -115,6 +128,18 @@ private:
   double Tpp; // This is the convolution of two T_p's to be used in the weight
               // for different impact parameters
   // T_pp (b_T) = \sum \delta^2 x_T T_p(x_T) T_p(x_T-b_T)
+  int gaugeFixMethod; // Coulomb gauge fixing by Fourier accelerated steepest
+                      // descent (0), stochastic overrelaxation (1) or Fourier
+                      // preconditioned conjugate gradient (2)
+  double gaugeFixAlpha; // step size (0, 2) or overrelaxation probability (1)
+                        // of the gauge fixing, tuned automatically if <= 0
+  int gaugeFixWarmStart; // if > 0, the tuned gauge fixing step carries over
+                         // between measurements and the lattice is kept near
+                         // Coulomb gauge by one iteration every this many
+                         // evolution steps
+  int measureThreads; // if > 0, the multiplicity is measured on a copy of
+                      // the lattice by this many threads while the
+                      // evolution continues with the others
   int inverseQsForMaxTime; // use 1/Q_s as the maximal evolution time (1) or use
                            // the manually entered maximal evolution time (0)
   int useFatTails;         // if 1 use the student's t distribution instead of a
@@ -146,6 +171,7 @@ private:
   double dtau;     // time step in lattice units
   double maxtime;  // maximal evolution time in fm/c
   int Npart;       // Number of participants
+  int Ncoll;       // Number of binary collisions
   int averageOverNuclei; // average over this many nuclei to get a smooth(er)
                          // distribution
   int nucleonPositionsFromFile; // switch to determine whether to sample nucleon
@@ -154,6 +180,10 @@ private:
   int A2FromFile;    // if nuclei are read from file, store A value here
   int useFixedNpart; // if 0 do not demand a given N_part, if >1 sample the
                      // initial configuration until the given N_part is reached
+  int centralityEstimator;        // centrality trigger: 0 off, 1 N_part,
+                                  // 2 N_coll, 3 Q_s^2(min) S_T
+  double centralityEstimatorMin;  // accept events with the estimator in
+  double centralityEstimatorMax;  // [centralityEstimatorMin, ...Max)
   double rnp;        // distance between proton and neutron in the transverse
                      // projection of the deuteron
   int smearQs;       // decide whether to smear Q_s using a Poisson distribution
@@ -164,7 +194,12 @@ private:
                         // (1) to determine whether a nucleon is wounded
   int MPIrank;          // MPI rank
   int MPIsize;          // MPI number of cores
+  int shareTablesOnNode; // load read-only tables (Q_s table, posterior sets)
+                         // once per node into shared memory (1) or per rank
+                         // (0)
   int event_id;
+  int noiseEventId; // event whose random numbers are used: event_id, or the
+                    // first event of a parameter sweep
   int success; // no collision happened (0) or collision happened (1) - used to
                // restart if there was no collision
   int readMultFromFile; // if set, the gluon distribution as a function of k_T
@@ -204,6 +239,10 @@ public:
       subNucleonParamSet_ = paramSet;
   }
   int getSubNucleonParamSet() const { return(subNucleonParamSet_); }
+  void setSubNucleonParamSweep(int nSets) {
+      subNucleonParamSweep_ = nSets;
+  }
+  int getSubNucleonParamSweep() const { return(subNucleonParamSweep_); }
   void setSeed(unsigned long long int x) { seed = x; }
   unsigned long long int getSeed() { return seed; }
   void setA(int x) { A = x; }
@@ -212,6 +251,8 @@ public:
   int getNc() { return Nc; }
   void setNy(int x) { Ny = x; }
   int getNy() { return Ny; }
+  void setSliceMemoryGB(double x) { sliceMemoryGB = x; }
+  double getSliceMemoryGB() { return sliceMemoryGB; }
   void setSize(int x) { size = x; }
   int getSize() { return size; }
   void setProtonAnisotropy(double x) { protonAnisotropy = x; }
@@ -282,6 +323,8 @@ public:
   double getdtau() { return dtau; }
   void setNpart(int x) { Npart = x; };
   int getNpart() { return Npart; }
+  void setNcoll(int x) { Ncoll = x; };
+  int getNcoll() { return Ncoll; }
   void setAverageQs(double x) { averageQs = x; }
   double getAverageQs() { return averageQs; }
   void setAverageQsAvg(double x) { averageQsAvg = x; }
@@ -330,6 +373,12 @@ public:
   double getNu() { return nu; }
   void setUseFixedNpart(int x) { useFixedNpart = x; }
   int getUseFixedNpart() { return useFixedNpart; }
+  void setCentralityEstimator(int x) { centralityEstimator = x; }
+  int getCentralityEstimator() { return centralityEstimator; }
+  void setCentralityEstimatorMin(double x) { centralityEstimatorMin = x; }
+  double getCentralityEstimatorMin() { return centralityEstimatorMin; }
+  void setCentralityEstimatorMax(double x) { centralityEstimatorMax = x; }
+  double getCentralityEstimatorMax() { return centralityEstimatorMax; }
   void setArea(double x) { area = x; }
   double getArea() { return area; }
   void setEccentricity2(double x) { eccentricity2 = x; }
@@ -344,8 +393,12 @@ public:
   int getMPIRank() { return MPIrank; }
   void setEventId(int x) { event_id = x; }
   int getEventId() { return event_id; }
+  void setNoiseEventId(int x) { noiseEventId = x; }
+  int getNoiseEventId() { return noiseEventId; }
   void setMPISize(int x) { MPIsize = x; }
   int getMPISize() { return MPIsize; }
+  void setShareTablesOnNode(int x) { shareTablesOnNode = x; }
+  int getShareTablesOnNode() { return shareTablesOnNode; }
   void setSuccess(int x) { success = x; }
   int getSuccess() { return success; }
   void setRmax(double x) { rmax = x; }
@@ -412,10 +465,22 @@ public:
   int getWriteInitialWilsonLines() { return writeInitialWilsonLines; }
   void setReadInitialWilsonLines(int x) { readInitialWilsonLines = x; }
   int getReadInitialWilsonLines() { return readInitialWilsonLines; }
+  void setWilsonLinePool(int x) { wilsonLinePool = x; }
+  int getWilsonLinePool() { return wilsonLinePool; }
+  void setWilsonLinePoolFile(std::string x) { wilsonLinePoolFile = x; }
+  std::string getWilsonLinePoolFile() { return wilsonLinePoolFile; }
   void setNucleonPositionsFromFile(int x) { nucleonPositionsFromFile = x; }
   int getNucleonPositionsFromFile() { return nucleonPositionsFromFile; }
   void setInverseQsForMaxTime(int x) { inverseQsForMaxTime = x; };
   int getInverseQsForMaxTime() { return inverseQsForMaxTime; }
+  void setGaugeFixMethod(int x) { gaugeFixMethod = x; }
+  int getGaugeFixMethod() { return gaugeFixMethod; }
+  void setGaugeFixAlpha(double x) { gaugeFixAlpha = x; }
+  double getGaugeFixAlpha() { return gaugeFixAlpha; }
+  void setGaugeFixWarmStart(int x) { gaugeFixWarmStart = x; }
+  int getGaugeFixWarmStart() { return gaugeFixWarmStart; }
+  void setMeasureThreads(int x) { measureThreads = x; }
+  int getMeasureThreads() { return measureThreads; }
   void setUseFatTails(int x) { useFatTails = x; }
   int getUseFatTails() { return useFatTails; }
   void setSmearQs(int x) { smearQs = x; }
@@ -444,8 +509,9 @@ public:
   int getMinimumQs2ST() { return minimumQs2ST; }
 
   void loadPosteriorParameterSetsFromFile(std::string posteriorFileName,
-                                          std::vector<std::vector<float>> &ParamSet);
+                                          const float *&ParamSet, int &nRows,
+                                          int &nColumns);
   void loadPosteriorParameterSets(const int itype);
-  void setParamsWithPosteriorParameterSet(const int itype, int iset);
+  int setParamsWithPosteriorParameterSet(const int itype, int iset);
 };
 #endif // Parameters_H
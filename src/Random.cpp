@@ -199,10 +199,66 @@ double Random::Gauss(double mean, double width) {
 }
 
 
+void Random::Philox4x32(unsigned long long key, const unsigned int ctr[4],
+                        unsigned int out[4]) {
+  const unsigned long long M0 = 0xD2511F53ULL;
+  const unsigned long long M1 = 0xCD9E8D57ULL;
+  unsigned int k0 = static_cast<unsigned int>(key);
+  unsigned int k1 = static_cast<unsigned int>(key >> 32);
+  unsigned int c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+
+  for (int round = 0; round < 10; round++) {
+    unsigned long long p0 = M0 * c0;
+    unsigned long long p1 = M1 * c2;
+    unsigned int hi0 = static_cast<unsigned int>(p0 >> 32);
+    unsigned int hi1 = static_cast<unsigned int>(p1 >> 32);
+    c0 = hi1 ^ c1 ^ k0;
+    c1 = static_cast<unsigned int>(p1);
+    c2 = hi0 ^ c3 ^ k1;
+    c3 = static_cast<unsigned int>(p0);
+    k0 += 0x9E3779B9U;
+    k1 += 0xBB67AE85U;
+  }
+
+  out[0] = c0;
+  out[1] = c1;
+  out[2] = c2;
+  out[3] = c3;
+}
+
+void Random::CounterGauss(unsigned long long key, const unsigned int ctr[4],
+                            double &gauss1, double &gauss2) {
+  // two 53 bit uniform numbers in (0,1) from one Philox block, then Box-Muller
+  unsigned int r[4];
+  Philox4x32(key, ctr, r);
+  const double twoToMinus53 = 1. / 9007199254740992.;
+  double u1 = ((static_cast<unsigned long long>(r[0]) << 21) ^ (r[1] >> 11)) *
+                  twoToMinus53 +
+              0.5 * twoToMinus53;
+  double u2 = ((static_cast<unsigned long long>(r[2]) << 21) ^ (r[3] >> 11)) *
+              twoToMinus53;
+  double rad = sqrt(-2. * log(u1));
+  gauss1 = rad * cos(2. * M_PI * u2);
+  gauss2 = rad * sin(2. * M_PI * u2);
+}
+
 void Random::gslRandomInit(unsigned long long seed) {
   gsl_rng_set(gslRandom, seed);
 }
 
+// Restart both generators on a stream derived from (seed, stream), e.g. to
+// replay the same random numbers for several parameter sets. The two are
+// mixed with SplitMix64 so that neighbouring streams are uncorrelated.
+void Random::reseed(unsigned long long seed, unsigned long long stream) {
+  unsigned long long z = seed + 0x9E3779B97F4A7C15ULL * (stream + 1);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z = z ^ (z >> 31);
+  init_genrand64(z);
+  gslRandomInit(z);
+  iset = 0;
+}
+
 
 double Random::NBD(double nbar, double k) {
 
@@ -45,11 +45,20 @@ public:
   double genrand64_real3(void);
 
   void gslRandomInit(unsigned long long seed);
+  void reseed(unsigned long long seed, unsigned long long stream);
   double tdist(double nu);
   double NBD(double nbar, double k);
   int Poisson(const double mean);
   double Gauss(double mean = 0., double width = 1.);
   double Gauss2(double mean, double sigma);
+
+  // stateless counter-based generator (Philox4x32-10, Salmon et al. SC'11):
+  // the output only depends on (key, counter), so it can be evaluated in any
+  // order and on any thread
+  static void Philox4x32(unsigned long long key, const unsigned int ctr[4],
+                         unsigned int out[4]);
+  static void CounterGauss(unsigned long long key, const unsigned int ctr[4],
+                           double &gauss1, double &gauss2);
 };
 
 #endif
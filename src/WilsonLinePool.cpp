@@ -0,0 +1,112 @@
+#include "WilsonLinePool.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char WilsonLinePool::magic[8] = {'I', 'P', 'G', 'V', 'P', 'O', 'O', 'L'};
+
+WilsonLinePool::WilsonLinePool(const std::string &fileNameIn)
+    : fileName(fileNameIn), mapped(NULL), mappedBytes(0), opened(false) {
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if (fd < 0)
+    return;
+
+  struct stat fileStat;
+  if (fstat(fd, &fileStat) != 0) {
+    close(fd);
+    return;
+  }
+  mappedBytes = static_cast<size_t>(fileStat.st_size);
+  opened = true;
+
+  if (mappedBytes > 0) {
+    mapped = mmap(NULL, mappedBytes, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+      cerr << "[WilsonLinePool]: ERROR: could not map " << fileName
+           << ". Exiting." << endl;
+      exit(1);
+    }
+  }
+  close(fd);
+
+  // walk the entries; each one gives its own length
+  size_t pos = 0;
+  while (pos < mappedBytes) {
+    const WilsonLinePoolHeader *h = reinterpret_cast<const WilsonLinePoolHeader *>(
+        static_cast<const char *>(mapped) + pos);
+    if (mappedBytes - pos < sizeof(WilsonLinePoolHeader) ||
+        memcmp(h->magic, magic, sizeof(magic)) != 0 || h->N <= 0 ||
+        h->Nc <= 0 || h->A < 0) {
+      cerr << "[WilsonLinePool]: ERROR: " << fileName
+           << " is not a Wilson line pool or is corrupted at byte " << pos
+           << ". Exiting." << endl;
+      exit(1);
+    }
+    const size_t entryBytes =
+        sizeof(WilsonLinePoolHeader) +
+        (4 * static_cast<size_t>(h->A) +
+         2 * static_cast<size_t>(h->N) * h->N * h->Nc * h->Nc) *
+            sizeof(double);
+    if (mappedBytes - pos < entryBytes) {
+      cerr << "[WilsonLinePool]: ERROR: " << fileName
+           << " ends inside entry " << offset.size() << ". Exiting." << endl;
+      exit(1);
+    }
+    offset.push_back(pos);
+    pos += entryBytes;
+  }
+}
+
+WilsonLinePool::~WilsonLinePool() {
+  if (mapped != NULL)
+    munmap(mapped, mappedBytes);
+}
+
+const WilsonLinePool *WilsonLinePool::get(const std::string &fileNameIn) {
+  // one mapping per file for the lifetime of the process
+  static std::map<std::string, WilsonLinePool *> library;
+
+  std::map<std::string, WilsonLinePool *>::iterator it =
+      library.find(fileNameIn);
+  if (it == library.end()) {
+    WilsonLinePool *pool = new WilsonLinePool(fileNameIn);
+    if (!pool->opened) {
+      delete pool;
+      return NULL;
+    }
+    it = library.insert(std::make_pair(fileNameIn, pool)).first;
+  }
+  return it->second;
+}
+
+void WilsonLinePool::append(const std::string &fileNameIn,
+                            const WilsonLinePoolHeader &header,
+                            const std::vector<double> &nucleons,
+                            const std::vector<double> &links) {
+  WilsonLinePoolHeader h = header;
+  memcpy(h.magic, magic, sizeof(magic));
+
+  FILE *out = fopen(fileNameIn.c_str(), "ab");
+  if (out == NULL) {
+    cerr << "[WilsonLinePool]: ERROR: could not open " << fileNameIn
+         << " for writing. Exiting." << endl;
+    exit(1);
+  }
+  bool ok = fwrite(&h, sizeof(h), 1, out) == 1;
+  ok = ok && fwrite(&nucleons[0], sizeof(double), nucleons.size(), out) ==
+                 nucleons.size();
+  ok = ok &&
+       fwrite(&links[0], sizeof(double), links.size(), out) == links.size();
+  ok = (fclose(out) == 0) && ok;
+  if (!ok) {
+    cerr << "[WilsonLinePool]: ERROR: writing to " << fileNameIn
+         << " failed. Exiting." << endl;
+    exit(1);
+  }
+}
@@ -0,0 +1,74 @@
+#ifndef WilsonLinePool_h
+#define WilsonLinePool_h
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+// The WilsonLinePool class gives read-only access to a pool of Wilson lines
+// V(x_T) of single nuclei, written by earlier runs with wilsonLinePool 1.
+// The pool is a sequence of self-describing entries: a WilsonLinePoolHeader,
+// the nucleon positions (x, y, z, proton) without the impact parameter
+// shift, and N*N*Nc*Nc complex matrix elements in the cell order of the
+// lattice (pos = i*N + j). Pools from several ranks can simply be
+// concatenated. Like the nucleon configurations the file is memory mapped.
+
+using namespace std;
+
+struct WilsonLinePoolHeader {
+  char magic[8]; // "IPGVPOOL"
+  int N;         // lattice size
+  int Nc;        // number of colors
+  double L;      // lattice length in fm
+  double shift;  // x shift of the nucleus when its V was computed, in fm
+  int A;         // number of nucleons stored
+  int nucleus;   // 0 if it was nucleus A (V in U), 1 if nucleus B (V in U2)
+};
+
+class WilsonLinePool {
+private:
+  std::string fileName;
+  void *mapped;               // start of the mapping
+  size_t mappedBytes;         // length of the mapping
+  bool opened;                // false if the file could not be opened
+  std::vector<size_t> offset; // byte offset of each entry
+
+  WilsonLinePool(const std::string &fileNameIn);
+
+public:
+  ~WilsonLinePool();
+
+  static const char magic[8];
+
+  // maps the pool on first use and returns the same object afterwards;
+  // returns NULL if the file cannot be opened
+  static const WilsonLinePool *get(const std::string &fileNameIn);
+
+  // appends one entry to fileNameIn; nucleons holds 4*A and links
+  // 2*N*N*Nc*Nc doubles
+  static void append(const std::string &fileNameIn,
+                     const WilsonLinePoolHeader &header,
+                     const std::vector<double> &nucleons,
+                     const std::vector<double> &links);
+
+  int size() const { return static_cast<int>(offset.size()); }
+
+  const WilsonLinePoolHeader *header(int i) const {
+    return reinterpret_cast<const WilsonLinePoolHeader *>(
+        static_cast<const char *>(mapped) + offset[i]);
+  }
+
+  // x, y, z, proton of nucleon iA are at [4*iA], ..., [4*iA+3]
+  const double *nucleons(int i) const {
+    return reinterpret_cast<const double *>(header(i) + 1);
+  }
+
+  // Re and Im of element k of V at cell pos are at [2*(pos*Nc*Nc+k)] and
+  // [2*(pos*Nc*Nc+k)+1]
+  const double *links(int i) const {
+    return nucleons(i) + 4 * static_cast<size_t>(header(i)->A);
+  }
+};
+
+#endif
@@ -1,4 +1,5 @@
 
+#include <algorithm>
 #include <cmath>
 #include <complex>
 #include <cstdlib>
@@ -20,6 +21,7 @@
 #include "Init.h"
 #include "Lattice.h"
 #include "Matrix.h"
+#include "NodeShared.h"
 #include "Parameters.h"
 #include "Random.h"
 #include "Setup.h"
@@ -66,6 +68,11 @@ int main(int argc, char *argv[]) {
   // read parameters from file
   readInput(&setup, param, argc, argv, rank);
 
+  // read-only tables that are the same for all events; with
+  // shareTablesOnNode = 1 they are held once per node
+  if (param->getUseNucleus() == 1)
+    Init::shareNuclearQsTable(param);
+
   // initialize random generator using time and seed from input file
   Random *random = new Random();
   unsigned long long int rnum;
@@ -117,29 +124,54 @@ int main(int argc, char *argv[]) {
     messager.flush("info");
   }
 
+  // in a parameter sweep every event is generated for nSweep consecutive
+  // posterior parameter sets, all with the same random numbers (geometry,
+  // sub-nucleon structure and color charges), so the differences between the
+  // sets are not buried in event-by-event fluctuations
+  const int nSweep = (param->getSubNucleonParamType() > 0)
+                         ? std::max(1, param->getSubNucleonParamSweep())
+                         : 1;
+  int iSubNucleonParamSetBase = 0;
+
   // event loop starts ...
-  for (int iev = 0; iev < nev; iev++) {
-    messager << "Generating event " << iev + 1 << " out of " << nev << " ...";
+  for (int iev = 0; iev < nev * nSweep; iev++) {
+    const int isweep = iev % nSweep;
+    messager << "Generating event " << iev / nSweep + 1 << " out of " << nev;
+    if (nSweep > 1)
+      messager << ", parameter set " << isweep + 1 << " out of " << nSweep;
+    messager << " ...";
     messager.flush("info");
     // welcome
     if (rank == 0)
       display_logo();
 
     if (param->getSubNucleonParamType() > 0) {
+      if (isweep == 0) {
         // sample the sub-nucleon parameters from the posterior distribution
         int iSubNucleonParamSet = param->getSubNucleonParamSet();
         if (iSubNucleonParamSet == -1) {
             iSubNucleonParamSet = random->genrand64_int63();
         }
-        param->setParamsWithPosteriorParameterSet(
+        iSubNucleonParamSetBase = param->setParamsWithPosteriorParameterSet(
                 param->getSubNucleonParamType(), iSubNucleonParamSet);
+      } else {
+        param->setParamsWithPosteriorParameterSet(
+                param->getSubNucleonParamType(),
+                iSubNucleonParamSetBase + isweep);
+      }
     }
 
     // initialize helper class objects
 
     param->setEventId(rank + iev * size);
+    param->setNoiseEventId(rank + (iev - isweep) * size);
     param->setSuccess(0);
 
+    // common random numbers: every parameter set of the sweep starts from
+    // the same state of the generator
+    if (nSweep > 1)
+      random->reseed(param->getRandomSeed(), param->getNoiseEventId());
+
     writeparams(param);
 
     int nn[2];
@@ -179,7 +211,7 @@ int main(int argc, char *argv[]) {
     // init.eccentricity(lat, &group, param, random, glauber);
 
     // initialize evolution object
-    Evolution evolution(nn);
+    Evolution evolution(nn, param);
 
     // either read k_T spectrum from file or do a fresh start
     if (param->getReadMultFromFile() == 1) {
@@ -388,6 +420,8 @@ int main(int argc, char *argv[]) {
     messager.flush("info");
   }
 
+  NodeShared::finalize();
+
 #ifndef DISABLEMPI
   MPI_Finalize();
 #endif
@@ -475,9 +509,14 @@ int readInput(Setup *setup, Parameters *param, int argc, char *argv[],
   param->setUseFluctuatingx(setup->IFind(file_name, "useFluctuatingx"));
   param->setNc(setup->IFind(file_name, "Nc"));
   param->setInverseQsForMaxTime(setup->IFind(file_name, "inverseQsForMaxTime"));
+  param->setGaugeFixMethod(setup->IFind(file_name, "gaugeFixMethod"));
+  param->setGaugeFixAlpha(setup->DFind(file_name, "gaugeFixAlpha"));
+  param->setGaugeFixWarmStart(setup->IFind(file_name, "gaugeFixWarmStart"));
+  param->setMeasureThreads(setup->IFind(file_name, "measureThreads"));
   param->setSeed(setup->ULLIFind(file_name, "seed"));
   param->setUseSeedList(setup->IFind(file_name, "useSeedList"));
   param->setNy(setup->IFind(file_name, "Ny"));
+  param->setSliceMemoryGB(setup->DFind(file_name, "sliceMemoryGB"));
   param->setRoots(setup->DFind(file_name, "roots"));
   param->setNu(setup->DFind(file_name, "tDistNu"));
   param->setUseFatTails(setup->IFind(file_name, "useFatTails"));
@@ -531,10 +570,36 @@ int readInput(Setup *setup, Parameters *param, int argc, char *argv[],
       setup->IFind(file_name, "writeInitialWilsonLines"));
   param->setReadInitialWilsonLines(
         setup->IFind(file_name, "readInitialWilsonLines"));
+  param->setWilsonLinePool(setup->IFind(file_name, "wilsonLinePool"));
+  param->setWilsonLinePoolFile(setup->StringFind(file_name, "wilsonLinePoolFile"));
   param->setAverageOverNuclei(
       setup->IFind(file_name, "averageOverThisManyNuclei"));
   param->setUseTimeForSeed(setup->IFind(file_name, "useTimeForSeed"));
   param->setUseFixedNpart(setup->IFind(file_name, "useFixedNpart"));
+  param->setCentralityEstimator(
+      setup->IFind(file_name, "centralityEstimator"));
+  param->setCentralityEstimatorMin(
+      setup->DFind(file_name, "centralityEstimatorMin"));
+  param->setCentralityEstimatorMax(
+      setup->DFind(file_name, "centralityEstimatorMax"));
+  const int centralityEstimator = param->getCentralityEstimator();
+  if (centralityEstimator < 0 || centralityEstimator > 3) {
+    cerr << "Error: unknown centralityEstimator " << centralityEstimator
+         << ". Exiting." << endl;
+    exit(1);
+  }
+  if ((centralityEstimator == 1 || centralityEstimator == 2) &&
+      param->getUseNucleus() != 1) {
+    cerr << "Error: centralityEstimator " << centralityEstimator
+         << " (N_part/N_coll) needs useNucleus 1. Exiting." << endl;
+    exit(1);
+  }
+  if (centralityEstimator != 0 && param->getCentralityEstimatorMin() >=
+                                      param->getCentralityEstimatorMax()) {
+    cerr << "Error: empty centrality window [" << param->getCentralityEstimatorMin()
+         << ", " << param->getCentralityEstimatorMax() << "). Exiting." << endl;
+    exit(1);
+  }
   param->setSmearQs(setup->IFind(file_name, "smearQs"));
   param->setSmearingWidth(setup->DFind(file_name, "smearingWidth"));
   param->setGaussianWounding(setup->IFind(file_name, "gaussianWounding"));
@@ -550,6 +615,10 @@ int readInput(Setup *setup, Parameters *param, int argc, char *argv[],
   param->setMinimumQs2ST(setup->IFind(file_name, "minimumQs2ST"));
   param->setSubNucleonParamType(setup->IFind(file_name, "SubNucleonParamType"));
   param->setSubNucleonParamSet(setup->IFind(file_name, "SubNucleonParamSet"));
+  param->setSubNucleonParamSweep(
+      setup->IFind(file_name, "SubNucleonParamSweep"));
+  param->setShareTablesOnNode(setup->IFind(file_name, "shareTablesOnNode"));
+  NodeShared::init(param->getShareTablesOnNode() == 1);
   if (param->getSubNucleonParamType() > 0) {
       param->loadPosteriorParameterSets(param->getSubNucleonParamType());
   }